@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "chip-8.h"
+#include "machine_pool.h"
+
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// Clears the screen and spins, used when no ROM is given
+	uint16_t IdleProgram[] = { 0xe000, 0x0212 };
+
+	struct Sample
+	{
+		double Median = 0.0;
+		double Best = 0.0;
+	};
+
+	Sample Measure(int iterations, const std::function<void()>& body)
+	{
+		std::vector<double> timings(iterations);
+		for (double& timing : timings)
+		{
+			Clock::time_point start = Clock::now();
+			body();
+			timing = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+		}
+		std::sort(timings.begin(), timings.end());
+		return { timings[timings.size() / 2], timings.front() };
+	}
+
+	void Report(const char* name, const Sample& sample)
+	{
+		std::printf("%-24s median %10.2f us   best %10.2f us\n", name, sample.Median, sample.Best);
+	}
+
+	void PrintUsage()
+	{
+		std::printf(
+			"usage: bench [options] [rom file]\n"
+			"  --iterations N     runs per measurement (default: 200)\n"
+			"  --pool N           machines in the batch stepping pool (default: 10000)\n"
+			"  --terminal         measure without a window\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = 200;
+	int pool_size = 10000;
+	const char* rom_path = nullptr;
+	chipotto::VideoBackend backend = chipotto::VideoBackend::Window;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+			iterations = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--pool") == 0 && i + 1 < argc)
+			pool_size = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--terminal") == 0)
+			backend = chipotto::VideoBackend::Terminal;
+		else if (argv[i][0] == '-')
+		{
+			PrintUsage();
+			return -1;
+		}
+		else
+			rom_path = argv[i];
+	}
+
+	Uint32 subsystems = backend == chipotto::VideoBackend::Terminal ? SDL_INIT_EVENTS : SDL_INIT_VIDEO;
+	if (SDL_Init(subsystems) != 0)
+	{
+		SDL_Log("Unable to initialize SDL: %s", SDL_GetError());
+		return -1;
+	}
+
+	auto load = [&](chipotto::Emulator& emulator)
+	{
+		if (rom_path)
+			emulator.LoadFromFile(rom_path);
+		else
+			emulator.LoadFromBuffer(IdleProgram, 2);
+	};
+
+	// Cold start: a new window, renderer and texture for every ROM
+	Report("emulator cold start", Measure(iterations, [&]()
+	{
+		chipotto::Emulator emulator(backend);
+		emulator.SetTraceStream(nullptr);
+		load(emulator);
+	}));
+
+	// ROM switch: the host resources stay, only the machine starts over
+	chipotto::Emulator emulator(backend);
+	emulator.SetTraceStream(nullptr);
+	if (!emulator.IsValid())
+	{
+		SDL_Log("Unable to create the emulator");
+		SDL_Quit();
+		return -1;
+	}
+	Report("emulator rom switch", Measure(iterations, [&]()
+	{
+		emulator.Reset();
+		load(emulator);
+	}));
+
+	// The same two paths without SDL, as the thumbnailer runs them
+	Report("machine cold start", Measure(iterations, [&]()
+	{
+		auto machine = std::make_unique<chipotto::Machine>();
+		if (rom_path)
+			machine->LoadFromFile(rom_path);
+		else
+			machine->LoadFromBuffer(IdleProgram, 2);
+	}));
+
+	chipotto::Machine machine;
+	Report("machine reset", Measure(iterations, [&]()
+	{
+		machine.Reset();
+		if (rom_path)
+			machine.LoadFromFile(rom_path);
+		else
+			machine.LoadFromBuffer(IdleProgram, 2);
+	}));
+
+	std::printf("machine footprint        %zu bytes (%zu of hot state, %zu of page table, %zu of screen) + %zu written\n",
+		sizeof(chipotto::Machine), sizeof(chipotto::MachineState), sizeof(chipotto::PagedMemory), sizeof(chipotto::Display),
+		machine.GetFootprint() - sizeof(chipotto::Machine));
+
+	// Forking a running machine, as a tree search does for every branch
+	machine.SetTraceStream(nullptr);
+	for (int frame = 0; frame < 60; ++frame)
+		machine.RunFrame(11);
+	Report("machine fork", Measure(iterations, [&]()
+	{
+		chipotto::Machine fork = machine.Fork();
+		fork.RunFrame(1);
+	}));
+
+	// A full pool stepped one frame at a time on every core, first with threads
+	// left to the OS, then with pinned workers that own their band of the arena
+	std::shared_ptr<const chipotto::RomImage> image = rom_path ? chipotto::RomImage::Open(rom_path) : nullptr;
+	for (bool pinned : { false, true })
+	{
+		chipotto::WorkerPool workers(0, pinned);
+		if (pinned)
+			workers.PinCallingThread();
+		chipotto::MachinePool pool(pool_size, pinned ? &workers : nullptr);
+		Sample acquire = Measure(1, [&]()
+		{
+			for (int i = 0; i < pool_size; ++i)
+			{
+				uint32_t index = pool.Acquire();
+				if (image)
+					pool[index].LoadFromImage(image);
+				else
+					pool[index].LoadFromBuffer(IdleProgram, 2);
+			}
+		});
+		// Each worker copies the pages of its own band, so the copies are made
+		// on the node that will write to them
+		workers.ParallelFor(pool_size, [&](int begin, int end)
+		{
+			for (int index = begin; index < end; ++index)
+				pool[index].MakeMemoryPrivate();
+		});
+		std::printf("pool of %d machines     %zu MB arena, %s pages, %.2f us per acquire\n", pool_size, pool.GetArenaSize() >> 20,
+			pool.UsesHugePages() ? "huge" : "normal", acquire.Median / pool_size);
+		Report(pinned ? "pool frame (pinned)" : "pool frame", Measure(std::max(1, iterations / 10), [&]() { pool.RunFrame(11, &workers); }));
+	}
+
+	SDL_Quit();
+	return 0;
+}
\ No newline at end of file
@@ -5,17 +5,113 @@
 
 int main(int argc, char** argv)
 {
-	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0)
+	chipotto::VideoBackend backend = chipotto::VideoBackend::Window;
+	chipotto::TerminalGlyphs glyphs = chipotto::TerminalGlyphs::HalfBlock;
+	const char* capture_path = nullptr;
+	bool audio = false;
+	bool audio_sync = false;
+	const char* database_path = nullptr;
+	bool quirks_set = false;
+	chipotto::QuirkProfile quirks = chipotto::QuirkProfile::Modern;
+	const char* boot_cache_path = nullptr;
+	int boot_frames = 600;
+	bool trace = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (SDL_strcmp(argv[i], "--terminal") == 0)
+		{
+			backend = chipotto::VideoBackend::Terminal;
+		}
+		else if (SDL_strcmp(argv[i], "--braille") == 0)
+		{
+			backend = chipotto::VideoBackend::Terminal;
+			glyphs = chipotto::TerminalGlyphs::Braille;
+		}
+		else if (SDL_strcmp(argv[i], "--audio") == 0)
+		{
+			audio = true;
+		}
+		else if (SDL_strcmp(argv[i], "--audio-sync") == 0)
+		{
+			audio = true;
+			audio_sync = true;
+		}
+		else if (SDL_strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+		{
+			capture_path = argv[++i];
+		}
+		else if (SDL_strcmp(argv[i], "--quirks") == 0 && i + 1 < argc)
+		{
+			if (!chipotto::ParseQuirkProfile(argv[++i], quirks))
+			{
+				SDL_Log("Unknown quirk profile %s (expected modern, vip, schip or xochip)", argv[i]);
+				return -1;
+			}
+			quirks_set = true;
+		}
+		else if (SDL_strcmp(argv[i], "--db") == 0 && i + 1 < argc)
+		{
+			database_path = argv[++i];
+		}
+		else if (SDL_strcmp(argv[i], "--boot-cache") == 0 && i + 1 < argc)
+		{
+			boot_cache_path = argv[++i];
+		}
+		else if (SDL_strcmp(argv[i], "--boot-frames") == 0 && i + 1 < argc)
+		{
+			boot_frames = SDL_max(0, SDL_atoi(argv[++i]));
+		}
+		else if (SDL_strcmp(argv[i], "--trace") == 0)
+		{
+			trace = true;
+		}
+	}
+
+	// Over SSH there is no display to open: the terminal backend only needs events
+	Uint32 subsystems = backend == chipotto::VideoBackend::Terminal ? SDL_INIT_EVENTS : SDL_INIT_VIDEO | SDL_INIT_AUDIO;
+	if (SDL_Init(subsystems) != 0)
 	{
 		SDL_Log("Unable to initialize SDL: %s", SDL_GetError());
 		return -1;
 	}
 
-	chipotto::Emulator emulator;
+	chipotto::Emulator emulator(backend, glyphs);
+	// The terminal is the screen: keep the instruction trace off it
+	if (trace && backend == chipotto::VideoBackend::Window)
+		emulator.SetTraceStream(&std::cout);
 
 	if (emulator.IsValid())
 	{
+		// Without --db the database in the working directory is used if there is one
+		if (database_path && !emulator.OpenRomDatabase(database_path))
+			SDL_Log("Unable to open ROM database %s", database_path);
+		else if (!database_path)
+			emulator.OpenRomDatabase("roms.c8db");
+
 		emulator.LoadFromFile("C:\\Users\\mikym\\Downloads\\Games\\PONG");
+		// An explicit profile overrides the database
+		if (quirks_set)
+			emulator.GetMachine().SetQuirks(quirks);
+		// Skip the title screen: up to the first key wait, or boot_frames frames
+		chipotto::SnapshotCache boot_cache;
+		if (boot_cache_path)
+		{
+			boot_cache.Open(boot_cache_path);
+			emulator.BootFromCache(boot_cache, boot_frames);
+		}
+		if (audio && backend == chipotto::VideoBackend::Window)
+		{
+			emulator.EnableAudio(audio_sync);
+		}
+		if (capture_path)
+		{
+			chipotto::CaptureOptions options;
+			options.Format = std::filesystem::path(capture_path).extension() == ".gif" ? chipotto::CaptureFormat::Gif : chipotto::CaptureFormat::Y4M;
+			// Y4M on stdout must not be interleaved with the instruction trace
+			if (SDL_strcmp(capture_path, "-") == 0)
+				emulator.SetTraceStream(nullptr);
+			emulator.StartCapture(capture_path, options);
+		}
 		while (true)
 		{
 			if (!emulator.Tick())
@@ -0,0 +1,189 @@
+#include "audio_output.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace chipotto
+{
+	void AudioRateControl::Configure(double samples_per_frame, uint32_t target_samples, double max_adjust)
+	{
+		SamplesPerFrame = samples_per_frame;
+		TargetSamples = std::max(1.0, static_cast<double>(target_samples));
+		MaxAdjust = max_adjust;
+		Fraction = 0.0;
+		Ratio = 1.0;
+	}
+
+	int AudioRateControl::NextFrameSamples(uint32_t queued_samples)
+	{
+		// Below target the frame stretches slightly, above it shrinks
+		double error = std::clamp((TargetSamples - queued_samples) / TargetSamples, -1.0, 1.0);
+		Ratio = 1.0 + MaxAdjust * error;
+
+		double samples = SamplesPerFrame * Ratio + Fraction;
+		int count = static_cast<int>(samples);
+		Fraction = samples - count;
+		return count;
+	}
+
+	int AudioRateControl::NominalFrameSamples()
+	{
+		Ratio = 1.0;
+		double samples = SamplesPerFrame + Fraction;
+		int count = static_cast<int>(samples);
+		Fraction = samples - count;
+		return count;
+	}
+
+	void SquareWave::Configure(int sample_rate, double frequency, int16_t amplitude)
+	{
+		PhaseStep = frequency / sample_rate;
+		GainStep = 1.0f / std::max(1, sample_rate / 500);
+		Amplitude = amplitude;
+	}
+
+	void SquareWave::Generate(int16_t* samples, int count, bool on)
+	{
+		float target = on ? 1.0f : 0.0f;
+		for (int i = 0; i < count; ++i)
+		{
+			if (Gain < target)
+				Gain = std::min(target, Gain + GainStep);
+			else if (Gain > target)
+				Gain = std::max(target, Gain - GainStep);
+
+			float level = Phase < 0.5 ? 1.0f : -1.0f;
+			samples[i] = static_cast<int16_t>(level * Gain * Amplitude);
+			Phase += PhaseStep;
+			if (Phase >= 1.0)
+				Phase -= 1.0;
+		}
+	}
+
+	void PatternWave::Configure(int sample_rate, int16_t amplitude)
+	{
+		SampleRate = sample_rate;
+		GainStep = 1.0f / std::max(1, sample_rate / 500);
+		Amplitude = amplitude;
+		BitStep = BitRate(64) / SampleRate;
+	}
+
+	void PatternWave::SetPattern(const std::array<uint8_t, 16>& pattern, uint8_t pitch)
+	{
+		Pattern = pattern;
+		BitStep = BitRate(pitch) / SampleRate;
+	}
+
+	double PatternWave::BitRate(uint8_t pitch)
+	{
+		return 4000.0 * std::pow(2.0, (pitch - 64) / 48.0);
+	}
+
+	void PatternWave::Generate(int16_t* samples, int count, bool on)
+	{
+		float target = on ? 1.0f : 0.0f;
+		for (int i = 0; i < count; ++i)
+		{
+			if (Gain < target)
+				Gain = std::min(target, Gain + GainStep);
+			else if (Gain > target)
+				Gain = std::max(target, Gain - GainStep);
+
+			int bit = static_cast<int>(Position);
+			float level = (Pattern[bit / 8] >> (7 - bit % 8)) & 0x1 ? 1.0f : -1.0f;
+			samples[i] = static_cast<int16_t>(level * Gain * Amplitude);
+			Position += BitStep;
+			if (Position >= 128.0)
+				Position = std::fmod(Position, 128.0);
+		}
+	}
+
+	AudioOutput::~AudioOutput()
+	{
+		Close();
+	}
+
+	bool AudioOutput::Open(int sample_rate, int target_frames, bool device_paced)
+	{
+		Close();
+
+		SDL_AudioSpec desired = {};
+		desired.freq = sample_rate;
+		desired.format = AUDIO_S16SYS;
+		desired.channels = 1;
+		desired.samples = 512;
+		SDL_AudioSpec obtained = {};
+		Device = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+		if (Device == 0)
+		{
+			SDL_Log("Unable to open audio device: %s", SDL_GetError());
+			return false;
+		}
+
+		double samples_per_frame = obtained.freq / 60.0;
+		TargetSamples = static_cast<uint32_t>(samples_per_frame * std::max(1, target_frames));
+		Rate.Configure(samples_per_frame, TargetSamples);
+		DevicePaced = device_paced;
+		Tone.Configure(obtained.freq);
+		Pattern.Configure(obtained.freq);
+		UsePattern = false;
+		Underruns = 0;
+
+		QueueSilence();
+		SDL_PauseAudioDevice(Device, 0);
+		return true;
+	}
+
+	void AudioOutput::QueueSilence()
+	{
+		// Start from the target fill so the first frames cannot starve the device
+		Samples.assign(TargetSamples, 0);
+		SDL_QueueAudio(Device, Samples.data(), static_cast<Uint32>(Samples.size() * sizeof(int16_t)));
+	}
+
+	void AudioOutput::Close()
+	{
+		if (Device == 0)
+			return;
+		SDL_CloseAudioDevice(Device);
+		Device = 0;
+	}
+
+	uint32_t AudioOutput::GetQueuedSamples() const
+	{
+		return Device ? SDL_GetQueuedAudioSize(Device) / sizeof(int16_t) : 0;
+	}
+
+	void AudioOutput::QueueFrame(bool tone_on)
+	{
+		if (Device == 0)
+			return;
+
+		uint32_t queued = GetQueuedSamples();
+		if (queued == 0)
+			Underruns++;
+
+		Samples.resize(DevicePaced ? Rate.NominalFrameSamples() : Rate.NextFrameSamples(queued));
+		if (UsePattern)
+			Pattern.Generate(Samples.data(), static_cast<int>(Samples.size()), tone_on);
+		else
+			Tone.Generate(Samples.data(), static_cast<int>(Samples.size()), tone_on);
+		SDL_QueueAudio(Device, Samples.data(), static_cast<Uint32>(Samples.size() * sizeof(int16_t)));
+	}
+
+	void AudioOutput::SetPattern(const std::array<uint8_t, 16>& pattern, uint8_t pitch)
+	{
+		Pattern.SetPattern(pattern, pitch);
+		UsePattern = true;
+	}
+
+	void AudioOutput::Reset()
+	{
+		if (Device)
+		{
+			SDL_ClearQueuedAudio(Device);
+			QueueSilence();
+		}
+		UsePattern = false;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "SDL.h"
+
+namespace chipotto
+{
+	// Dynamic rate control: nudges the number of samples produced per emulated
+	// frame by at most MaxAdjust so the device queue settles on its target fill.
+	// The fractional part is carried over, so no sample is ever lost to rounding.
+	class AudioRateControl
+	{
+	public:
+		void Configure(double samples_per_frame, uint32_t target_samples, double max_adjust = 0.005);
+
+		int NextFrameSamples(uint32_t queued_samples);
+		// The unadjusted count, for callers whose frames are already timed by the
+		// device; the fraction is carried the same way
+		int NominalFrameSamples();
+		double GetRatio() const { return Ratio; }
+
+	private:
+		double SamplesPerFrame = 800.0;
+		double TargetSamples = 2400.0;
+		double MaxAdjust = 0.005;
+		double Fraction = 0.0;
+		double Ratio = 1.0;
+	};
+
+	// Square wave gated by the sound timer. Gating ramps the gain over a couple of
+	// milliseconds and the phase runs continuously, so frame edges never click.
+	class SquareWave
+	{
+	public:
+		void Configure(int sample_rate, double frequency = 440.0, int16_t amplitude = 6000);
+		void Generate(int16_t* samples, int count, bool on);
+
+	private:
+		double Phase = 0.0;
+		double PhaseStep = 0.0;
+		float Gain = 0.0f;
+		float GainStep = 0.0f;
+		int16_t Amplitude = 0;
+	};
+
+	// XO-CHIP pattern playback: the 128-bit pattern loops most significant bit
+	// first at the bit rate selected by the pitch register, with the same gating
+	// ramp as SquareWave.
+	class PatternWave
+	{
+	public:
+		void Configure(int sample_rate, int16_t amplitude = 6000);
+		void SetPattern(const std::array<uint8_t, 16>& pattern, uint8_t pitch);
+		void Generate(int16_t* samples, int count, bool on);
+
+		// 4000 * 2^((pitch - 64) / 48) bits per second
+		static double BitRate(uint8_t pitch);
+
+	private:
+		std::array<uint8_t, 16> Pattern = {};
+		int SampleRate = 48000;
+		double Position = 0.0;
+		double BitStep = 0.0;
+		float Gain = 0.0f;
+		float GainStep = 0.0f;
+		int16_t Amplitude = 0;
+	};
+
+	class AudioOutput
+	{
+	public:
+		AudioOutput() = default;
+		~AudioOutput();
+
+		AudioOutput(const AudioOutput& other) = delete;
+		AudioOutput& operator=(const AudioOutput& other) = delete;
+
+		// target_frames is the queue fill, in 60 Hz frames, that rate control holds.
+		// A device-paced output has its frames requested through NeedsFrame, which
+		// already keeps the fill at the target: every frame then carries the
+		// nominal sample count, since stretching them would slow emulation down.
+		bool Open(int sample_rate = 48000, int target_frames = 3, bool device_paced = false);
+		void Close();
+		bool IsOpen() const { return Device != 0; }
+
+		// True while the device holds less than its target fill
+		bool NeedsFrame() const { return GetQueuedSamples() < TargetSamples; }
+		void QueueFrame(bool tone_on);
+		// Switches from the square wave to pattern playback, which sticks once set
+		void SetPattern(const std::array<uint8_t, 16>& pattern, uint8_t pitch);
+		// Drops queued samples and goes back to the square wave, for a new program.
+		// The queue is primed with silence again, as by Open.
+		void Reset();
+
+		uint32_t GetQueuedSamples() const;
+		uint64_t GetUnderruns() const { return Underruns; }
+		double GetRateRatio() const { return Rate.GetRatio(); }
+
+	private:
+		void QueueSilence();
+
+		SDL_AudioDeviceID Device = 0;
+		uint32_t TargetSamples = 0;
+		bool DevicePaced = false;
+		AudioRateControl Rate;
+		SquareWave Tone;
+		PatternWave Pattern;
+		bool UsePattern = false;
+		std::vector<int16_t> Samples;
+		uint64_t Underruns = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace chipotto
+{
+	// Fixed-capacity FIFO between one producer and one consumer thread. Slots
+	// are allocated up front, so pushing and popping never allocate.
+	template<typename T>
+	class BoundedQueue
+	{
+	public:
+		explicit BoundedQueue(size_t capacity) : Slots(capacity > 0 ? capacity : 1) {}
+
+		// Returns false instead of waiting when the queue is full
+		bool TryPush(const T& value)
+		{
+			{
+				std::lock_guard<std::mutex> lock(Mutex);
+				if (Closed || Count == Slots.size())
+					return false;
+				PushLocked(value);
+			}
+			NotEmpty.notify_one();
+			return true;
+		}
+
+		bool Push(const T& value)
+		{
+			{
+				std::unique_lock<std::mutex> lock(Mutex);
+				NotFull.wait(lock, [this] { return Closed || Count < Slots.size(); });
+				if (Closed)
+					return false;
+				PushLocked(value);
+			}
+			NotEmpty.notify_one();
+			return true;
+		}
+
+		// Waits for an element; returns false once the queue is closed and drained
+		bool Pop(T& value)
+		{
+			{
+				std::unique_lock<std::mutex> lock(Mutex);
+				NotEmpty.wait(lock, [this] { return Closed || Count > 0; });
+				if (Count == 0)
+					return false;
+				value = Slots[Head];
+				Head = (Head + 1) % Slots.size();
+				Count--;
+			}
+			NotFull.notify_one();
+			return true;
+		}
+
+		void Close()
+		{
+			{
+				std::lock_guard<std::mutex> lock(Mutex);
+				Closed = true;
+			}
+			NotEmpty.notify_all();
+			NotFull.notify_all();
+		}
+
+		size_t GetCapacity() const { return Slots.size(); }
+
+	private:
+		void PushLocked(const T& value)
+		{
+			Slots[(Head + Count) % Slots.size()] = value;
+			Count++;
+		}
+
+		std::vector<T> Slots;
+		size_t Head = 0;
+		size_t Count = 0;
+		bool Closed = false;
+		std::mutex Mutex;
+		std::condition_variable NotEmpty;
+		std::condition_variable NotFull;
+	};
+}
@@ -2,55 +2,22 @@
 
 namespace chipotto
 {
-	Emulator::Emulator()
+	// Host keys of the 1234/QWER/ASDF/ZXCV keypad, in keypad order
+	static const std::array<SDL_Keycode, 0x10> KeypadKeys = {
+		SDLK_1, SDLK_2, SDLK_3, SDLK_4,
+		SDLK_q, SDLK_w, SDLK_e, SDLK_r,
+		SDLK_a, SDLK_s, SDLK_d, SDLK_f,
+		SDLK_z, SDLK_x, SDLK_c, SDLK_v
+	};
+
+	Emulator::Emulator(VideoBackend backend, TerminalGlyphs glyphs) : Backend(backend), ScreenTerminal(glyphs)
 	{
-		KeyboardMap[SDLK_1] = 0x0;
-		KeyboardMap[SDLK_2] = 0x1;
-		KeyboardMap[SDLK_3] = 0x2;
-		KeyboardMap[SDLK_4] = 0x3;
-		KeyboardMap[SDLK_q] = 0x4;
-		KeyboardMap[SDLK_w] = 0x5;
-		KeyboardMap[SDLK_e] = 0x6;
-		KeyboardMap[SDLK_r] = 0x7;
-		KeyboardMap[SDLK_a] = 0x8;
-		KeyboardMap[SDLK_s] = 0x9;
-		KeyboardMap[SDLK_d] = 0xA;
-		KeyboardMap[SDLK_f] = 0xB;
-		KeyboardMap[SDLK_z] = 0xC;
-		KeyboardMap[SDLK_x] = 0xD;
-		KeyboardMap[SDLK_c] = 0xE;
-		KeyboardMap[SDLK_v] = 0xF;
-
-		for (const auto &pair : KeyboardMap)
-		{
-			KeyboardValuesMap[pair.second] = static_cast<SDL_Scancode>(pair.first);
-		}
+		SetKeyLayout(DefaultKeyLayout);
+
+		if (Backend == VideoBackend::Terminal)
+			return;
 
-		Opcodes[0x0] = std::bind(&Emulator::Opcode0, this, std::placeholders::_1);
-		Opcodes[0x1] = std::bind(&Emulator::Opcode1, this, std::placeholders::_1);
-		Opcodes[0x2] = std::bind(&Emulator::Opcode2, this, std::placeholders::_1);
-		Opcodes[0x3] = std::bind(&Emulator::Opcode3, this, std::placeholders::_1);
-		Opcodes[0x4] = std::bind(&Emulator::Opcode4, this, std::placeholders::_1);
-		Opcodes[0x5] = std::bind(&Emulator::Opcode5, this, std::placeholders::_1);
-		Opcodes[0x6] = std::bind(&Emulator::Opcode6, this, std::placeholders::_1);
-		Opcodes[0x7] = std::bind(&Emulator::Opcode7, this, std::placeholders::_1);
-		Opcodes[0x8] = std::bind(&Emulator::Opcode8, this, std::placeholders::_1);
-		Opcodes[0x9] = std::bind(&Emulator::Opcode9, this, std::placeholders::_1);
-		Opcodes[0xA] = std::bind(&Emulator::OpcodeA, this, std::placeholders::_1);
-		Opcodes[0xB] = std::bind(&Emulator::OpcodeB, this, std::placeholders::_1);
-		Opcodes[0xC] = std::bind(&Emulator::OpcodeC, this, std::placeholders::_1);
-		Opcodes[0xD] = std::bind(&Emulator::OpcodeD, this, std::placeholders::_1);
-		Opcodes[0xE] = std::bind(&Emulator::OpcodeE, this, std::placeholders::_1);
-		Opcodes[0xF] = std::bind(&Emulator::OpcodeF, this, std::placeholders::_1);
-
-		// FINISH IMPLEMENTATION OF SPRITES
-		MemoryMapping[0x0] = 0xF0;
-		MemoryMapping[0x1] = 0x90;
-		MemoryMapping[0x2] = 0x90;
-		MemoryMapping[0x3] = 0x90;
-		MemoryMapping[0x4] = 0xF0;
-
-		Window = SDL_CreateWindow("Chip-8", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, Width * 10, Height * 10, 0);
+		Window = SDL_CreateWindow("Chip-8", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, Display::LowResWidth * WindowScale, Display::LowResHeight * WindowScale, 0);
 		if (!Window)
 		{
 			SDL_Log("Unable to create window: %s", SDL_GetError());
@@ -63,7 +30,7 @@ namespace chipotto
 			SDL_DestroyWindow(Window);
 			return;
 		}
-		Texture = SDL_CreateTexture(Renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, Width, Height);
+		Texture = SDL_CreateTexture(Renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, Display::MaxWidth, Display::MaxHeight);
 		if (!Texture)
 		{
 			SDL_Log("Unable to create texture: %s", SDL_GetError());
@@ -71,479 +38,421 @@ namespace chipotto
 			SDL_DestroyWindow(Window);
 			return;
 		}
-	}
-
-	bool Emulator::LoadFromFile(std::filesystem::path Path)
-	{
-		std::ifstream file;
-		file.open(Path, std::ios::binary);
-		if (!file.is_open())
-			return false;
-
-		auto file_size = std::filesystem::file_size(Path);
-
-		file.read(reinterpret_cast<char *>(MemoryMapping.data() + PC), file_size);
-		file.close();
-	}
+		ScreenPresenter.Attach(Renderer, Texture);
 
-	void Emulator::LoadFromBuffer(uint16_t *opcodes, size_t size)
-	{
-		memcpy((MemoryMapping.data() + PC), opcodes, size * sizeof(uint16_t));
+		// Without a GPU the renderer would stretch the texture pixel by pixel on a
+		// single thread: scale on our own workers straight into a window-sized texture.
+		SDL_RendererInfo renderer_info;
+		if (SDL_GetRendererInfo(Renderer, &renderer_info) == 0 && (renderer_info.flags & SDL_RENDERER_SOFTWARE))
+		{
+			EnableSoftwareUpscaler(UpscaleFilter::Nearest);
+		}
 	}
 
-	bool Emulator::Tick()
+	bool Emulator::StartUpscaler(UpscaleFilter filter, int thread_count)
 	{
-		uint64_t tick = SDL_GetTicks64();
-
-		if (DelayTimer > 0 && tick >= DeltaTimerTicks)
-		{
-			DelayTimer--;
-			DeltaTimerTicks = 17 + SDL_GetTicks64();
-		}
+		if (!Renderer)
+			return false;
 
-		SDL_Event event;
-		while (SDL_PollEvent(&event))
+		if (!UpscaledTexture)
 		{
-			if (event.type == SDL_KEYDOWN)
-			{
-				SDL_Keycode key = event.key.keysym.sym;
-				if (KeyboardMap.contains(key))
-				{
-					Registers[WaitForKeyboardRegister_Index] = KeyboardMap[key];
-					Suspended = false;
-					PC += 2;
-				}
-			}
-			if (event.type == SDL_QUIT)
+			UpscaledTexture = SDL_CreateTexture(Renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, Display::LowResWidth * WindowScale, Display::LowResHeight * WindowScale);
+			if (!UpscaledTexture)
 			{
+				SDL_Log("Unable to create upscaled texture: %s", SDL_GetError());
 				return false;
 			}
 		}
-		SDL_PumpEvents();
-
-		if (Suspended)
-			return true;
 
-		uint16_t offset = static_cast<uint16_t>(MemoryMapping[PC]) << 8;
-		uint16_t opcode = MemoryMapping[PC + 1] + (offset);
-		std::cout << std::hex << "0x" << PC << ": 0x" << opcode << "  -->  ";
-
-		OpcodeStatus status = Opcodes[opcode >> 12](opcode);
-
-		std::cout << std::endl;
-		if (status == OpcodeStatus::IncrementPC)
-		{
-			PC += 2;
-		}
-		return status != OpcodeStatus::NotImplemented && status != OpcodeStatus::StackOverflow && status != OpcodeStatus::Error;
+		// ROMs with a display mode switch filters on every load: keep the workers
+		// unless a different count is asked for
+		if (!UpscalePool || (thread_count > 0 && thread_count != UpscalePool->GetThreadCount()))
+			UpscalePool = std::make_unique<WorkerPool>(thread_count);
+		ScreenPresenter.EnableUpscaling(UpscaledTexture, WindowScale, filter, UpscalePool.get());
+		return true;
 	}
 
-	bool Emulator::IsValid() const
+	bool Emulator::EnableSoftwareUpscaler(UpscaleFilter filter, int thread_count)
 	{
-		if (!Window || !Renderer || !Texture)
+		if (!StartUpscaler(filter, thread_count))
 			return false;
+		BaselineUpscaling = true;
+		BaselineFilter = filter;
 		return true;
 	}
 
-	OpcodeStatus Emulator::Opcode0(const uint16_t opcode)
-	{
-		if ((opcode & 0xFF) == 0xE0)
-		{
-			std::cout << "CLS";
-			uint8_t *pixels = nullptr;
-			int pitch;
-			int result = SDL_LockTexture(Texture, nullptr, reinterpret_cast<void **>(&pixels), &pitch);
-			memset(pixels, 0, pitch * Height);
-			SDL_UnlockTexture(Texture);
-			SDL_RenderCopy(Renderer, Texture, nullptr, nullptr);
-			SDL_RenderPresent(Renderer);
-			return OpcodeStatus::IncrementPC;
-		}
-		else if ((opcode & 0xFF) == 0xEE)
-		{
-			if (SP > 0xF && SP < 0xFF)
-				return OpcodeStatus::StackOverflow;
-			std::cout << "RET";
-			PC = Stack[SP & 0xF];
-			SP -= 1;
-			return OpcodeStatus::IncrementPC;
-		}
-		return OpcodeStatus::NotImplemented;
-	}
-
-	OpcodeStatus Emulator::Opcode1(const uint16_t opcode)
+	void Emulator::RestoreBaselineUpscaler()
 	{
-		uint16_t address = opcode & 0x0FFF;
-		std::cout << "JP 0x" << address;
-		PC = address - 2;
-		return OpcodeStatus::IncrementPC;
+		if (BaselineUpscaling)
+			StartUpscaler(BaselineFilter, 0);
+		else
+			ScreenPresenter.DisableUpscaling();
 	}
 
-	OpcodeStatus Emulator::Opcode2(const uint16_t opcode)
+	void Emulator::SetKeyLayout(const std::array<uint8_t, 0x10>& layout)
 	{
-		uint16_t address = opcode & 0xFFF;
-		std::cout << "CALL 0x" << (int)address;
-		if (SP > 0xF)
-		{
-			SP = 0;
-		}
-		else
+		for (uint8_t key = 0; key < 0x10; ++key)
 		{
-			if (SP < 0xF)
-			{
-				SP += 1;
-			}
-			else
-			{
-				return OpcodeStatus::StackOverflow;
-			}
+			KeyboardMap[key] = KeypadKeys[layout[key] & 0xF];
+			KeyboardValuesMap[key] = static_cast<SDL_Scancode>(KeyboardMap[key]);
 		}
-		Stack[SP] = PC;
-		PC = address;
-		return OpcodeStatus::NotIncrementPC;
 	}
 
-	OpcodeStatus Emulator::Opcode3(const uint16_t opcode)
+	bool Emulator::OpenRomDatabase(const std::filesystem::path& path)
 	{
-		uint8_t register_index = (opcode >> 8) & 0xF;
-		uint8_t value = opcode & 0xFF;
-		std::cout << "SE V" << (int)register_index << ", 0x" << (int)value;
-		if (Registers[register_index] == value)
-			PC += 2;
-		return OpcodeStatus::IncrementPC;
+		return Database.Open(path);
 	}
 
-	OpcodeStatus Emulator::Opcode4(const uint16_t opcode)
+	bool Emulator::LoadFromFile(std::filesystem::path Path)
 	{
-		uint8_t register_index = (opcode >> 8) & 0xF;
-		uint8_t value = opcode & 0xFF;
-		std::cout << "SNE V" << (int)register_index << ", 0x" << (int)value;
-		if (Registers[register_index] != value)
-			PC += 2;
-		return OpcodeStatus::IncrementPC;
+		if (!Core.LoadFromFile(Path))
+			return false;
+		ApplyRomSettings();
+		Core.MakeMemoryPrivate();
+		return true;
 	}
 
-	OpcodeStatus Emulator::Opcode5(const uint16_t opcode)
+	bool Emulator::LoadFromSpan(std::span<const std::byte> rom)
 	{
-		uint8_t register_x_index = (opcode >> 8) & 0xF;
-		uint8_t register_y_index = (opcode >> 4) & 0xF;
-		std::cout << "SE V" << (int)register_x_index << ", V" << (int)register_y_index;
-		if (Registers[register_x_index] == Registers[register_y_index])
-			PC += 2;
-		return OpcodeStatus::IncrementPC;
+		if (!Core.LoadFromSpan(rom))
+			return false;
+		ApplyRomSettings();
+		Core.MakeMemoryPrivate();
+		return true;
 	}
 
-	OpcodeStatus Emulator::Opcode6(const uint16_t opcode)
+	bool Emulator::LoadFromImage(std::shared_ptr<const RomImage> image)
 	{
-		uint8_t register_index = (opcode >> 8) & 0xF;
-		uint8_t register_value = opcode & 0xFF;
-		Registers[register_index] = register_value;
-		std::cout << "LD V" << (int)register_index << ", 0x" << (int)register_value;
-		return OpcodeStatus::IncrementPC;
+		if (!Core.LoadFromImage(std::move(image)))
+			return false;
+		ApplyRomSettings();
+		Core.MakeMemoryPrivate();
+		return true;
 	}
 
-	OpcodeStatus Emulator::Opcode7(const uint16_t opcode)
+	void Emulator::ApplyRomSettings()
 	{
-		uint8_t register_index = (opcode >> 8) & 0xF;
-		uint8_t value = opcode & 0xFF;
-		std::cout << "ADD V" << (int)register_index << ", 0x" << (int)value;
-		Registers[register_index] += value;
-		return OpcodeStatus::IncrementPC;
+		const RomDatabaseEntry* entry = Database.Find(Core.GetRomHash());
+		if (!entry)
+			return;
+
+		Core.SetQuirks(entry->Quirks);
+		if (entry->InstructionsPerFrame)
+			InstructionsPerFrame = entry->InstructionsPerFrame;
+		SetKeyLayout(entry->KeyLayout);
+		RomSettingsApplied = true;
+		switch (entry->DisplayMode)
+		{
+		case RomDisplayMode::Nearest:
+			StartUpscaler(UpscaleFilter::Nearest, 0);
+			break;
+		case RomDisplayMode::Scale2x:
+			StartUpscaler(UpscaleFilter::Scale2x, 0);
+			break;
+		case RomDisplayMode::Scale4x:
+			StartUpscaler(UpscaleFilter::Scale4x, 0);
+			break;
+		default:
+			break;
+		}
 	}
 
-	OpcodeStatus Emulator::Opcode8(const uint16_t opcode)
+	void Emulator::Reset()
 	{
-		if ((opcode & 0xF) == 0x0)
-		{
-			uint8_t register_x_index = (opcode >> 8) & 0xF;
-			uint8_t register_y_index = (opcode >> 4) & 0xF;
-			Registers[register_x_index] = Registers[register_y_index];
-			std::cout << "LD V" << (int)register_x_index << ", V" << (int)register_y_index;
-			return OpcodeStatus::IncrementPC;
-		}
-		else if ((opcode & 0xF) == 0x1)
-		{
-			uint8_t register_x_index = (opcode >> 8) & 0xF;
-			uint8_t register_y_index = (opcode >> 4) & 0xF;
-			Registers[register_x_index] |= Registers[register_y_index];
-			std::cout << "OR V" << (int)register_x_index << ", V" << (int)register_y_index;
-			return OpcodeStatus::IncrementPC;
-		}
-		else if ((opcode & 0xF) == 0x2)
-		{
-			uint8_t register_x_index = (opcode >> 8) & 0xF;
-			uint8_t register_y_index = (opcode >> 4) & 0xF;
-			Registers[register_x_index] &= Registers[register_y_index];
-			std::cout << "AND V" << (int)register_x_index << ", V" << (int)register_y_index;
-			return OpcodeStatus::IncrementPC;
-		}
-		else if ((opcode & 0xF) == 0x3)
-		{
-			uint8_t register_x_index = (opcode >> 8) & 0xF;
-			uint8_t register_y_index = (opcode >> 4) & 0xF;
-			Registers[register_x_index] ^= Registers[register_y_index];
-			std::cout << "XOR V" << (int)register_x_index << ", V" << (int)register_y_index;
-			return OpcodeStatus::IncrementPC;
-		}
-		else if ((opcode & 0xF) == 0x4)
-		{
-			uint8_t register_x_index = (opcode >> 8) & 0xF;
-			uint8_t register_y_index = (opcode >> 4) & 0xF;
-			int result = static_cast<int>(Registers[register_x_index]) + Registers[register_y_index];
-			if (result > 255)
-				Registers[0xF] = 1;
-			else
-				Registers[0xF] = 0;
-			Registers[register_x_index] += Registers[register_y_index];
-			std::cout << "ADD V" << (int)register_x_index << ", V" << (int)register_y_index;
-			return OpcodeStatus::IncrementPC;
-		}
-		else if ((opcode & 0xF) == 0x5)
-		{
-			uint8_t register_x_index = (opcode >> 8) & 0xF;
-			uint8_t register_y_index = (opcode >> 4) & 0xF;
-			if (Registers[register_x_index] > Registers[register_y_index])
-				Registers[0xF] = 1;
-			else
-				Registers[0xF] = 0;
-			Registers[register_x_index] -= Registers[register_y_index];
-			std::cout << "SUB V" << (int)register_x_index << ", V" << (int)register_y_index;
-			return OpcodeStatus::IncrementPC;
-		}
-		else if ((opcode & 0xF) == 0x6)
-		{
-			uint8_t register_x_index = (opcode >> 8) & 0xF;
-			uint8_t register_y_index = (opcode >> 4) & 0xF;
-			Registers[0xF] = Registers[register_x_index] & 0x1;
-			Registers[register_x_index] >>= 1;
-			std::cout << "SHR V" << (int)register_x_index << "{, V" << (int)register_y_index << "}";
-			return OpcodeStatus::IncrementPC;
-		}
-		else if ((opcode & 0xF) == 0x7)
-		{
-			uint8_t register_x_index = (opcode >> 8) & 0xF;
-			uint8_t register_y_index = (opcode >> 4) & 0xF;
-			if (Registers[register_y_index] > Registers[register_x_index])
-				Registers[0xF] = 1;
-			else
-				Registers[0xF] = 0;
-			Registers[register_y_index] -= Registers[register_x_index];
-			std::cout << "SUBN V" << (int)register_x_index << ", V" << (int)register_y_index;
-			return OpcodeStatus::IncrementPC;
-		}
-		else if ((opcode & 0xF) == 0xE)
-		{
-			uint8_t register_x_index = (opcode >> 8) & 0xF;
-			uint8_t register_y_index = (opcode >> 4) & 0xF;
-			Registers[0xF] = Registers[register_x_index] >> 7;
-			Registers[register_x_index] <<= 1;
-			std::cout << "SHL V" << (int)register_x_index << "{, V" << (int)register_y_index << "}";
-			return OpcodeStatus::IncrementPC;
-		}
-		else
-		{
-			return OpcodeStatus::NotImplemented;
-		}
+		Core.Reset();
+		if (RomSettingsApplied)
+		{
+			Core.SetQuirks(QuirkProfile::Modern);
+			InstructionsPerFrame = BaseInstructionsPerFrame;
+			SetKeyLayout(DefaultKeyLayout);
+			RestoreBaselineUpscaler();
+			RomSettingsApplied = false;
+		}
+
+		FrameSteps = 0;
+		Pacer.Reset();
+		if (Audio)
+			Audio->Reset();
+		ScreenPresenter.Invalidate();
+		ScreenTerminal.Invalidate();
 	}
 
-	OpcodeStatus Emulator::Opcode9(const uint16_t opcode)
+	bool Emulator::LoadRom(const std::filesystem::path& path)
 	{
-		uint8_t register_x_index = (opcode >> 8) & 0xF;
-		uint8_t register_y_index = (opcode >> 4) & 0xF;
-		std::cout << "SNE V" << (int)register_x_index << ", V" << (int)register_y_index;
-		if (Registers[register_x_index] != Registers[register_y_index])
-			PC += 2;
-		return OpcodeStatus::IncrementPC;
+		Reset();
+		return LoadFromFile(path);
 	}
 
-	OpcodeStatus Emulator::OpcodeA(const uint16_t opcode)
+	bool Emulator::BootFromCache(SnapshotCache& cache, int frame_limit)
 	{
-		uint16_t value = (opcode & 0xFFF);
-		std::cout << "LD I, 0x" << (int)value;
-		I = value;
-		return OpcodeStatus::IncrementPC;
+		if (!cache.Boot(Core, InstructionsPerFrame, frame_limit))
+			return false;
+		Core.MakeMemoryPrivate();
+		ScreenPresenter.Invalidate();
+		ScreenTerminal.Invalidate();
+		return true;
 	}
 
-	OpcodeStatus Emulator::OpcodeB(const uint16_t opcode)
+	bool Emulator::LoadFromBuffer(const uint16_t *opcodes, size_t size)
 	{
-		uint16_t address = opcode & 0x0fff;
-		PC = address + Registers[0];
-		return OpcodeStatus::NotIncrementPC;
+		if (!Core.LoadFromBuffer(opcodes, size))
+			return false;
+		ApplyRomSettings();
+		Core.MakeMemoryPrivate();
+		return true;
 	}
 
-	OpcodeStatus Emulator::OpcodeC(const uint16_t opcode)
+	bool Emulator::Tick()
 	{
-		uint8_t register_index = (opcode >> 8) & 0xF;
-		uint8_t random_mask = opcode & 0xFF;
-		std::cout << "RND V" << (int)register_index << ", 0x" << (int)random_mask;
-		Registers[register_index] = (std::rand() % 256) & random_mask;
-		return OpcodeStatus::IncrementPC;
+		if (Audio && PaceFromAudio)
+			return TickAudioPaced();
+
+		if (!PollEvents())
+			return false;
+		UpdateKeys();
+
+		// InstructionsPerFrame is the frame's budget: once it is spent, ticks
+		// only wait for the next frame, so the speed holds on any host
+		OpcodeStatus status = OpcodeStatus::IncrementPC;
+		bool stepped = FrameSteps < InstructionsPerFrame;
+		if (stepped)
+		{
+			status = Core.Step();
+			FrameSteps++;
+		}
+
+		// Late frames are dropped without touching the texture, so a slow host
+		// loses smoothness instead of emulation speed.
+		FrameAction frame_action = Pacer.Advance(SDL_GetTicks64());
+		// Timers and audio follow the pacer's frame deadlines, which accumulate
+		// from the first frame instead of restarting at each tick, so they keep
+		// a true 60 Hz and the audio queue is fed as fast as it drains. The
+		// first frame only starts the clock.
+		if (frame_action != FrameAction::None && Pacer.GetFrameCount() > 1)
+		{
+			// A late frame still runs its whole budget before it is left behind,
+			// so a slow host loses smoothness rather than emulation speed
+			while (FrameSteps < InstructionsPerFrame && IsRunning(status) && !Core.IsWaitingForKey())
+			{
+				status = Core.Step();
+				FrameSteps++;
+			}
+			Core.TickTimers();
+			if (Audio)
+				QueueAudioFrame(Core.GetSoundTimer() > 0);
+			FrameSteps = 0;
+		}
+		if (!EndFrame(frame_action))
+			status = OpcodeStatus::Error;
+		else if (!stepped && frame_action == FrameAction::None)
+			SDL_Delay(1);
+
+		return IsRunning(status);
 	}
 
-	OpcodeStatus Emulator::OpcodeD(const uint16_t opcode)
+	bool Emulator::TickAudioPaced()
 	{
-		uint8_t register_x_index = (opcode >> 8) & 0xF;
-		uint8_t register_y_index = (opcode >> 4) & 0xF;
-		uint8_t sprite_height = opcode & 0xF;
-		std::cout << "DRW V" << (int)register_x_index << ", V" << (int)register_y_index << ", " << (int)sprite_height;
-
-		uint8_t x_coord = Registers[register_x_index] % Width;
-		uint8_t y_coord = Registers[register_y_index] % Height;
-
-		uint8_t *pixels = nullptr;
-		int pitch;
-		int result = SDL_LockTexture(Texture, nullptr, reinterpret_cast<void **>(&pixels), &pitch);
-		if (result != 0)
+		if (!PollEvents())
+			return false;
+
+		// The audio device clock decides when the next frame is due: vsync and
+		// the tick counter never come into it, so the two cannot drift apart.
+		if (!Audio->NeedsFrame())
 		{
-			SDL_Log("Failed to lock texture");
-			return OpcodeStatus::Error;
+			SDL_Delay(1);
+			return true;
 		}
+		UpdateKeys();
 
-		for (int y = 0; y < sprite_height; ++y)
+		OpcodeStatus status = OpcodeStatus::IncrementPC;
+		for (int step = 0; step < InstructionsPerFrame && !Core.IsWaitingForKey(); ++step)
 		{
-			if (y + y_coord >= Height)
-				break;
-			uint8_t row_byte = MemoryMapping[I + y];
-			for (int x = 0; x < 8; x++)
-			{
-				uint8_t pixel_color = (row_byte >> (7 - x)) & 0x1;
-				uint8_t color = 0;
-				if (pixel_color)
-				{
-					color = 0xFF;
-				}
-				if (x + x_coord >= Width)
-					break;
-				int pixel_index = (x + x_coord) * 4 + pitch * (y + y_coord);
-				uint8_t existing_pixel = pixels[pixel_index];
-				color ^= existing_pixel;
-
-				if (existing_pixel != 0 && color != 0)
-				{
-					Registers[0xF] = 0x1;
-				}
-
-				pixels[pixel_index + 0] = color;
-				pixels[pixel_index + 1] = color;
-				pixels[pixel_index + 2] = color;
-				pixels[pixel_index + 3] = color;
-			}
+			status = Core.Step();
+			if (!IsRunning(status))
+				return false;
 		}
 
-		SDL_UnlockTexture(Texture);
+		bool tone_on = Core.GetSoundTimer() > 0;
+		Core.TickTimers();
+		QueueAudioFrame(tone_on);
 
-		SDL_RenderCopy(Renderer, Texture, nullptr, nullptr);
-		SDL_RenderPresent(Renderer);
+		return EndFrame(FrameAction::Present);
+	}
 
-		return OpcodeStatus::IncrementPC;
+	void Emulator::QueueAudioFrame(bool tone_on)
+	{
+		if (Core.HasAudioPattern())
+			Audio->SetPattern(Core.GetAudioPattern(), Core.GetPitch());
+		Audio->QueueFrame(tone_on);
 	}
 
-	OpcodeStatus Emulator::OpcodeE(const uint16_t opcode)
+	bool Emulator::PollEvents()
 	{
-		if ((opcode & 0xFF) == 0xA1)
+		SDL_Event event;
+		while (SDL_PollEvent(&event))
 		{
-			uint8_t register_index = (opcode >> 8) & 0xF;
-			std::cout << "SKNP V" << (int)register_index;
-			const uint8_t *keysState = SDL_GetKeyboardState(nullptr);
-			if (keysState[KeyboardValuesMap[Registers[register_index]]] == 0)
+			if (event.type == SDL_KEYDOWN)
 			{
-				PC += 2;
+				auto key = std::find(KeyboardMap.begin(), KeyboardMap.end(), event.key.keysym.sym);
+				if (key != KeyboardMap.end())
+				{
+					Core.CompleteKeyWait(static_cast<uint8_t>(key - KeyboardMap.begin()));
+				}
 			}
-			return OpcodeStatus::IncrementPC;
-		}
-		else if ((opcode & 0xFF) == 0x9E)
-		{
-			uint8_t register_index = (opcode >> 8) & 0xF;
-			std::cout << "SKP V" << (int)register_index;
-			const uint8_t *keysState = SDL_GetKeyboardState(nullptr);
-			if (keysState[KeyboardValuesMap[Registers[register_index]]] == 1)
+			if (event.type == SDL_QUIT)
 			{
-				PC += 2;
+				return false;
 			}
-			return OpcodeStatus::IncrementPC;
 		}
-		return OpcodeStatus::NotImplemented;
+		SDL_PumpEvents();
+		return true;
 	}
 
-	OpcodeStatus Emulator::OpcodeF(const uint16_t opcode)
+	void Emulator::UpdateKeys()
 	{
-		if ((opcode & 0xFF) == 0x55)
+		const uint8_t *keys_state = SDL_GetKeyboardState(nullptr);
+		uint16_t keys = 0;
+		for (uint8_t key = 0; key < 0x10; ++key)
 		{
-			uint8_t register_index = (opcode >> 8) & 0xF;
-			std::cout << "LD [I], V" << (int)register_index;
-			for (uint8_t i = 0; i <= register_index; ++i)
-			{
-				MemoryMapping[I + i] = Registers[i];
-			}
-			return OpcodeStatus::IncrementPC;
+			if (keys_state[KeyboardValuesMap[key]])
+				keys |= 1 << key;
+		}
+		Core.SetKeys(keys);
+	}
+
+	bool Emulator::EndFrame(FrameAction frame_action)
+	{
+		if (frame_action == FrameAction::None)
+			return true;
+
+		FrameNumber++;
+		if (SharedScreen)
+		{
+			PublishSharedFrame();
 		}
-		else if ((opcode & 0xFF) == 0x65)
+		if (Recorder)
 		{
-			uint8_t register_index = (opcode >> 8) & 0xF;
-			std::cout << "LD V" << (int)register_index << ", [I]";
-			for (uint8_t i = 0; i <= register_index; ++i)
-			{
-				Registers[i] = MemoryMapping[I + i];
-			}
-			return OpcodeStatus::IncrementPC;
+			Recorder->Submit(Core.GetDisplay());
 		}
-		else if ((opcode & 0xFF) == 0x33)
+		if (Capture)
 		{
-			uint8_t register_index = (opcode >> 8) & 0xF;
-			uint8_t value = Registers[register_index];
-			MemoryMapping[I] = value / 100;
-			MemoryMapping[I + 1] = (value - (MemoryMapping[I] * 100)) / 10;
-			MemoryMapping[I + 2] = value % 10;
-			std::cout << "LD B, V" << (int)register_index;
-			return OpcodeStatus::IncrementPC;
+			Capture->Submit(Core.GetDisplay());
 		}
-		else if ((opcode & 0xFF) == 0x29)
+		if (frame_action == FrameAction::Present && Core.GetDisplay().IsDirty())
 		{
-			uint8_t register_index = (opcode >> 8) & 0xF;
-			std::cout << "LD F, V" << (int)register_index;
-			I = 5 * Registers[register_index];
-			return OpcodeStatus::IncrementPC;
+			return Present();
 		}
-		else if ((opcode & 0xFF) == 0x0A)
+		return true;
+	}
+
+	bool Emulator::EnableAudio(bool pace_from_audio, int sample_rate)
+	{
+		auto audio = std::make_unique<AudioOutput>();
+		if (!audio->Open(sample_rate, 3, pace_from_audio))
+			return false;
+
+		// Presenting must never block on the display when audio sets the pace
+		if (pace_from_audio && Renderer)
+			SDL_RenderSetVSync(Renderer, 0);
+
+		Audio = std::move(audio);
+		PaceFromAudio = pace_from_audio;
+		return true;
+	}
+
+	Emulator::~Emulator()
+	{
+		if (Backend == VideoBackend::Terminal)
 		{
-			uint8_t register_index = (opcode >> 8) & 0xF;
-			std::cout << "LD V" << (int)register_index << ", K";
-			WaitForKeyboardRegister_Index = register_index;
-			Suspended = true;
-			return OpcodeStatus::WaitForKeyboard;
+			TerminalOutput.clear();
+			ScreenTerminal.Finish(TerminalOutput);
+			fwrite(TerminalOutput.data(), 1, TerminalOutput.size(), stdout);
+			fflush(stdout);
 		}
-		else if ((opcode & 0xFF) == 0x1E)
+	}
+
+	bool Emulator::IsValid() const
+	{
+		if (Backend == VideoBackend::Terminal)
+			return true;
+		if (!Window || !Renderer || !Texture)
+			return false;
+		return true;
+	}
+
+	bool Emulator::EnableSharedFramebuffer(const std::string& name)
+	{
+		auto shared_screen = std::make_unique<SharedFramebuffer>();
+		if (!shared_screen->Create(name))
 		{
-			uint8_t register_index = (opcode >> 8) & 0xF;
-			std::cout << "ADD I, V" << (int)register_index;
-			I += Registers[register_index];
-			return OpcodeStatus::IncrementPC;
+			SDL_Log("Unable to create shared framebuffer %s", name.c_str());
+			return false;
 		}
-		else if ((opcode & 0xFF) == 0x18)
+		SharedScreen = std::move(shared_screen);
+		return true;
+	}
+
+	bool Emulator::StartRecording(const std::filesystem::path& path, uint32_t keyframe_interval)
+	{
+		auto recorder = std::make_unique<FrameStreamWriter>();
+		if (!recorder->Open(path, keyframe_interval))
 		{
-			uint8_t register_index = (opcode >> 8) & 0xF;
-			std::cout << "LD ST, V" << (int)register_index;
-			SoundTimer = Registers[register_index];
-			return OpcodeStatus::IncrementPC;
+			SDL_Log("Unable to open recording %s", path.string().c_str());
+			return false;
 		}
-		else if ((opcode & 0xFF) == 0x15)
+		Recorder = std::move(recorder);
+		return true;
+	}
+
+	void Emulator::StopRecording()
+	{
+		Recorder.reset();
+	}
+
+	bool Emulator::StartCapture(const std::filesystem::path& path, const CaptureOptions& options)
+	{
+		auto capture = std::make_unique<VideoCapture>();
+		if (!capture->Open(path, options))
 		{
-			uint8_t register_index = (opcode >> 8) & 0xF;
-			std::cout << "LD DT, V" << (int)register_index;
-			DelayTimer = Registers[register_index];
-			DeltaTimerTicks = 17 + SDL_GetTicks64();
-			return OpcodeStatus::IncrementPC;
+			SDL_Log("Unable to open capture %s", path.string().c_str());
+			return false;
 		}
-		else if ((opcode & 0xFF) == 0x07)
+		Capture = std::move(capture);
+		return true;
+	}
+
+	void Emulator::StopCapture()
+	{
+		Capture.reset();
+	}
+
+	void Emulator::PublishSharedFrame()
+	{
+		SharedFrameState state;
+		state.FrameNumber = FrameNumber;
+		state.PC = Core.GetPC();
+		state.I = Core.GetI();
+		state.SP = Core.GetSP();
+		state.DelayTimer = Core.GetDelayTimer();
+		state.SoundTimer = Core.GetSoundTimer();
+		state.Registers = Core.GetRegisters();
+		SharedScreen->Publish(Core.GetDisplay(), state);
+	}
+
+	bool Emulator::Present()
+	{
+		if (Backend == VideoBackend::Terminal)
 		{
-			uint8_t register_index = (opcode >> 8) & 0xF;
-			std::cout << "LD V" << (int)register_index << ", DT";
-			Registers[register_index] = DelayTimer;
-			return OpcodeStatus::IncrementPC;
+			TerminalOutput.clear();
+			ScreenTerminal.Render(Core.GetDisplay(), TerminalOutput);
+			fwrite(TerminalOutput.data(), 1, TerminalOutput.size(), stdout);
+			fflush(stdout);
 		}
-		else
+		else if (!ScreenPresenter.Present(Core.GetDisplay()))
 		{
-			return OpcodeStatus::NotImplemented;
+			return false;
 		}
+		Core.GetDisplay().ClearDirty();
+		return true;
 	}
-}
+}
\ No newline at end of file
@@ -1,100 +1,170 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <cstdio>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <functional>
-#include <unordered_map>
+#include <memory>
+#include <span>
+#include <string>
 
 #include "SDL.h"
 
+#include "audio_output.h"
+#include "display.h"
+#include "frame_pacer.h"
+#include "frame_stream.h"
+#include "machine.h"
+#include "presenter.h"
+#include "rom_database.h"
+#include "rom_image.h"
+#include "shared_framebuffer.h"
+#include "snapshot_cache.h"
+#include "terminal_renderer.h"
+#include "video_capture.h"
+#include "worker_pool.h"
+
 namespace chipotto
 {
-	enum class OpcodeStatus
+	enum class VideoBackend
 	{
-		IncrementPC,
-		NotIncrementPC,
-		NotImplemented,
-		StackOverflow,
-		WaitForKeyboard,
-		Error
+		Window,
+		Terminal
 	};
 
 	class Emulator
 	{
 	public:
-		Emulator();
-		~Emulator() = default;
+		Emulator(VideoBackend backend = VideoBackend::Window, TerminalGlyphs glyphs = TerminalGlyphs::HalfBlock);
+		~Emulator();
 
 		Emulator(const Emulator& other) = delete;
 		Emulator& operator=(const Emulator& other) = delete;
 		Emulator(Emulator&& other) = delete;
+		// Known ROMs get their quirks, speed, key layout and display mode from the
+		// database when they are loaded
+		bool OpenRomDatabase(const std::filesystem::path& path);
+		// Every loader ends by making guest memory private, so the frames that
+		// follow never allocate
 		bool LoadFromFile(std::filesystem::path Path);
-		void LoadFromBuffer(uint16_t* buf, size_t size);
+		bool LoadFromSpan(std::span<const std::byte> rom);
+		bool LoadFromImage(std::shared_ptr<const RomImage> image);
+		bool LoadFromBuffer(const uint16_t* buf, size_t size);
+		// Starts over with a fresh machine while the window, renderer, texture,
+		// audio device and any recording stay open. Settings taken from the ROM
+		// database for the previous program are undone.
+		void Reset();
+		// Reset, then LoadFromFile
+		bool LoadRom(const std::filesystem::path& path);
+		// Jumps a freshly loaded ROM to its post-boot state (see RunBoot), from the
+		// cache when it has one for this ROM, quirk profile and speed
+		bool BootFromCache(SnapshotCache& cache, int frame_limit);
+		// Runs one instruction, at most InstructionsPerFrame of them per 60 Hz
+		// frame, or a whole frame when audio sets the pace
 		bool Tick();
 		bool IsValid() const;
 
-		OpcodeStatus Opcode0(const uint16_t opcode);
-		OpcodeStatus Opcode1(const uint16_t opcode);
-		OpcodeStatus Opcode2(const uint16_t opcode);
-		OpcodeStatus Opcode3(const uint16_t opcode);
-		OpcodeStatus Opcode4(const uint16_t opcode);
-		OpcodeStatus Opcode5(const uint16_t opcode);
-		OpcodeStatus Opcode6(const uint16_t opcode);
-		OpcodeStatus Opcode7(const uint16_t opcode);
-		OpcodeStatus Opcode8(const uint16_t opcode);
-		OpcodeStatus Opcode9(const uint16_t opcode);
-		OpcodeStatus OpcodeA(const uint16_t opcode);
-		OpcodeStatus OpcodeB(const uint16_t opcode);
-		OpcodeStatus OpcodeC(const uint16_t opcode);
-		OpcodeStatus OpcodeD(const uint16_t opcode);
-		OpcodeStatus OpcodeE(const uint16_t opcode);
-		OpcodeStatus OpcodeF(const uint16_t opcode);
-
-		uint16_t GetPC() const { return PC; }
-		uint16_t GetSP() const { return SP; }
-		uint16_t GetStackTop() const { return Stack[0]; }
-		uint16_t GetStackCurrent() const { return Stack[SP]; }
-		uint16_t GetCurrentOpcode() const {
-			uint16_t offset = static_cast<uint16_t>(MemoryMapping[PC]) << 8;
-			return MemoryMapping[PC + 1] + (offset);
-		}
-		uint8_t GetRegisterValue(int index) const { return Registers[index]; }
-		uint16_t GetI() const { return I; }
-		uint8_t GetDelayTimer() const { return DelayTimer; }
-		uint8_t GetSoundTimer() const { return SoundTimer; }
-		uint8_t GetMemoryLocValue(int index) const { return MemoryMapping[index]; }
-
-		int GetWidth() const { return Width; }
-		int GetHeight() const { return Height; }
+		uint16_t GetPC() const { return Core.GetPC(); }
+		uint16_t GetSP() const { return Core.GetSP(); }
+		uint16_t GetStackTop() const { return Core.GetStackTop(); }
+		uint16_t GetStackCurrent() const { return Core.GetStackCurrent(); }
+		uint16_t GetCurrentOpcode() const { return Core.GetCurrentOpcode(); }
+		uint8_t GetRegisterValue(int index) const { return Core.GetRegisterValue(index); }
+		uint16_t GetI() const { return Core.GetI(); }
+		uint8_t GetDelayTimer() const { return Core.GetDelayTimer(); }
+		uint8_t GetSoundTimer() const { return Core.GetSoundTimer(); }
+		uint8_t GetMemoryLocValue(int index) const { return Core.GetMemoryLocValue(index); }
+
+		int GetWidth() const { return Core.GetDisplay().GetWidth(); }
+		int GetHeight() const { return Core.GetDisplay().GetHeight(); }
 		SDL_Texture* GetTexture() const { return Texture; }
+		const Display& GetDisplay() const { return Core.GetDisplay(); }
+		Machine& GetMachine() { return Core; }
+		const Machine& GetMachine() const { return Core; }
+		// The running machine without any of the host side, for headless search
+		Machine Fork() const { return Core.Fork(); }
+
+		void SetMaxFrameSkip(int max_frame_skip) { Pacer.SetMaxFrameSkip(max_frame_skip); }
+		uint64_t GetFramesPresented() const { return Pacer.GetFramesPresented(); }
+		uint64_t GetFramesDropped() const { return Pacer.GetFramesDropped(); }
+
+		void SetPalette(SDL_Color off, SDL_Color on) { ScreenPresenter.SetPalette(off, on); }
+		// Also the filter Reset goes back to after a ROM's display mode
+		bool EnableSoftwareUpscaler(UpscaleFilter filter, int thread_count = 0);
+		bool IsUpscaling() const { return ScreenPresenter.IsUpscaling(); }
+		UpscaleFilter GetUpscaleFilter() const { return ScreenPresenter.GetUpscaleFilter(); }
+
+		bool EnableSharedFramebuffer(const std::string& name);
+		bool StartRecording(const std::filesystem::path& path, uint32_t keyframe_interval = 60);
+		void StopRecording();
+		bool StartCapture(const std::filesystem::path& path, const CaptureOptions& options);
+		void StopCapture();
+
+		// Plays the sound timer as a tone; with pace_from_audio each Tick runs a whole
+		// frame whenever the audio device has drained below its target fill.
+		bool EnableAudio(bool pace_from_audio, int sample_rate = 48000);
+		void SetInstructionsPerFrame(int count) { InstructionsPerFrame = BaseInstructionsPerFrame = count > 0 ? count : 1; }
+		int GetInstructionsPerFrame() const { return InstructionsPerFrame; }
+		// layout[n] is the keypad position of the host key driving CHIP-8 key n
+		void SetKeyLayout(const std::array<uint8_t, 0x10>& layout);
+		const AudioOutput* GetAudio() const { return Audio.get(); }
+
+		VideoBackend GetVideoBackend() const { return Backend; }
+		// The instruction trace is off unless a stream is given here
+		void SetTraceStream(std::ostream* stream) { Core.SetTraceStream(stream); }
+		uint64_t GetRowsUploaded() const { return ScreenPresenter.GetRowsUploaded(); }
 
 	private:
-		std::array<uint8_t, 0x1000> MemoryMapping;
-		std::array<uint8_t, 0x10> Registers;
-		std::array<uint16_t, 0x10> Stack;
-		std::array<std::function<OpcodeStatus(const uint16_t)>, 0x10> Opcodes;
+		void ApplyRomSettings();
+		bool StartUpscaler(UpscaleFilter filter, int thread_count);
+		void RestoreBaselineUpscaler();
+		bool TickAudioPaced();
+		void QueueAudioFrame(bool tone_on);
+		bool PollEvents();
+		void UpdateKeys();
+		bool EndFrame(FrameAction frame_action);
+		bool Present();
+		void PublishSharedFrame();
 
-		std::unordered_map<int32_t, uint8_t> KeyboardMap;
+		Machine Core;
+
+		// Host key for each CHIP-8 key; sixteen entries are searched faster than hashed
+		std::array<SDL_Keycode, 0x10> KeyboardMap;
 		std::array<SDL_Scancode, 0x10> KeyboardValuesMap;
+		RomDatabase Database;
 
-		uint16_t I = 0x0;
-		uint8_t DelayTimer = 0x0;
-		uint8_t SoundTimer = 0x0;
-		uint16_t PC = 0x200;
-		uint8_t SP = 0xFF;
+		uint64_t FrameNumber = 0;
+		int InstructionsPerFrame = 11;
+		int BaseInstructionsPerFrame = 11;
+		// Instructions run by Tick in the current frame
+		int FrameSteps = 0;
+		bool RomSettingsApplied = false;
+		bool PaceFromAudio = false;
+		std::unique_ptr<AudioOutput> Audio;
 
-		bool Suspended = false;
-		uint8_t WaitForKeyboardRegister_Index = 0;
-		uint64_t DeltaTimerTicks = 0;
+		VideoBackend Backend = VideoBackend::Window;
 
 		SDL_Window* Window = nullptr;
 		SDL_Renderer* Renderer = nullptr;
 		SDL_Texture* Texture = nullptr;
-		int Width = 64;
-		int Height = 32;
+		SDL_Texture* UpscaledTexture = nullptr;
+		std::unique_ptr<WorkerPool> UpscalePool;
+		int WindowScale = 10;
+		// Set through EnableSoftwareUpscaler, as opposed to a ROM's display mode
+		bool BaselineUpscaling = false;
+		UpscaleFilter BaselineFilter = UpscaleFilter::Nearest;
+
+		FramePacer Pacer;
+		Presenter ScreenPresenter;
+		TerminalRenderer ScreenTerminal;
+		std::string TerminalOutput;
+		std::unique_ptr<SharedFramebuffer> SharedScreen;
+		std::unique_ptr<FrameStreamWriter> Recorder;
+		std::unique_ptr<VideoCapture> Capture;
 
 	};
 }
\ No newline at end of file
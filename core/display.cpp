@@ -0,0 +1,219 @@
+#include "display.h"
+
+#include <cstring>
+
+namespace chipotto
+{
+	void Display::Clear()
+	{
+		for (int plane = 0; plane < MaxPlanes; ++plane)
+		{
+			if (SelectedPlanes & (1 << plane))
+				Planes[plane] = {};
+		}
+		UsedPlanes &= ~SelectedPlanes;
+		Dirty = true;
+	}
+
+	void Display::SetHighResolution(bool high_resolution)
+	{
+		HighResolution = high_resolution;
+		Planes = {};
+		UsedPlanes = 0;
+		Dirty = true;
+	}
+
+	template <bool Wrap>
+	bool Display::DrawSprite(int x, int y, const uint8_t* sprite, int sprite_height)
+	{
+		bool collision = false;
+		std::array<uint64_t, 16> bits;
+		for (int plane = 0; plane < MaxPlanes; ++plane)
+		{
+			if (!(SelectedPlanes & (1 << plane)))
+				continue;
+			for (int row = 0; row < sprite_height; ++row)
+				bits[row] = static_cast<uint64_t>(sprite[row]) << 56;
+			collision |= DrawRows<Wrap>(Planes[plane], x, y, bits.data(), sprite_height);
+			sprite += sprite_height;
+		}
+		UsedPlanes |= SelectedPlanes;
+		return collision;
+	}
+
+	template <bool Wrap>
+	bool Display::DrawLargeSprite(int x, int y, const uint8_t* sprite)
+	{
+		bool collision = false;
+		std::array<uint64_t, 16> bits;
+		for (int plane = 0; plane < MaxPlanes; ++plane)
+		{
+			if (!(SelectedPlanes & (1 << plane)))
+				continue;
+			for (int row = 0; row < 16; ++row)
+				bits[row] = (static_cast<uint64_t>(sprite[row * 2]) << 56) | (static_cast<uint64_t>(sprite[row * 2 + 1]) << 48);
+			collision |= DrawRows<Wrap>(Planes[plane], x, y, bits.data(), 16);
+			sprite += 32;
+		}
+		UsedPlanes |= SelectedPlanes;
+		return collision;
+	}
+
+	template <bool Wrap>
+	bool Display::DrawRows(Frame& rows, int x, int y, const uint64_t* bits, int row_count)
+	{
+		bool collision = false;
+		int height = GetHeight();
+		int active_words = GetActiveWords();
+		int word_index = x / 64;
+		int bit_offset = x % 64;
+
+		for (int row = 0; row < row_count; ++row)
+		{
+			if (!Wrap && y + row >= height)
+				break;
+
+			Row& target = rows[Wrap ? (y + row) % height : y + row];
+			uint64_t high = bits[row] >> bit_offset;
+			collision |= (target[word_index] & high) != 0;
+			target[word_index] ^= high;
+
+			// Pixels spilling past the word boundary land in the next word, or are
+			// clipped (or wrapped to the first word) at the right edge of the screen.
+			if (bit_offset > 0 && (Wrap || word_index + 1 < active_words))
+			{
+				int next_word = Wrap ? (word_index + 1) % active_words : word_index + 1;
+				uint64_t low = bits[row] << (64 - bit_offset);
+				collision |= (target[next_word] & low) != 0;
+				target[next_word] ^= low;
+			}
+		}
+
+		Dirty = true;
+		return collision;
+	}
+
+	void Display::ScrollUp(int rows)
+	{
+		int height = GetHeight();
+		if (rows <= 0)
+			return;
+		if (rows > height)
+			rows = height;
+		for (int plane = 0; plane < MaxPlanes; ++plane)
+		{
+			if (!(SelectedPlanes & (1 << plane)))
+				continue;
+			Frame& frame = Planes[plane];
+			memmove(&frame[0], &frame[rows], sizeof(Row) * (height - rows));
+			memset(&frame[height - rows], 0, sizeof(Row) * rows);
+		}
+		Dirty = true;
+	}
+
+	void Display::ScrollDown(int rows)
+	{
+		int height = GetHeight();
+		if (rows <= 0)
+			return;
+		if (rows > height)
+			rows = height;
+		for (int plane = 0; plane < MaxPlanes; ++plane)
+		{
+			if (!(SelectedPlanes & (1 << plane)))
+				continue;
+			Frame& frame = Planes[plane];
+			memmove(&frame[rows], &frame[0], sizeof(Row) * (height - rows));
+			memset(&frame[0], 0, sizeof(Row) * rows);
+		}
+		Dirty = true;
+	}
+
+	void Display::ScrollRight(int pixels)
+	{
+		if (pixels <= 0 || pixels >= 64)
+			return;
+		for (int plane = 0; plane < MaxPlanes; ++plane)
+		{
+			if (!(SelectedPlanes & (1 << plane)))
+				continue;
+			for (int y = 0; y < GetHeight(); ++y)
+			{
+				Row& row = Planes[plane][y];
+				if (HighResolution)
+					row[1] = (row[1] >> pixels) | (row[0] << (64 - pixels));
+				row[0] >>= pixels;
+			}
+		}
+		Dirty = true;
+	}
+
+	void Display::ScrollLeft(int pixels)
+	{
+		if (pixels <= 0 || pixels >= 64)
+			return;
+		for (int plane = 0; plane < MaxPlanes; ++plane)
+		{
+			if (!(SelectedPlanes & (1 << plane)))
+				continue;
+			for (int y = 0; y < GetHeight(); ++y)
+			{
+				Row& row = Planes[plane][y];
+				if (HighResolution)
+				{
+					row[0] = (row[0] << pixels) | (row[1] >> (64 - pixels));
+					row[1] <<= pixels;
+				}
+				else
+				{
+					row[0] <<= pixels;
+				}
+			}
+		}
+		Dirty = true;
+	}
+
+	bool Display::GetPixel(int x, int y) const
+	{
+		return (Planes[0][y][x / 64] >> (63 - x % 64)) & 0x1;
+	}
+
+	uint8_t Display::GetColor(int x, int y) const
+	{
+		uint8_t color = 0;
+		for (int plane = 0; plane < MaxPlanes; ++plane)
+			color |= ((Planes[plane][y][x / 64] >> (63 - x % 64)) & 0x1) << plane;
+		return color;
+	}
+
+	Display::Row Display::GetLitRow(int y) const
+	{
+		Row lit = Planes[0][y];
+		for (int plane = 1; plane < MaxPlanes; ++plane)
+		{
+			for (int w = 0; w < WordsPerRow; ++w)
+				lit[w] |= Planes[plane][y][w];
+		}
+		return lit;
+	}
+
+	void Display::Rasterize(uint8_t* pixels, int stride, int lores_scale) const
+	{
+		int scale = HighResolution ? lores_scale / 2 : lores_scale;
+		int width = GetWidth();
+		bool monochrome = IsMonochrome();
+		for (int y = 0; y < GetHeight(); ++y)
+		{
+			uint8_t* line = pixels + static_cast<size_t>(y) * scale * stride;
+			for (int x = 0; x < width; ++x)
+				memset(line + x * scale, monochrome ? GetPixel(x, y) : GetColor(x, y), scale);
+			for (int copy = 1; copy < scale; ++copy)
+				memcpy(line + copy * stride, line, static_cast<size_t>(width) * scale);
+		}
+	}
+
+	template bool Display::DrawSprite<false>(int x, int y, const uint8_t* sprite, int sprite_height);
+	template bool Display::DrawSprite<true>(int x, int y, const uint8_t* sprite, int sprite_height);
+	template bool Display::DrawLargeSprite<false>(int x, int y, const uint8_t* sprite);
+	template bool Display::DrawLargeSprite<true>(int x, int y, const uint8_t* sprite);
+}
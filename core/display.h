@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace chipotto
+{
+	// Monochrome framebuffer stored one bit per pixel. Each row is an array of
+	// 64-bit words, most significant bit first, so sprite blits, collision tests,
+	// scrolls and row comparisons are a handful of word operations.
+	//
+	// Storage always covers the SUPER-CHIP 128x64 mode; in the CHIP-8 64x32 mode
+	// only the first word of the first 32 rows is used and the rest stays clear.
+	//
+	// XO-CHIP bitplanes are stored as separate frames. Drawing, clearing and
+	// scrolling act on the selected planes only, and a pixel's colour index is
+	// made of one bit from each plane (plane 0 is the least significant).
+	class Display
+	{
+	public:
+		static constexpr int MaxWidth = 128;
+		static constexpr int MaxHeight = 64;
+		static constexpr int LowResWidth = 64;
+		static constexpr int LowResHeight = 32;
+		static constexpr int WordsPerRow = (MaxWidth + 63) / 64;
+		static constexpr int MaxPlanes = 4;
+		static constexpr int MaxColors = 1 << MaxPlanes;
+
+		using Row = std::array<uint64_t, WordsPerRow>;
+		using Frame = std::array<Row, MaxHeight>;
+		using Rgb = std::array<uint8_t, 3>;
+
+		// Colour 0 is the background and colour 1 the classic foreground
+		static constexpr std::array<Rgb, MaxColors> DefaultPalette = { {
+			{ 0x00, 0x00, 0x00 }, { 0xFF, 0xFF, 0xFF }, { 0xAA, 0xAA, 0xAA }, { 0x55, 0x55, 0x55 },
+			{ 0xFF, 0x00, 0x00 }, { 0x00, 0xFF, 0x00 }, { 0x00, 0x00, 0xFF }, { 0xFF, 0xFF, 0x00 },
+			{ 0x88, 0x00, 0x00 }, { 0x00, 0x88, 0x00 }, { 0x00, 0x00, 0x88 }, { 0x88, 0x88, 0x00 },
+			{ 0xFF, 0x00, 0xFF }, { 0x00, 0xFF, 0xFF }, { 0x88, 0x00, 0x88 }, { 0x00, 0x88, 0x88 }
+		} };
+
+		// Clears the selected planes
+		void Clear();
+		// Switching resolution clears the screen
+		void SetHighResolution(bool high_resolution);
+		bool IsHighResolution() const { return HighResolution; }
+		int GetWidth() const { return HighResolution ? MaxWidth : LowResWidth; }
+		int GetHeight() const { return HighResolution ? MaxHeight : LowResHeight; }
+		int GetActiveWords() const { return HighResolution ? WordsPerRow : 1; }
+
+		// Bit n selects plane n; plane 0 alone is selected by default
+		void SelectPlanes(uint8_t mask) { SelectedPlanes = mask & (MaxColors - 1); }
+		uint8_t GetSelectedPlanes() const { return SelectedPlanes; }
+		// Planes holding any pixel; only plane 0 means a two-colour image
+		uint8_t GetUsedPlanes() const { return UsedPlanes; }
+		bool IsMonochrome() const { return (UsedPlanes & ~0x1) == 0; }
+
+		// Sprites hold sprite_height bytes for each selected plane, in plane order.
+		// Pixels past the screen edges are clipped, or wrap around when Wrap is set.
+		template <bool Wrap = false>
+		bool DrawSprite(int x, int y, const uint8_t* sprite, int sprite_height);
+		// 16x16 sprite, two bytes per row
+		template <bool Wrap = false>
+		bool DrawLargeSprite(int x, int y, const uint8_t* sprite);
+
+		void ScrollUp(int rows);
+		void ScrollDown(int rows);
+		void ScrollRight(int pixels);
+		void ScrollLeft(int pixels);
+
+		// Plane 0 accessors
+		bool GetPixel(int x, int y) const;
+		const Row& GetRow(int y) const { return Planes[0][y]; }
+		const Frame& GetFrame() const { return Planes[0]; }
+
+		const Row& GetRow(int plane, int y) const { return Planes[plane][y]; }
+		const Frame& GetPlane(int plane) const { return Planes[plane]; }
+		uint8_t GetColor(int x, int y) const;
+		// Pixels set in any plane, for outputs that only show two colours
+		Row GetLitRow(int y) const;
+		bool IsLit(int x, int y) const { return GetColor(x, y) != 0; }
+		bool SameImage(const Display& other) const { return HighResolution == other.HighResolution && Planes == other.Planes; }
+
+		// One byte (the colour index) per output pixel; a low resolution pixel
+		// covers lores_scale bytes and a high resolution one half of that.
+		void Rasterize(uint8_t* pixels, int stride, int lores_scale) const;
+
+		bool IsDirty() const { return Dirty; }
+		void ClearDirty() { Dirty = false; }
+
+	private:
+		template <bool Wrap>
+		bool DrawRows(Frame& rows, int x, int y, const uint64_t* bits, int row_count);
+
+		std::array<Frame, MaxPlanes> Planes = {};
+		uint8_t SelectedPlanes = 0x1;
+		uint8_t UsedPlanes = 0x0;
+		bool HighResolution = false;
+		bool Dirty = true;
+	};
+
+	extern template bool Display::DrawSprite<false>(int x, int y, const uint8_t* sprite, int sprite_height);
+	extern template bool Display::DrawSprite<true>(int x, int y, const uint8_t* sprite, int sprite_height);
+	extern template bool Display::DrawLargeSprite<false>(int x, int y, const uint8_t* sprite);
+	extern template bool Display::DrawLargeSprite<true>(int x, int y, const uint8_t* sprite);
+}
@@ -0,0 +1,49 @@
+#include "frame_pacer.h"
+
+namespace chipotto
+{
+	void FramePacer::Reset()
+	{
+		Started = false;
+		StartTicks = 0;
+		FrameIndex = 0;
+		ConsecutiveSkips = 0;
+		FramesPresented = 0;
+		FramesDropped = 0;
+	}
+
+	FrameAction FramePacer::Advance(uint64_t now_ticks)
+	{
+		if (!Started)
+		{
+			Started = true;
+			StartTicks = now_ticks;
+		}
+
+		uint64_t deadline = GetDeadline(FrameIndex);
+		if (now_ticks < deadline)
+			return FrameAction::None;
+
+		// After a long stall (debugger, window drag) there is no point in catching
+		// up frame by frame: account for the missed frames and resync to now.
+		uint64_t frames_behind = (now_ticks - deadline) * FramesPerSecond / 1000;
+		if (frames_behind > FramesPerSecond)
+		{
+			FramesDropped += frames_behind;
+			FrameIndex += frames_behind;
+			ConsecutiveSkips = 0;
+		}
+
+		FrameIndex++;
+		if (frames_behind > 0 && ConsecutiveSkips < MaxFrameSkip)
+		{
+			ConsecutiveSkips++;
+			FramesDropped++;
+			return FrameAction::Skip;
+		}
+
+		ConsecutiveSkips = 0;
+		FramesPresented++;
+		return FrameAction::Present;
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+namespace chipotto
+{
+	enum class FrameAction
+	{
+		None,
+		Present,
+		Skip
+	};
+
+	// Tracks 60 Hz frame boundaries against the host clock. When the host falls
+	// behind, late frames are reported as Skip (up to MaxFrameSkip in a row) so
+	// the caller can drop presentation instead of slowing emulated time down.
+	class FramePacer
+	{
+	public:
+		static constexpr uint64_t FramesPerSecond = 60;
+
+		void Reset();
+		FrameAction Advance(uint64_t now_ticks);
+
+		void SetMaxFrameSkip(int max_frame_skip) { MaxFrameSkip = max_frame_skip < 0 ? 0 : max_frame_skip; }
+		int GetMaxFrameSkip() const { return MaxFrameSkip; }
+
+		uint64_t GetFrameCount() const { return FrameIndex; }
+		uint64_t GetFramesPresented() const { return FramesPresented; }
+		uint64_t GetFramesDropped() const { return FramesDropped; }
+
+	private:
+		uint64_t GetDeadline(uint64_t frame) const { return StartTicks + frame * 1000 / FramesPerSecond; }
+
+		bool Started = false;
+		uint64_t StartTicks = 0;
+		uint64_t FrameIndex = 0;
+		int MaxFrameSkip = 4;
+		int ConsecutiveSkips = 0;
+
+		uint64_t FramesPresented = 0;
+		uint64_t FramesDropped = 0;
+	};
+}
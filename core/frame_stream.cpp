@@ -0,0 +1,456 @@
+#include "frame_stream.h"
+
+#include <algorithm>
+#include <array>
+
+namespace chipotto
+{
+	static constexpr size_t FrameBytes = FrameStreamFormat::BytesPerRow * Display::MaxHeight;
+	static constexpr size_t RowMaskBytes = (Display::MaxHeight + 7) / 8;
+
+	static void PutU16(std::vector<uint8_t>& out, uint16_t value)
+	{
+		out.push_back(static_cast<uint8_t>(value));
+		out.push_back(static_cast<uint8_t>(value >> 8));
+	}
+
+	static void PutU32(std::vector<uint8_t>& out, uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i)
+			out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+	}
+
+	static void PutU64(std::vector<uint8_t>& out, uint64_t value)
+	{
+		for (int i = 0; i < 8; ++i)
+			out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+	}
+
+	static uint64_t GetLE(const uint8_t* bytes, int count)
+	{
+		uint64_t value = 0;
+		for (int i = 0; i < count; ++i)
+			value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+		return value;
+	}
+
+	static void PutVarint(std::vector<uint8_t>& out, size_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	static bool GetVarint(const uint8_t*& cursor, const uint8_t* end, size_t& value)
+	{
+		value = 0;
+		for (int shift = 0; cursor < end && shift < 64; shift += 7)
+		{
+			uint8_t byte = *cursor++;
+			value |= static_cast<size_t>(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	// Rows are serialised most significant byte first, matching pixel order
+	static void PackRow(const Display::Row& row, uint8_t* bytes)
+	{
+		for (uint64_t word : row)
+		{
+			for (int shift = 56; shift >= 0; shift -= 8)
+				*bytes++ = static_cast<uint8_t>(word >> shift);
+		}
+	}
+
+	static void XorRow(Display::Row& row, const uint8_t* bytes)
+	{
+		for (uint64_t& word : row)
+		{
+			uint64_t value = 0;
+			for (int i = 0; i < 8; ++i)
+				value = (value << 8) | *bytes++;
+			word ^= value;
+		}
+	}
+
+	// Alternating runs: zero count, literal count, literal bytes
+	static void EncodeRuns(const uint8_t* bytes, size_t size, std::vector<uint8_t>& out)
+	{
+		size_t i = 0;
+		while (i < size)
+		{
+			size_t zeros = 0;
+			while (i + zeros < size && bytes[i + zeros] == 0)
+				zeros++;
+			size_t literals = 0;
+			while (i + zeros + literals < size && bytes[i + zeros + literals] != 0)
+				literals++;
+
+			PutVarint(out, zeros);
+			PutVarint(out, literals);
+			out.insert(out.end(), bytes + i + zeros, bytes + i + zeros + literals);
+			i += zeros + literals;
+		}
+	}
+
+	static bool DecodeRuns(const uint8_t*& cursor, const uint8_t* end, uint8_t* bytes, size_t size)
+	{
+		size_t i = 0;
+		while (i < size)
+		{
+			size_t zeros;
+			size_t literals;
+			if (!GetVarint(cursor, end, zeros) || !GetVarint(cursor, end, literals))
+				return false;
+			if (zeros + literals > size - i || literals > static_cast<size_t>(end - cursor))
+				return false;
+
+			std::fill(bytes + i, bytes + i + zeros, 0);
+			i += zeros;
+			std::copy(cursor, cursor + literals, bytes + i);
+			cursor += literals;
+			i += literals;
+		}
+		return true;
+	}
+
+	void FrameStreamFormat::EncodeKeyFrame(const Display::Frame& frame, std::vector<uint8_t>& payload)
+	{
+		std::array<uint8_t, FrameBytes> bytes;
+		for (int y = 0; y < Display::MaxHeight; ++y)
+			PackRow(frame[y], bytes.data() + y * BytesPerRow);
+
+		payload.clear();
+		EncodeRuns(bytes.data(), bytes.size(), payload);
+	}
+
+	void FrameStreamFormat::EncodeDeltaFrame(const Display::Frame& frame, const Display::Frame& previous, std::vector<uint8_t>& payload)
+	{
+		std::array<uint8_t, RowMaskBytes> row_mask = {};
+		std::array<uint8_t, FrameBytes> bytes;
+		size_t size = 0;
+		for (int y = 0; y < Display::MaxHeight; ++y)
+		{
+			if (frame[y] == previous[y])
+				continue;
+
+			Display::Row delta;
+			for (int w = 0; w < Display::WordsPerRow; ++w)
+				delta[w] = frame[y][w] ^ previous[y][w];
+			PackRow(delta, bytes.data() + size);
+			size += BytesPerRow;
+			row_mask[y / 8] |= 1 << (y % 8);
+		}
+
+		// The row mask is run-length coded too, so an unchanged frame stays tiny
+		payload.clear();
+		EncodeRuns(row_mask.data(), row_mask.size(), payload);
+		EncodeRuns(bytes.data(), size, payload);
+	}
+
+	bool FrameStreamFormat::DecodeFrame(uint8_t type, const uint8_t* payload, size_t size, Display::Frame& frame)
+	{
+		const uint8_t* cursor = payload;
+		const uint8_t* end = payload + size;
+		std::array<uint8_t, FrameBytes> bytes;
+
+		if (type == KeyFrame)
+		{
+			if (!DecodeRuns(cursor, end, bytes.data(), bytes.size()))
+				return false;
+			for (int y = 0; y < Display::MaxHeight; ++y)
+			{
+				frame[y] = {};
+				XorRow(frame[y], bytes.data() + y * BytesPerRow);
+			}
+			return true;
+		}
+
+		std::array<uint8_t, RowMaskBytes> row_mask;
+		if (type != DeltaFrame || !DecodeRuns(cursor, end, row_mask.data(), row_mask.size()))
+			return false;
+
+		size_t changed_rows = 0;
+		for (int y = 0; y < Display::MaxHeight; ++y)
+		{
+			if (row_mask[y / 8] & (1 << (y % 8)))
+				changed_rows++;
+		}
+
+		if (!DecodeRuns(cursor, end, bytes.data(), changed_rows * BytesPerRow))
+			return false;
+
+		const uint8_t* delta = bytes.data();
+		for (int y = 0; y < Display::MaxHeight; ++y)
+		{
+			if (row_mask[y / 8] & (1 << (y % 8)))
+			{
+				XorRow(frame[y], delta);
+				delta += BytesPerRow;
+			}
+		}
+		return true;
+	}
+
+	FrameStreamWriter::~FrameStreamWriter()
+	{
+		Close();
+	}
+
+	bool FrameStreamWriter::Open(const std::filesystem::path& path, uint32_t keyframe_interval, size_t queue_capacity)
+	{
+		Close();
+
+		File.open(path, std::ios::binary | std::ios::trunc);
+		if (!File.is_open())
+			return false;
+
+		KeyframeInterval = keyframe_interval > 0 ? keyframe_interval : 1;
+		FramesWritten = 0;
+		FramesDropped = 0;
+		PendingRepeats = 0;
+		KeyframeOffsets.clear();
+		Previous = {};
+		PreviousHighResolution = false;
+		Offset = FrameStreamFormat::HeaderSize;
+
+		std::vector<uint8_t> header;
+		PutU32(header, FrameStreamFormat::Magic);
+		PutU16(header, FrameStreamFormat::Version);
+		PutU16(header, Display::MaxWidth);
+		PutU16(header, Display::MaxHeight);
+		PutU16(header, Display::WordsPerRow);
+		PutU32(header, KeyframeInterval);
+		header.resize(FrameStreamFormat::HeaderSize, 0);
+		File.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+		Queue = std::make_unique<BoundedQueue<FrameItem>>(queue_capacity);
+		Thread = std::thread(&FrameStreamWriter::WriterLoop, this);
+		return true;
+	}
+
+	void FrameStreamWriter::Submit(const Display& display)
+	{
+		if (!Queue)
+			return;
+
+		FrameItem item;
+		item.Frame = display.GetFrame();
+		item.HighResolution = display.IsHighResolution();
+		item.PreviousRepeats = PendingRepeats;
+		if (!Queue->TryPush(item))
+		{
+			PendingRepeats++;
+			FramesDropped++;
+			return;
+		}
+		PendingRepeats = 0;
+	}
+
+	void FrameStreamWriter::Close()
+	{
+		if (!Queue)
+			return;
+
+		if (PendingRepeats > 0)
+		{
+			FrameItem flush;
+			flush.PreviousRepeats = PendingRepeats;
+			flush.HasFrame = false;
+			Queue->Push(flush);
+			PendingRepeats = 0;
+		}
+		Queue->Close();
+		Thread.join();
+		Queue.reset();
+
+		std::vector<uint8_t> footer;
+		for (size_t i = 0; i < KeyframeOffsets.size(); ++i)
+		{
+			PutU64(footer, i * KeyframeInterval);
+			PutU64(footer, KeyframeOffsets[i]);
+		}
+		PutU64(footer, KeyframeOffsets.size());
+		PutU64(footer, FramesWritten);
+		PutU32(footer, FrameStreamFormat::IndexMagic);
+		File.write(reinterpret_cast<const char*>(footer.data()), footer.size());
+		File.close();
+	}
+
+	void FrameStreamWriter::WriterLoop()
+	{
+		while (Queue->Pop(Item))
+		{
+			for (uint32_t repeat = 0; repeat < Item.PreviousRepeats; ++repeat)
+				WriteFrame(Previous, PreviousHighResolution);
+			if (Item.HasFrame)
+				WriteFrame(Item.Frame, Item.HighResolution);
+		}
+	}
+
+	void FrameStreamWriter::WriteFrame(const Display::Frame& frame, bool high_resolution)
+	{
+		bool keyframe = FramesWritten % KeyframeInterval == 0;
+		if (keyframe)
+		{
+			FrameStreamFormat::EncodeKeyFrame(frame, Payload);
+			KeyframeOffsets.push_back(Offset);
+		}
+		else
+		{
+			FrameStreamFormat::EncodeDeltaFrame(frame, Previous, Payload);
+		}
+
+		Record.clear();
+		uint8_t type = keyframe ? FrameStreamFormat::KeyFrame : FrameStreamFormat::DeltaFrame;
+		if (high_resolution)
+			type |= FrameStreamFormat::HighResolutionFlag;
+		Record.push_back(type);
+		PutU32(Record, static_cast<uint32_t>(Payload.size()));
+		Record.insert(Record.end(), Payload.begin(), Payload.end());
+		File.write(reinterpret_cast<const char*>(Record.data()), Record.size());
+
+		Offset += Record.size();
+		// frame may be Previous itself when a dropped frame is repeated
+		if (&frame != &Previous)
+			Previous = frame;
+		PreviousHighResolution = high_resolution;
+		FramesWritten++;
+	}
+
+	bool FrameStreamReader::Open(const std::filesystem::path& path)
+	{
+		File.close();
+		File.open(path, std::ios::binary);
+		if (!File.is_open())
+			return false;
+
+		std::error_code error;
+		uint64_t file_size = std::filesystem::file_size(path, error);
+		if (error || file_size < FrameStreamFormat::HeaderSize)
+			return false;
+
+		uint8_t header[FrameStreamFormat::HeaderSize];
+		File.read(reinterpret_cast<char*>(header), sizeof(header));
+		if (GetLE(header, 4) != FrameStreamFormat::Magic || GetLE(header + 4, 2) != FrameStreamFormat::Version)
+			return false;
+		if (GetLE(header + 6, 2) != Display::MaxWidth || GetLE(header + 8, 2) != Display::MaxHeight)
+			return false;
+		KeyframeInterval = static_cast<uint32_t>(GetLE(header + 12, 4));
+		if (KeyframeInterval == 0)
+			return false;
+
+		CurrentIndex = UINT64_MAX;
+		return BuildIndex(file_size);
+	}
+
+	bool FrameStreamReader::BuildIndex(uint64_t file_size)
+	{
+		KeyframeOffsets.clear();
+		FrameCount = 0;
+
+		// Complete recordings end with a keyframe index
+		if (file_size >= FrameStreamFormat::HeaderSize + FrameStreamFormat::FooterSize)
+		{
+			uint8_t footer[FrameStreamFormat::FooterSize];
+			File.seekg(file_size - FrameStreamFormat::FooterSize);
+			File.read(reinterpret_cast<char*>(footer), sizeof(footer));
+			uint64_t keyframes = GetLE(footer, 8);
+			if (File && GetLE(footer + 16, 4) == FrameStreamFormat::IndexMagic && keyframes * 16 + FrameStreamFormat::FooterSize <= file_size)
+			{
+				std::vector<uint8_t> entries(keyframes * 16);
+				File.seekg(file_size - FrameStreamFormat::FooterSize - entries.size());
+				File.read(reinterpret_cast<char*>(entries.data()), entries.size());
+				for (uint64_t i = 0; i < keyframes; ++i)
+					KeyframeOffsets.push_back(GetLE(entries.data() + i * 16 + 8, 8));
+				FrameCount = GetLE(footer + 8, 8);
+				return static_cast<bool>(File);
+			}
+		}
+
+		// Truncated recording (the writer did not close): rebuild the index by scanning
+		File.clear();
+		uint64_t offset = FrameStreamFormat::HeaderSize;
+		while (offset + FrameStreamFormat::RecordHeaderSize <= file_size)
+		{
+			uint8_t type;
+			uint64_t next_offset;
+			if (!ReadRecord(offset, type, next_offset) || next_offset > file_size)
+				break;
+			if (FrameCount % KeyframeInterval == 0)
+			{
+				if ((type & ~FrameStreamFormat::HighResolutionFlag) != FrameStreamFormat::KeyFrame)
+					break;
+				KeyframeOffsets.push_back(offset);
+			}
+			FrameCount++;
+			offset = next_offset;
+		}
+		File.clear();
+		return true;
+	}
+
+	bool FrameStreamReader::ReadRecord(uint64_t offset, uint8_t& type, uint64_t& next_offset)
+	{
+		uint8_t record_header[FrameStreamFormat::RecordHeaderSize];
+		File.seekg(offset);
+		File.read(reinterpret_cast<char*>(record_header), sizeof(record_header));
+		if (!File)
+			return false;
+
+		type = record_header[0];
+		uint32_t size = static_cast<uint32_t>(GetLE(record_header + 1, 4));
+		Payload.resize(size);
+		File.read(reinterpret_cast<char*>(Payload.data()), size);
+		next_offset = offset + FrameStreamFormat::RecordHeaderSize + size;
+		return static_cast<bool>(File);
+	}
+
+	bool FrameStreamReader::ReadFrame(uint64_t index, Display::Frame& frame)
+	{
+		if (index >= FrameCount)
+			return false;
+
+		uint64_t keyframe = index / KeyframeInterval;
+		if (keyframe >= KeyframeOffsets.size())
+			return false;
+
+		// Sequential playback continues from the last decoded frame
+		uint64_t position;
+		uint64_t offset;
+		if (CurrentIndex != UINT64_MAX && CurrentIndex <= index && CurrentIndex / KeyframeInterval == keyframe)
+		{
+			position = CurrentIndex + 1;
+			offset = NextOffset;
+		}
+		else
+		{
+			position = keyframe * KeyframeInterval;
+			offset = KeyframeOffsets[keyframe];
+		}
+
+		for (; position <= index; ++position)
+		{
+			uint8_t type;
+			uint64_t next_offset;
+			if (!ReadRecord(offset, type, next_offset) || !FrameStreamFormat::DecodeFrame(type & ~FrameStreamFormat::HighResolutionFlag, Payload.data(), Payload.size(), Current))
+			{
+				CurrentIndex = UINT64_MAX;
+				File.clear();
+				return false;
+			}
+			CurrentHighResolution = (type & FrameStreamFormat::HighResolutionFlag) != 0;
+			CurrentIndex = position;
+			NextOffset = next_offset;
+			offset = next_offset;
+		}
+
+		frame = Current;
+		return true;
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "display.h"
+
+namespace chipotto
+{
+	// Native recording format. After a 24-byte header every frame is stored as a
+	// record: a keyframe holds the run-length coded packed display, a delta frame
+	// holds a run-length coded bitmap of changed rows followed by the run-length
+	// coded XOR of those rows against the previous frame. A footer indexes the
+	// keyframes for seeking.
+	// Frames always cover the largest display; the record type carries a flag
+	// for frames captured in high resolution mode. Only the first XO-CHIP plane
+	// is recorded.
+	struct FrameStreamFormat
+	{
+		static constexpr uint32_t Magic = 0x53463843; // "C8FS"
+		static constexpr uint32_t IndexMagic = 0x49463843; // "C8FI"
+		static constexpr uint16_t Version = 2;
+		static constexpr uint8_t KeyFrame = 0;
+		static constexpr uint8_t DeltaFrame = 1;
+		static constexpr uint8_t HighResolutionFlag = 0x80;
+		static constexpr size_t HeaderSize = 24;
+		static constexpr size_t RecordHeaderSize = 5;
+		static constexpr size_t FooterSize = 20;
+		static constexpr size_t BytesPerRow = Display::WordsPerRow * sizeof(uint64_t);
+
+		static void EncodeKeyFrame(const Display::Frame& frame, std::vector<uint8_t>& payload);
+		static void EncodeDeltaFrame(const Display::Frame& frame, const Display::Frame& previous, std::vector<uint8_t>& payload);
+		// Decodes a payload on top of frame, which must hold the previous frame for
+		// deltas. The resolution flag must already be masked out of type.
+		static bool DecodeFrame(uint8_t type, const uint8_t* payload, size_t size, Display::Frame& frame);
+	};
+
+	// Encodes and writes frames on a background thread. Submit only copies the
+	// recorded plane into a preallocated queue slot and never waits: when the
+	// writer falls behind and the queue is full the frame is dropped, and the
+	// previous one is written again in its place so the timeline stays intact.
+	class FrameStreamWriter
+	{
+	public:
+		FrameStreamWriter() = default;
+		~FrameStreamWriter();
+
+		FrameStreamWriter(const FrameStreamWriter& other) = delete;
+		FrameStreamWriter& operator=(const FrameStreamWriter& other) = delete;
+
+		bool Open(const std::filesystem::path& path, uint32_t keyframe_interval = 60, size_t queue_capacity = 256);
+		void Submit(const Display& display);
+		void Close();
+
+		bool IsOpen() const { return Queue != nullptr; }
+		uint64_t GetFramesWritten() const { return FramesWritten; }
+		uint64_t GetFramesDropped() const { return FramesDropped; }
+
+	private:
+		struct FrameItem
+		{
+			Display::Frame Frame;
+			bool HighResolution = false;
+			// Dropped frames to write as copies of the last one before this one
+			uint32_t PreviousRepeats = 0;
+			// False for the item Close queues to flush the last repeats
+			bool HasFrame = true;
+		};
+
+		void WriterLoop();
+		void WriteFrame(const Display::Frame& frame, bool high_resolution);
+
+		std::ofstream File;
+		std::unique_ptr<BoundedQueue<FrameItem>> Queue;
+		std::thread Thread;
+		uint32_t KeyframeInterval = 60;
+		uint64_t FramesWritten = 0;
+		uint64_t FramesDropped = 0;
+		uint32_t PendingRepeats = 0;
+		std::vector<uint64_t> KeyframeOffsets;
+
+		// Writer thread state
+		FrameItem Item;
+		Display::Frame Previous = {};
+		bool PreviousHighResolution = false;
+		std::vector<uint8_t> Record;
+		std::vector<uint8_t> Payload;
+		uint64_t Offset = 0;
+	};
+
+	class FrameStreamReader
+	{
+	public:
+		bool Open(const std::filesystem::path& path);
+
+		uint64_t GetFrameCount() const { return FrameCount; }
+		uint32_t GetKeyframeInterval() const { return KeyframeInterval; }
+
+		// Decodes frame index, starting from the nearest keyframe unless the
+		// requested frame directly follows the last one read.
+		bool ReadFrame(uint64_t index, Display::Frame& frame);
+		// Resolution of the frame returned by the last successful ReadFrame
+		bool IsHighResolution() const { return CurrentHighResolution; }
+
+	private:
+		bool ReadRecord(uint64_t offset, uint8_t& type, uint64_t& next_offset);
+		bool BuildIndex(uint64_t file_size);
+
+		std::ifstream File;
+		uint32_t KeyframeInterval = 0;
+		uint64_t FrameCount = 0;
+		std::vector<uint64_t> KeyframeOffsets;
+		std::vector<uint8_t> Payload;
+
+		Display::Frame Current = {};
+		bool CurrentHighResolution = false;
+		uint64_t CurrentIndex = UINT64_MAX;
+		uint64_t NextOffset = 0;
+	};
+}
@@ -0,0 +1,907 @@
+#include "machine.h"
+#include "rom_database.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <type_traits>
+
+namespace chipotto
+{
+	static constexpr std::array<uint8_t, 80> FontSprites = {
+		0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+		0x20, 0x60, 0x20, 0x20, 0x70, // 1
+		0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+		0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+		0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+		0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+		0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+		0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+		0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+		0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+		0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+		0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+		0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+		0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+		0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+		0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+	};
+
+	// SUPER-CHIP 8x10 digits, stored right after the small font
+	static constexpr std::array<uint8_t, 160> LargeFontSprites = {
+		0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+		0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+		0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+		0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+		0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+		0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+		0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+		0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+	};
+
+	static constexpr PagedMemory::Page MakeFontPage()
+	{
+		PagedMemory::Page page = {};
+		std::copy(FontSprites.begin(), FontSprites.end(), page.begin());
+		std::copy(LargeFontSprites.begin(), LargeFontSprites.end(), page.begin() + Machine::LargeFontAddress);
+		return page;
+	}
+
+	// The first page of every machine until a program writes to it
+	static constexpr PagedMemory::Page FontPage = MakeFontPage();
+
+	Machine::Machine()
+	{
+		SetQuirks(QuirkProfile::Modern);
+		Memory.Share(0, FontPage.data());
+	}
+
+	Machine Machine::Fork() const
+	{
+		Machine fork(*this);
+		fork.Trace = nullptr;
+		return fork;
+	}
+
+	void Machine::Reset()
+	{
+		// A program may have written over the fonts, so they are mapped again too
+		Memory.Clear();
+		Memory.Share(0, FontPage.data());
+		Image.reset();
+		uint32_t random_state = Hot.RandomState;
+		Hot = MachineState();
+		Hot.RandomState = random_state;
+		AudioPattern = {};
+		Pitch = DefaultPitch;
+		AudioPatternLoaded = false;
+		RomHash = 0;
+		Screen = Display();
+	}
+
+	bool Machine::LoadFromSpan(std::span<const std::byte> rom)
+	{
+		return LoadBytes(rom, HashRom(reinterpret_cast<const uint8_t*>(rom.data()), rom.size()));
+	}
+
+	bool Machine::LoadFromImage(std::shared_ptr<const RomImage> image)
+	{
+		if (!image || image->GetSize() > MaxRomSize)
+			return false;
+
+		size_t first_page = ProgramAddress / PagedMemory::PageSize;
+		for (size_t page = 0; page < image->GetPageCount(); ++page)
+			Memory.Share(first_page + page, image->GetPage(page));
+		RomHash = image->GetHash();
+		Image = std::move(image);
+		return true;
+	}
+
+	bool Machine::LoadFromFile(const std::filesystem::path& path)
+	{
+		MappedFile file;
+		if (!file.Open(path))
+			return false;
+		return LoadFromSpan({ reinterpret_cast<const std::byte*>(file.GetData()), file.GetSize() });
+	}
+
+	bool Machine::LoadFromBuffer(const uint16_t *opcodes, size_t size)
+	{
+		return LoadFromSpan(std::as_bytes(std::span(opcodes, size)));
+	}
+
+	bool Machine::LoadBytes(std::span<const std::byte> rom, uint64_t hash)
+	{
+		if (rom.size() > MaxRomSize)
+			return false;
+
+		Memory.Copy(ProgramAddress, reinterpret_cast<const uint8_t*>(rom.data()), rom.size());
+		RomHash = hash;
+		return true;
+	}
+
+	// Saved state layout: the fixed part, then one bit per page saying whether
+	// it is stored, then the stored pages in address order
+	static_assert(std::is_trivially_copyable_v<MachineState> && std::is_trivially_copyable_v<Display>, "machine state is saved as is");
+	static constexpr size_t StateFlagsOffset = sizeof(MachineState);
+	static constexpr size_t StateAudioOffset = StateFlagsOffset + 0x10;
+	static constexpr size_t StateHashOffset = StateAudioOffset + 0x10;
+	static constexpr size_t StatePitchOffset = StateHashOffset + sizeof(uint64_t);
+	static constexpr size_t StateScreenOffset = StatePitchOffset + 8;
+	static constexpr size_t StatePageMaskOffset = StateScreenOffset + sizeof(Display);
+	static constexpr size_t StatePagesOffset = StatePageMaskOffset + PagedMemory::PageCount / 8;
+
+	// Bump when the state changes meaning without changing any size or offset
+	static constexpr uint64_t StateVersion = 1;
+
+	uint64_t Machine::GetStateLayout()
+	{
+		const uint64_t layout[] = {
+			StateVersion,
+			std::endian::native == std::endian::little ? 1u : 2u,
+			sizeof(MachineState),
+			offsetof(MachineState, Registers),
+			offsetof(MachineState, PC),
+			offsetof(MachineState, I),
+			offsetof(MachineState, Keys),
+			offsetof(MachineState, SP),
+			offsetof(MachineState, DelayTimer),
+			offsetof(MachineState, SoundTimer),
+			offsetof(MachineState, Suspended),
+			offsetof(MachineState, WaitForKeyboardRegister_Index),
+			offsetof(MachineState, RandomState),
+			offsetof(MachineState, Stack),
+			sizeof(Display),
+			alignof(Display),
+			sizeof(Display::Frame),
+			Display::MaxPlanes,
+			PagedMemory::PageSize,
+			StatePagesOffset
+		};
+		return HashRom(reinterpret_cast<const uint8_t*>(layout), sizeof(layout));
+	}
+
+	static bool IsZeroPage(const uint8_t* page)
+	{
+		return std::all_of(page, page + PagedMemory::PageSize, [](uint8_t value) { return value == 0; });
+	}
+
+	void Machine::SaveState(std::vector<uint8_t>& state) const
+	{
+		state.assign(StatePagesOffset, 0);
+		memcpy(state.data(), &Hot, sizeof(Hot));
+		memcpy(state.data() + StateFlagsOffset, Flags.data(), Flags.size());
+		memcpy(state.data() + StateAudioOffset, AudioPattern.data(), AudioPattern.size());
+		memcpy(state.data() + StateHashOffset, &RomHash, sizeof(RomHash));
+		state[StatePitchOffset] = Pitch;
+		state[StatePitchOffset + 1] = AudioPatternLoaded ? 1 : 0;
+		memcpy(state.data() + StateScreenOffset, &Screen, sizeof(Screen));
+
+		for (size_t index = 0; index < PagedMemory::PageCount; ++index)
+		{
+			const uint8_t* page = Memory.GetPage(index);
+			if (IsZeroPage(page))
+				continue;
+			state[StatePageMaskOffset + index / 8] |= static_cast<uint8_t>(1 << (index % 8));
+			state.insert(state.end(), page, page + PagedMemory::PageSize);
+		}
+	}
+
+	bool Machine::LoadState(std::span<const uint8_t> state)
+	{
+		if (state.size() < StatePagesOffset)
+			return false;
+
+		size_t page_count = 0;
+		for (size_t index = 0; index < PagedMemory::PageCount; ++index)
+			page_count += (state[StatePageMaskOffset + index / 8] >> (index % 8)) & 0x1;
+		if (state.size() != StatePagesOffset + page_count * PagedMemory::PageSize)
+			return false;
+
+		memcpy(&Hot, state.data(), sizeof(Hot));
+		memcpy(Flags.data(), state.data() + StateFlagsOffset, Flags.size());
+		memcpy(AudioPattern.data(), state.data() + StateAudioOffset, AudioPattern.size());
+		memcpy(&RomHash, state.data() + StateHashOffset, sizeof(RomHash));
+		Pitch = state[StatePitchOffset];
+		AudioPatternLoaded = state[StatePitchOffset + 1] != 0;
+		memcpy(&Screen, state.data() + StateScreenOffset, sizeof(Screen));
+
+		Memory.Clear();
+		Image.reset();
+		const uint8_t* page = state.data() + StatePagesOffset;
+		for (size_t index = 0; index < PagedMemory::PageCount; ++index)
+		{
+			if (!((state[StatePageMaskOffset + index / 8] >> (index % 8)) & 0x1))
+				continue;
+			// An untouched font page goes back to being shared
+			if (index == 0 && std::equal(page, page + PagedMemory::PageSize, FontPage.begin()))
+				Memory.Share(0, FontPage.data());
+			else
+				Memory.Copy(static_cast<uint16_t>(index * PagedMemory::PageSize), page, PagedMemory::PageSize);
+			page += PagedMemory::PageSize;
+		}
+		return true;
+	}
+
+	void Machine::SetQuirks(QuirkProfile profile)
+	{
+		Profile = profile;
+		switch (profile)
+		{
+		case QuirkProfile::CosmacVip:
+			StepImpl = &Machine::StepWith<CosmacVipQuirks>;
+			RunFrameImpl = &Machine::RunFrameWith<CosmacVipQuirks>;
+			break;
+		case QuirkProfile::SuperChip:
+			StepImpl = &Machine::StepWith<SuperChipQuirks>;
+			RunFrameImpl = &Machine::RunFrameWith<SuperChipQuirks>;
+			break;
+		case QuirkProfile::XoChip:
+			StepImpl = &Machine::StepWith<XoChipQuirks>;
+			RunFrameImpl = &Machine::RunFrameWith<XoChipQuirks>;
+			break;
+		default:
+			Profile = QuirkProfile::Modern;
+			StepImpl = &Machine::StepWith<ModernQuirks>;
+			RunFrameImpl = &Machine::RunFrameWith<ModernQuirks>;
+			break;
+		}
+	}
+
+	OpcodeStatus Machine::Step()
+	{
+		return (this->*StepImpl)();
+	}
+
+	bool Machine::RunFrame(int instructions_per_frame)
+	{
+		return (this->*RunFrameImpl)(instructions_per_frame);
+	}
+
+	template <typename QuirkPolicy>
+	OpcodeStatus Machine::Execute(const uint16_t opcode)
+	{
+		switch (opcode >> 12)
+		{
+		case 0x0:
+			return Opcode0(opcode);
+		case 0x1:
+			return Opcode1(opcode);
+		case 0x2:
+			return Opcode2(opcode);
+		case 0x3:
+			return Opcode3(opcode);
+		case 0x4:
+			return Opcode4(opcode);
+		case 0x5:
+			return Opcode5(opcode);
+		case 0x6:
+			return Opcode6(opcode);
+		case 0x7:
+			return Opcode7(opcode);
+		case 0x8:
+			return Opcode8<QuirkPolicy>(opcode);
+		case 0x9:
+			return Opcode9(opcode);
+		case 0xA:
+			return OpcodeA(opcode);
+		case 0xB:
+			return OpcodeB<QuirkPolicy>(opcode);
+		case 0xC:
+			return OpcodeC(opcode);
+		case 0xD:
+			return OpcodeD<QuirkPolicy>(opcode);
+		case 0xE:
+			return OpcodeE(opcode);
+		default:
+			return OpcodeF<QuirkPolicy>(opcode);
+		}
+	}
+
+	template <typename QuirkPolicy>
+	OpcodeStatus Machine::StepWith()
+	{
+		if (Hot.Suspended)
+			return OpcodeStatus::WaitForKeyboard;
+
+		uint16_t opcode = ReadWord(Hot.PC);
+		TraceStream() << std::hex << "0x" << Hot.PC << ": 0x" << opcode << "  -->  ";
+
+		OpcodeStatus status = Execute<QuirkPolicy>(opcode);
+
+		TraceStream() << std::endl;
+		if (status == OpcodeStatus::IncrementPC)
+		{
+			Hot.PC += 2;
+		}
+		return status;
+	}
+
+	void Machine::TickTimers()
+	{
+		if (Hot.DelayTimer > 0)
+			Hot.DelayTimer--;
+		if (Hot.SoundTimer > 0)
+			Hot.SoundTimer--;
+	}
+
+	template <typename QuirkPolicy>
+	bool Machine::RunFrameWith(int instructions_per_frame)
+	{
+		if (Hot.Suspended && Hot.Keys != 0)
+		{
+			uint8_t key = 0;
+			while (!IsKeyDown(key))
+				key++;
+			CompleteKeyWait(key);
+		}
+
+		for (int step = 0; step < instructions_per_frame && !Hot.Suspended; ++step)
+		{
+			OpcodeStatus status = StepWith<QuirkPolicy>();
+			if (!IsRunning(status))
+				return false;
+		}
+		TickTimers();
+		return true;
+	}
+
+	void Machine::CompleteKeyWait(uint8_t key)
+	{
+		if (!Hot.Suspended)
+			return;
+		Hot.Registers[Hot.WaitForKeyboardRegister_Index] = key & 0xF;
+		Hot.Suspended = false;
+		Hot.PC += 2;
+	}
+
+	uint16_t Machine::ReadWord(uint16_t address) const
+	{
+		return static_cast<uint16_t>(Memory.Read(address) << 8) | Memory.Read(static_cast<uint16_t>(address + 1));
+	}
+
+	void Machine::SkipNextInstruction()
+	{
+		Hot.PC += ReadWord(static_cast<uint16_t>(Hot.PC + 2)) == 0xF000 ? 4 : 2;
+	}
+
+	uint8_t Machine::NextRandom()
+	{
+		// xorshift32: each machine has its own sequence, so runs are reproducible
+		Hot.RandomState ^= Hot.RandomState << 13;
+		Hot.RandomState ^= Hot.RandomState >> 17;
+		Hot.RandomState ^= Hot.RandomState << 5;
+		return static_cast<uint8_t>(Hot.RandomState >> 24);
+	}
+
+	std::ostream& Machine::TraceStream()
+	{
+		// A stream without a buffer discards everything written to it
+		static thread_local std::ostream null_stream(nullptr);
+		return Trace ? *Trace : null_stream;
+	}
+
+	OpcodeStatus Machine::Opcode0(const uint16_t opcode)
+	{
+		if ((opcode & 0xFF) == 0xE0)
+		{
+			TraceStream() << "CLS";
+			Screen.Clear();
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0xEE)
+		{
+			if (Hot.SP > 0xF && Hot.SP < 0xFF)
+				return OpcodeStatus::StackOverflow;
+			TraceStream() << "RET";
+			Hot.PC = Hot.Stack[Hot.SP & 0xF];
+			Hot.SP -= 1;
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFFF0) == 0x00C0)
+		{
+			uint8_t rows = opcode & 0xF;
+			TraceStream() << "SCD " << (int)rows;
+			Screen.ScrollDown(rows);
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFFF0) == 0x00D0)
+		{
+			uint8_t rows = opcode & 0xF;
+			TraceStream() << "SCU " << (int)rows;
+			Screen.ScrollUp(rows);
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFFFF) == 0x00FB)
+		{
+			TraceStream() << "SCR";
+			Screen.ScrollRight(4);
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFFFF) == 0x00FC)
+		{
+			TraceStream() << "SCL";
+			Screen.ScrollLeft(4);
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFFFF) == 0x00FD)
+		{
+			TraceStream() << "EXIT";
+			return OpcodeStatus::Exit;
+		}
+		else if ((opcode & 0xFFFF) == 0x00FE)
+		{
+			TraceStream() << "LOW";
+			Screen.SetHighResolution(false);
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFFFF) == 0x00FF)
+		{
+			TraceStream() << "HIGH";
+			Screen.SetHighResolution(true);
+			return OpcodeStatus::IncrementPC;
+		}
+		return OpcodeStatus::NotImplemented;
+	}
+
+	OpcodeStatus Machine::Opcode1(const uint16_t opcode)
+	{
+		uint16_t address = opcode & 0x0FFF;
+		TraceStream() << "JP 0x" << address;
+		Hot.PC = address - 2;
+		return OpcodeStatus::IncrementPC;
+	}
+
+	OpcodeStatus Machine::Opcode2(const uint16_t opcode)
+	{
+		uint16_t address = opcode & 0xFFF;
+		TraceStream() << "CALL 0x" << (int)address;
+		if (Hot.SP > 0xF)
+		{
+			Hot.SP = 0;
+		}
+		else
+		{
+			if (Hot.SP < 0xF)
+			{
+				Hot.SP += 1;
+			}
+			else
+			{
+				return OpcodeStatus::StackOverflow;
+			}
+		}
+		Hot.Stack[Hot.SP] = Hot.PC;
+		Hot.PC = address;
+		return OpcodeStatus::NotIncrementPC;
+	}
+
+	OpcodeStatus Machine::Opcode3(const uint16_t opcode)
+	{
+		uint8_t register_index = (opcode >> 8) & 0xF;
+		uint8_t value = opcode & 0xFF;
+		TraceStream() << "SE V" << (int)register_index << ", 0x" << (int)value;
+		if (Hot.Registers[register_index] == value)
+			SkipNextInstruction();
+		return OpcodeStatus::IncrementPC;
+	}
+
+	OpcodeStatus Machine::Opcode4(const uint16_t opcode)
+	{
+		uint8_t register_index = (opcode >> 8) & 0xF;
+		uint8_t value = opcode & 0xFF;
+		TraceStream() << "SNE V" << (int)register_index << ", 0x" << (int)value;
+		if (Hot.Registers[register_index] != value)
+			SkipNextInstruction();
+		return OpcodeStatus::IncrementPC;
+	}
+
+	OpcodeStatus Machine::Opcode5(const uint16_t opcode)
+	{
+		uint8_t register_x_index = (opcode >> 8) & 0xF;
+		uint8_t register_y_index = (opcode >> 4) & 0xF;
+		if ((opcode & 0xF) == 0x0)
+		{
+			TraceStream() << "SE V" << (int)register_x_index << ", V" << (int)register_y_index;
+			if (Hot.Registers[register_x_index] == Hot.Registers[register_y_index])
+				SkipNextInstruction();
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xF) == 0x2 || (opcode & 0xF) == 0x3)
+		{
+			// XO-CHIP: save or load the range Vx..Vy (in either direction) at I, leaving I unchanged
+			bool save = (opcode & 0xF) == 0x2;
+			TraceStream() << (save ? "SAVE V" : "LOAD V") << (int)register_x_index << " - V" << (int)register_y_index;
+			int step = register_x_index <= register_y_index ? 1 : -1;
+			int count = std::abs(register_y_index - register_x_index) + 1;
+			for (int i = 0; i < count; ++i)
+			{
+				uint16_t address = static_cast<uint16_t>(Hot.I + i);
+				uint8_t& reg = Hot.Registers[register_x_index + i * step];
+				if (save)
+					Memory.Write(address, reg);
+				else
+					reg = Memory.Read(address);
+			}
+			return OpcodeStatus::IncrementPC;
+		}
+		return OpcodeStatus::NotImplemented;
+	}
+
+	OpcodeStatus Machine::Opcode6(const uint16_t opcode)
+	{
+		uint8_t register_index = (opcode >> 8) & 0xF;
+		uint8_t register_value = opcode & 0xFF;
+		Hot.Registers[register_index] = register_value;
+		TraceStream() << "LD V" << (int)register_index << ", 0x" << (int)register_value;
+		return OpcodeStatus::IncrementPC;
+	}
+
+	OpcodeStatus Machine::Opcode7(const uint16_t opcode)
+	{
+		uint8_t register_index = (opcode >> 8) & 0xF;
+		uint8_t value = opcode & 0xFF;
+		TraceStream() << "ADD V" << (int)register_index << ", 0x" << (int)value;
+		Hot.Registers[register_index] += value;
+		return OpcodeStatus::IncrementPC;
+	}
+
+	template <typename QuirkPolicy>
+	OpcodeStatus Machine::Opcode8(const uint16_t opcode)
+	{
+		if ((opcode & 0xF) == 0x0)
+		{
+			uint8_t register_x_index = (opcode >> 8) & 0xF;
+			uint8_t register_y_index = (opcode >> 4) & 0xF;
+			Hot.Registers[register_x_index] = Hot.Registers[register_y_index];
+			TraceStream() << "LD V" << (int)register_x_index << ", V" << (int)register_y_index;
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xF) == 0x1)
+		{
+			uint8_t register_x_index = (opcode >> 8) & 0xF;
+			uint8_t register_y_index = (opcode >> 4) & 0xF;
+			Hot.Registers[register_x_index] |= Hot.Registers[register_y_index];
+			if constexpr (QuirkPolicy::LogicResetsVF)
+				Hot.Registers[0xF] = 0;
+			TraceStream() << "OR V" << (int)register_x_index << ", V" << (int)register_y_index;
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xF) == 0x2)
+		{
+			uint8_t register_x_index = (opcode >> 8) & 0xF;
+			uint8_t register_y_index = (opcode >> 4) & 0xF;
+			Hot.Registers[register_x_index] &= Hot.Registers[register_y_index];
+			if constexpr (QuirkPolicy::LogicResetsVF)
+				Hot.Registers[0xF] = 0;
+			TraceStream() << "AND V" << (int)register_x_index << ", V" << (int)register_y_index;
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xF) == 0x3)
+		{
+			uint8_t register_x_index = (opcode >> 8) & 0xF;
+			uint8_t register_y_index = (opcode >> 4) & 0xF;
+			Hot.Registers[register_x_index] ^= Hot.Registers[register_y_index];
+			if constexpr (QuirkPolicy::LogicResetsVF)
+				Hot.Registers[0xF] = 0;
+			TraceStream() << "XOR V" << (int)register_x_index << ", V" << (int)register_y_index;
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xF) == 0x4)
+		{
+			uint8_t register_x_index = (opcode >> 8) & 0xF;
+			uint8_t register_y_index = (opcode >> 4) & 0xF;
+			int result = static_cast<int>(Hot.Registers[register_x_index]) + Hot.Registers[register_y_index];
+			if (result > 255)
+				Hot.Registers[0xF] = 1;
+			else
+				Hot.Registers[0xF] = 0;
+			Hot.Registers[register_x_index] += Hot.Registers[register_y_index];
+			TraceStream() << "ADD V" << (int)register_x_index << ", V" << (int)register_y_index;
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xF) == 0x5)
+		{
+			uint8_t register_x_index = (opcode >> 8) & 0xF;
+			uint8_t register_y_index = (opcode >> 4) & 0xF;
+			if (Hot.Registers[register_x_index] > Hot.Registers[register_y_index])
+				Hot.Registers[0xF] = 1;
+			else
+				Hot.Registers[0xF] = 0;
+			Hot.Registers[register_x_index] -= Hot.Registers[register_y_index];
+			TraceStream() << "SUB V" << (int)register_x_index << ", V" << (int)register_y_index;
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xF) == 0x6)
+		{
+			uint8_t register_x_index = (opcode >> 8) & 0xF;
+			uint8_t register_y_index = (opcode >> 4) & 0xF;
+			if constexpr (QuirkPolicy::ShiftUsesVy)
+				Hot.Registers[register_x_index] = Hot.Registers[register_y_index];
+			Hot.Registers[0xF] = Hot.Registers[register_x_index] & 0x1;
+			Hot.Registers[register_x_index] >>= 1;
+			TraceStream() << "SHR V" << (int)register_x_index << "{, V" << (int)register_y_index << "}";
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xF) == 0x7)
+		{
+			uint8_t register_x_index = (opcode >> 8) & 0xF;
+			uint8_t register_y_index = (opcode >> 4) & 0xF;
+			if (Hot.Registers[register_y_index] > Hot.Registers[register_x_index])
+				Hot.Registers[0xF] = 1;
+			else
+				Hot.Registers[0xF] = 0;
+			Hot.Registers[register_y_index] -= Hot.Registers[register_x_index];
+			TraceStream() << "SUBN V" << (int)register_x_index << ", V" << (int)register_y_index;
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xF) == 0xE)
+		{
+			uint8_t register_x_index = (opcode >> 8) & 0xF;
+			uint8_t register_y_index = (opcode >> 4) & 0xF;
+			if constexpr (QuirkPolicy::ShiftUsesVy)
+				Hot.Registers[register_x_index] = Hot.Registers[register_y_index];
+			Hot.Registers[0xF] = Hot.Registers[register_x_index] >> 7;
+			Hot.Registers[register_x_index] <<= 1;
+			TraceStream() << "SHL V" << (int)register_x_index << "{, V" << (int)register_y_index << "}";
+			return OpcodeStatus::IncrementPC;
+		}
+		else
+		{
+			return OpcodeStatus::NotImplemented;
+		}
+	}
+
+	OpcodeStatus Machine::Opcode9(const uint16_t opcode)
+	{
+		uint8_t register_x_index = (opcode >> 8) & 0xF;
+		uint8_t register_y_index = (opcode >> 4) & 0xF;
+		TraceStream() << "SNE V" << (int)register_x_index << ", V" << (int)register_y_index;
+		if (Hot.Registers[register_x_index] != Hot.Registers[register_y_index])
+			SkipNextInstruction();
+		return OpcodeStatus::IncrementPC;
+	}
+
+	OpcodeStatus Machine::OpcodeA(const uint16_t opcode)
+	{
+		uint16_t value = (opcode & 0xFFF);
+		TraceStream() << "LD I, 0x" << (int)value;
+		Hot.I = value;
+		return OpcodeStatus::IncrementPC;
+	}
+
+	template <typename QuirkPolicy>
+	OpcodeStatus Machine::OpcodeB(const uint16_t opcode)
+	{
+		uint16_t address = opcode & 0x0fff;
+		uint8_t register_index = QuirkPolicy::JumpUsesVx ? (opcode >> 8) & 0xF : 0;
+		Hot.PC = address + Hot.Registers[register_index];
+		return OpcodeStatus::NotIncrementPC;
+	}
+
+	OpcodeStatus Machine::OpcodeC(const uint16_t opcode)
+	{
+		uint8_t register_index = (opcode >> 8) & 0xF;
+		uint8_t random_mask = opcode & 0xFF;
+		TraceStream() << "RND V" << (int)register_index << ", 0x" << (int)random_mask;
+		Hot.Registers[register_index] = NextRandom() & random_mask;
+		return OpcodeStatus::IncrementPC;
+	}
+
+	template <typename QuirkPolicy>
+	OpcodeStatus Machine::OpcodeD(const uint16_t opcode)
+	{
+		uint8_t register_x_index = (opcode >> 8) & 0xF;
+		uint8_t register_y_index = (opcode >> 4) & 0xF;
+		uint8_t sprite_height = opcode & 0xF;
+		TraceStream() << "DRW V" << (int)register_x_index << ", V" << (int)register_y_index << ", " << (int)sprite_height;
+
+		uint8_t x_coord = Hot.Registers[register_x_index] % Screen.GetWidth();
+		uint8_t y_coord = Hot.Registers[register_y_index] % Screen.GetHeight();
+
+		// XO-CHIP: the sprite data of each selected plane follows the previous one
+		int planes = 0;
+		for (uint8_t mask = Screen.GetSelectedPlanes(); mask; mask >>= 1)
+			planes += mask & 0x1;
+
+		bool collision = false;
+		std::array<uint8_t, 32 * Display::MaxPlanes> sprite;
+		if (sprite_height == 0)
+		{
+			// SUPER-CHIP 16x16 sprite
+			for (int offset = 0; offset < 32 * planes; ++offset)
+			{
+				sprite[offset] = Memory.Read(static_cast<uint16_t>(Hot.I + offset));
+			}
+			collision = Screen.DrawLargeSprite<QuirkPolicy::WrapSprites>(x_coord, y_coord, sprite.data());
+		}
+		else
+		{
+			for (int offset = 0; offset < sprite_height * planes; ++offset)
+			{
+				sprite[offset] = Memory.Read(static_cast<uint16_t>(Hot.I + offset));
+			}
+			collision = Screen.DrawSprite<QuirkPolicy::WrapSprites>(x_coord, y_coord, sprite.data(), sprite_height);
+		}
+		Hot.Registers[0xF] = collision ? 0x1 : 0x0;
+
+		return OpcodeStatus::IncrementPC;
+	}
+
+	OpcodeStatus Machine::OpcodeE(const uint16_t opcode)
+	{
+		if ((opcode & 0xFF) == 0xA1)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			TraceStream() << "SKNP V" << (int)register_index;
+			if (!IsKeyDown(Hot.Registers[register_index]))
+			{
+				SkipNextInstruction();
+			}
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0x9E)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			TraceStream() << "SKP V" << (int)register_index;
+			if (IsKeyDown(Hot.Registers[register_index]))
+			{
+				SkipNextInstruction();
+			}
+			return OpcodeStatus::IncrementPC;
+		}
+		return OpcodeStatus::NotImplemented;
+	}
+
+	template <typename QuirkPolicy>
+	OpcodeStatus Machine::OpcodeF(const uint16_t opcode)
+	{
+		if (opcode == 0xF000)
+		{
+			Hot.I = ReadWord(static_cast<uint16_t>(Hot.PC + 2));
+			TraceStream() << "LD I, LONG 0x" << (int)Hot.I;
+			Hot.PC += 2;
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0x01)
+		{
+			uint8_t planes = (opcode >> 8) & 0xF;
+			TraceStream() << "PLANE " << (int)planes;
+			Screen.SelectPlanes(planes);
+			return OpcodeStatus::IncrementPC;
+		}
+		else if (opcode == 0xF002)
+		{
+			TraceStream() << "AUDIO";
+			for (int i = 0; i < 0x10; ++i)
+			{
+				AudioPattern[i] = Memory.Read(static_cast<uint16_t>(Hot.I + i));
+			}
+			AudioPatternLoaded = true;
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0x3A)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			TraceStream() << "PITCH V" << (int)register_index;
+			Pitch = Hot.Registers[register_index];
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0x55)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			TraceStream() << "LD [I], V" << (int)register_index;
+			for (uint8_t i = 0; i <= register_index; ++i)
+			{
+				Memory.Write(static_cast<uint16_t>(Hot.I + i), Hot.Registers[i]);
+			}
+			if constexpr (QuirkPolicy::LoadStoreIncrementsI)
+				Hot.I += register_index + 1;
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0x65)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			TraceStream() << "LD V" << (int)register_index << ", [I]";
+			for (uint8_t i = 0; i <= register_index; ++i)
+			{
+				Hot.Registers[i] = Memory.Read(static_cast<uint16_t>(Hot.I + i));
+			}
+			if constexpr (QuirkPolicy::LoadStoreIncrementsI)
+				Hot.I += register_index + 1;
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0x33)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			uint8_t value = Hot.Registers[register_index];
+			Memory.Write(Hot.I, value / 100);
+			Memory.Write(static_cast<uint16_t>(Hot.I + 1), (value / 10) % 10);
+			Memory.Write(static_cast<uint16_t>(Hot.I + 2), value % 10);
+			TraceStream() << "LD B, V" << (int)register_index;
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0x29)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			TraceStream() << "LD F, V" << (int)register_index;
+			Hot.I = 5 * Hot.Registers[register_index];
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0x30)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			TraceStream() << "LD HF, V" << (int)register_index;
+			Hot.I = LargeFontAddress + 10 * (Hot.Registers[register_index] & 0xF);
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0x75)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			TraceStream() << "LD R, V" << (int)register_index;
+			for (uint8_t i = 0; i <= register_index; ++i)
+			{
+				Flags[i] = Hot.Registers[i];
+			}
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0x85)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			TraceStream() << "LD V" << (int)register_index << ", R";
+			for (uint8_t i = 0; i <= register_index; ++i)
+			{
+				Hot.Registers[i] = Flags[i];
+			}
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0x0A)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			TraceStream() << "LD V" << (int)register_index << ", K";
+			Hot.WaitForKeyboardRegister_Index = register_index;
+			Hot.Suspended = true;
+			return OpcodeStatus::WaitForKeyboard;
+		}
+		else if ((opcode & 0xFF) == 0x1E)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			TraceStream() << "ADD I, V" << (int)register_index;
+			Hot.I += Hot.Registers[register_index];
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0x18)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			TraceStream() << "LD ST, V" << (int)register_index;
+			Hot.SoundTimer = Hot.Registers[register_index];
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0x15)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			TraceStream() << "LD DT, V" << (int)register_index;
+			Hot.DelayTimer = Hot.Registers[register_index];
+			return OpcodeStatus::IncrementPC;
+		}
+		else if ((opcode & 0xFF) == 0x07)
+		{
+			uint8_t register_index = (opcode >> 8) & 0xF;
+			TraceStream() << "LD V" << (int)register_index << ", DT";
+			Hot.Registers[register_index] = Hot.DelayTimer;
+			return OpcodeStatus::IncrementPC;
+		}
+		else
+		{
+			return OpcodeStatus::NotImplemented;
+		}
+	}
+}
\ No newline at end of file
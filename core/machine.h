@@ -0,0 +1,228 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <vector>
+
+#include "display.h"
+#include "paged_memory.h"
+#include "quirks.h"
+#include "rom_image.h"
+
+namespace chipotto
+{
+	enum class OpcodeStatus
+	{
+		IncrementPC,
+		NotIncrementPC,
+		NotImplemented,
+		StackOverflow,
+		WaitForKeyboard,
+		Exit,
+		Error
+	};
+
+	inline bool IsRunning(OpcodeStatus status)
+	{
+		return status != OpcodeStatus::NotImplemented && status != OpcodeStatus::StackOverflow && status != OpcodeStatus::Exit && status != OpcodeStatus::Error;
+	}
+
+	// Everything the interpreter touches on every instruction, in one cache line.
+	// The rest of Machine (memory page tables, screen, audio, configuration) is
+	// only reached by the opcodes that need it.
+	struct alignas(64) MachineState
+	{
+		std::array<uint8_t, 0x10> Registers = {};
+		uint16_t PC = 0x200;
+		uint16_t I = 0x0;
+		uint16_t Keys = 0;
+		uint8_t SP = 0xFF;
+		uint8_t DelayTimer = 0x0;
+		uint8_t SoundTimer = 0x0;
+		bool Suspended = false;
+		uint8_t WaitForKeyboardRegister_Index = 0;
+		uint32_t RandomState = 0x2545F491;
+		std::array<uint16_t, 0x10> Stack = {};
+	};
+
+	static_assert(sizeof(MachineState) == 64, "the hot state must fit in one cache line");
+	static_assert(offsetof(MachineState, PC) == 0x10 && offsetof(MachineState, RandomState) == 0x1C, "unexpected hot state layout");
+	static_assert(offsetof(MachineState, Stack) == 0x20, "the stack must take the second half of the line");
+
+	// The CHIP-8 CPU, memory, timers and display, with no window, clock or input
+	// device attached: the caller decides when timers tick and which keys are down.
+	// Memory is the full XO-CHIP 64 KB address space; addresses wrap at 0xFFFF.
+	class Machine
+	{
+	public:
+		static constexpr uint16_t LargeFontAddress = 0x50;
+		static constexpr size_t MemorySize = PagedMemory::Size;
+		static constexpr uint16_t ProgramAddress = 0x200;
+		static constexpr size_t MaxRomSize = MemorySize - ProgramAddress;
+		// XO-CHIP pitch register value that plays the pattern at 4000 bits per second
+		static constexpr uint8_t DefaultPitch = 64;
+
+		Machine();
+
+		// Copies share memory pages with the original until either writes to them
+		Machine(const Machine& other) = default;
+		Machine& operator=(const Machine& other) = default;
+
+		// A copy of the running machine (memory, screen, timers, keys and random
+		// state) for exploring another branch; it does not trace
+		Machine Fork() const;
+		// Back to the power-on state: the fonts are restored and registers, timers,
+		// stack, screen and the rest of memory are cleared. The quirk profile, the
+		// trace stream, the random state and the SUPER-CHIP flag registers (which
+		// persist across programs on the HP48) are kept.
+		void Reset();
+		// ROMs are copied to ProgramAddress as is; anything larger than MaxRomSize
+		// is rejected and leaves memory untouched
+		bool LoadFromSpan(std::span<const std::byte> rom);
+		// Maps the image pages into memory without copying, they are only copied
+		// once the program writes to them; the machine keeps the image alive
+		bool LoadFromImage(std::shared_ptr<const RomImage> image);
+		bool LoadFromFile(const std::filesystem::path& path);
+		// Raw copy of size words in host memory order, like LoadFromSpan: on a
+		// little-endian host the caller supplies them byte-swapped (0xE000 for
+		// 00E0)
+		bool LoadFromBuffer(const uint16_t* buf, size_t size);
+		// FNV-1a hash of the last loaded ROM image, the key of the ROM database
+		uint64_t GetRomHash() const { return RomHash; }
+
+		// Everything a program can change (registers, timers, random state, memory,
+		// screen, audio pattern and flag registers) in host byte order, for
+		// snapshot files read back on the same build. Only pages that are not all
+		// zeros are stored.
+		void SaveState(std::vector<uint8_t>& state) const;
+		// Memory is copied out of the state, so it does not need to stay alive;
+		// a state of the wrong size or layout is rejected and changes nothing
+		bool LoadState(std::span<const uint8_t> state);
+		// Fingerprint of the layout SaveState writes: StateVersion, byte order
+		// and the sizes and offsets of the structures it copies as is. States
+		// kept across runs must be dropped when it changes.
+		static uint64_t GetStateLayout();
+
+		OpcodeStatus Step();
+		// Decrements the delay and sound timers, call at 60 Hz
+		void TickTimers();
+		// Runs one 60 Hz frame headless: a pending LD Vx, K completes with the lowest
+		// held key, then up to instructions_per_frame steps and one timer tick.
+		// Returns false once the program hits an unrecoverable opcode.
+		bool RunFrame(int instructions_per_frame);
+
+		// Bit n set means key n of the hex keypad is held down
+		void SetKeys(uint16_t keys) { Hot.Keys = keys; }
+		uint16_t GetKeys() const { return Hot.Keys; }
+		bool IsKeyDown(uint8_t key) const { return (Hot.Keys >> (key & 0xF)) & 0x1; }
+		bool IsWaitingForKey() const { return Hot.Suspended; }
+		// Stores the key in the register of the pending LD Vx, K and resumes;
+		// does nothing when no LD Vx, K is pending
+		void CompleteKeyWait(uint8_t key);
+
+		// Selects one of the interpreter instantiations; the default is Modern
+		void SetQuirks(QuirkProfile profile);
+		QuirkProfile GetQuirks() const { return Profile; }
+
+		void SetRandomSeed(uint32_t seed) { Hot.RandomState = seed ? seed : 0x2545F491; }
+		void SetTraceStream(std::ostream* stream) { Trace = stream; }
+
+		OpcodeStatus Opcode0(const uint16_t opcode);
+		OpcodeStatus Opcode1(const uint16_t opcode);
+		OpcodeStatus Opcode2(const uint16_t opcode);
+		OpcodeStatus Opcode3(const uint16_t opcode);
+		OpcodeStatus Opcode4(const uint16_t opcode);
+		OpcodeStatus Opcode5(const uint16_t opcode);
+		OpcodeStatus Opcode6(const uint16_t opcode);
+		OpcodeStatus Opcode7(const uint16_t opcode);
+		template <typename QuirkPolicy>
+		OpcodeStatus Opcode8(const uint16_t opcode);
+		OpcodeStatus Opcode9(const uint16_t opcode);
+		OpcodeStatus OpcodeA(const uint16_t opcode);
+		template <typename QuirkPolicy>
+		OpcodeStatus OpcodeB(const uint16_t opcode);
+		OpcodeStatus OpcodeC(const uint16_t opcode);
+		template <typename QuirkPolicy>
+		OpcodeStatus OpcodeD(const uint16_t opcode);
+		OpcodeStatus OpcodeE(const uint16_t opcode);
+		template <typename QuirkPolicy>
+		OpcodeStatus OpcodeF(const uint16_t opcode);
+
+		uint16_t GetPC() const { return Hot.PC; }
+		uint16_t GetSP() const { return Hot.SP; }
+		uint16_t GetStackTop() const { return Hot.Stack[0]; }
+		uint16_t GetStackCurrent() const { return Hot.Stack[Hot.SP]; }
+		uint16_t GetCurrentOpcode() const {
+			uint16_t offset = static_cast<uint16_t>(Memory.Read(Hot.PC)) << 8;
+			return Memory.Read(static_cast<uint16_t>(Hot.PC + 1)) + (offset);
+		}
+		uint8_t GetRegisterValue(int index) const { return Hot.Registers[index]; }
+		const std::array<uint8_t, 0x10>& GetRegisters() const { return Hot.Registers; }
+		uint16_t GetI() const { return Hot.I; }
+		uint8_t GetDelayTimer() const { return Hot.DelayTimer; }
+		uint8_t GetSoundTimer() const { return Hot.SoundTimer; }
+		uint8_t GetMemoryLocValue(int index) const { return Memory.Read(static_cast<uint16_t>(index)); }
+		const PagedMemory& GetMemory() const { return Memory; }
+		// Once the ROM is loaded, stepping, drawing, input and timers never touch
+		// the heap except for the one-off copy of a shared page on its first write.
+		// Call this after loading to pay for those copies up front instead.
+		void MakeMemoryPrivate() { Memory.MakePrivate(); }
+		// Written pages come from arena instead of the heap; kept across Reset
+		// and assignment, not passed on to copies (see PagedMemory)
+		void SetPageArena(PageArena* arena) { Memory.SetArena(arena); }
+		const MachineState& GetState() const { return Hot; }
+		// Bytes owned by this instance: the object itself plus its written pages,
+		// some of which a fork may share
+		size_t GetFootprint() const { return sizeof(Machine) + Memory.GetPrivatePageCount() * PagedMemory::PageSize; }
+		// SUPER-CHIP RPL user flags, saved and restored by Fx75 and Fx85
+		const std::array<uint8_t, 0x10>& GetFlags() const { return Flags; }
+		void SetFlags(const std::array<uint8_t, 0x10>& flags) { Flags = flags; }
+		// XO-CHIP audio: a 128-bit pattern loaded by F002, played back while the
+		// sound timer runs at 4000 * 2^((pitch - 64) / 48) bits per second
+		bool HasAudioPattern() const { return AudioPatternLoaded; }
+		const std::array<uint8_t, 0x10>& GetAudioPattern() const { return AudioPattern; }
+		uint8_t GetPitch() const { return Pitch; }
+
+		Display& GetDisplay() { return Screen; }
+		const Display& GetDisplay() const { return Screen; }
+
+	private:
+		using StepFunction = OpcodeStatus (Machine::*)();
+		using RunFrameFunction = bool (Machine::*)(int);
+
+		template <typename QuirkPolicy>
+		OpcodeStatus StepWith();
+		template <typename QuirkPolicy>
+		bool RunFrameWith(int instructions_per_frame);
+		template <typename QuirkPolicy>
+		OpcodeStatus Execute(const uint16_t opcode);
+
+		bool LoadBytes(std::span<const std::byte> rom, uint64_t hash);
+		uint16_t ReadWord(uint16_t address) const;
+		// Skips the next instruction, which is four bytes long if it is F000 NNNN
+		void SkipNextInstruction();
+		uint8_t NextRandom();
+		std::ostream& TraceStream();
+
+		MachineState Hot;
+		StepFunction StepImpl = nullptr;
+		RunFrameFunction RunFrameImpl = nullptr;
+		PagedMemory Memory;
+		std::shared_ptr<const RomImage> Image;
+		std::array<uint8_t, 0x10> Flags = {};
+		std::array<uint8_t, 0x10> AudioPattern = {};
+		QuirkProfile Profile = QuirkProfile::Modern;
+		uint64_t RomHash = 0;
+		uint8_t Pitch = DefaultPitch;
+		bool AudioPatternLoaded = false;
+
+		std::ostream* Trace = nullptr;
+		Display Screen;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "machine_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace chipotto
+{
+	static size_t RoundUp(size_t size, size_t alignment)
+	{
+		return (size + alignment - 1) / alignment * alignment;
+	}
+
+	// Explicit huge pages first, then ordinary pages (with a transparent huge
+	// page hint on Linux)
+	static void* AllocateArena(size_t& size, bool& huge_pages)
+	{
+#ifdef _WIN32
+		size_t large_page = GetLargePageMinimum();
+		if (large_page)
+		{
+			size_t large_size = RoundUp(size, large_page);
+			void* arena = VirtualAlloc(nullptr, large_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (arena)
+			{
+				size = large_size;
+				huge_pages = true;
+				return arena;
+			}
+		}
+		huge_pages = false;
+		return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+		const size_t huge_page = 2 * 1024 * 1024;
+		size = RoundUp(size, huge_page);
+#ifdef MAP_HUGETLB
+		void* arena = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (arena != MAP_FAILED)
+		{
+			huge_pages = true;
+			return arena;
+		}
+#endif
+		huge_pages = false;
+		void* pages = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (pages == MAP_FAILED)
+			return nullptr;
+#ifdef MADV_HUGEPAGE
+		madvise(pages, size, MADV_HUGEPAGE);
+#endif
+		return pages;
+#endif
+	}
+
+	// Address space only: Windows commits it chunk by chunk through CommitArena,
+	// Linux maps it without reserving swap and backs it on first touch
+	static void* ReserveArena(size_t& size)
+	{
+		const size_t chunk = PageArena::CommitChunkSize;
+		size = RoundUp(size, chunk);
+#ifdef _WIN32
+		return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_READWRITE);
+#else
+		void* pages = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (pages == MAP_FAILED)
+			return nullptr;
+#ifdef MADV_HUGEPAGE
+		madvise(pages, size, MADV_HUGEPAGE);
+#endif
+		return pages;
+#endif
+	}
+
+#ifdef _WIN32
+	static bool CommitArena(void* address, size_t size)
+	{
+		return VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+	}
+#endif
+
+	static void FreeArena(void* arena, size_t size)
+	{
+#ifdef _WIN32
+		(void)size;
+		VirtualFree(arena, 0, MEM_RELEASE);
+#else
+		munmap(arena, size);
+#endif
+	}
+
+	MachinePool::MachinePool(size_t capacity, WorkerPool* workers)
+	{
+		ArenaSize = std::max<size_t>(capacity, 1) * sizeof(Machine);
+		Slots = static_cast<Machine*>(AllocateArena(ArenaSize, HugePages));
+		if (!Slots)
+		{
+			ArenaSize = 0;
+			return;
+		}
+
+		Capacity = capacity;
+		// Room for every page of every slot, but only reserved: what is never
+		// written never costs memory. Without it pages simply come from the heap.
+		PageMemorySize = std::max<size_t>(capacity, 1) * PagedMemory::PageCount * PageArena::BlockSize;
+		PageMemory = ReserveArena(PageMemorySize);
+		if (PageMemory)
+		{
+#ifdef _WIN32
+			Pages.Attach(PageMemory, PageMemorySize, CommitArena);
+#else
+			Pages.Attach(PageMemory, PageMemorySize);
+#endif
+		}
+		else
+		{
+			PageMemorySize = 0;
+		}
+
+		if (workers)
+		{
+			// First touch decides the NUMA node of a page. Use the same bands
+			// as RunFrame.
+			workers->ParallelFor(static_cast<int>(Capacity), [this](int begin, int end)
+			{
+				std::memset(static_cast<void*>(Slots + begin), 0, (end - begin) * sizeof(Machine));
+			});
+		}
+		States.assign(Capacity, PoolSlotState::Free);
+		// Lowest indices on top, so a fresh pool hands out slots in order
+		FreeSlots.reserve(Capacity);
+		for (size_t index = Capacity; index > 0; --index)
+			FreeSlots.push_back(static_cast<uint32_t>(index - 1));
+	}
+
+	MachinePool::~MachinePool()
+	{
+		if (!Slots)
+			return;
+		for (uint32_t index = 0; index < Capacity; ++index)
+		{
+			if (States[index] != PoolSlotState::Free)
+				Slots[index].~Machine();
+		}
+		FreeArena(Slots, ArenaSize);
+		if (PageMemory)
+			FreeArena(PageMemory, PageMemorySize);
+	}
+
+	uint32_t MachinePool::Acquire()
+	{
+		if (FreeSlots.empty())
+			return InvalidIndex;
+
+		uint32_t index = FreeSlots.back();
+		FreeSlots.pop_back();
+		new (&Slots[index]) Machine();
+		Slots[index].SetPageArena(&Pages);
+		States[index] = PoolSlotState::Running;
+		return index;
+	}
+
+	void MachinePool::Release(uint32_t index)
+	{
+		if (index >= Capacity || States[index] == PoolSlotState::Free)
+			return;
+
+		Slots[index].~Machine();
+		States[index] = PoolSlotState::Free;
+		FreeSlots.push_back(index);
+	}
+
+	void MachinePool::RunFrame(int instructions_per_frame, WorkerPool* workers)
+	{
+		if (!workers)
+		{
+			RunFrameRange(instructions_per_frame, 0, static_cast<uint32_t>(Capacity));
+			return;
+		}
+		workers->ParallelFor(static_cast<int>(Capacity), [&](int begin, int end)
+		{
+			RunFrameRange(instructions_per_frame, begin, end);
+		});
+	}
+
+	void MachinePool::RunFrameRange(int instructions_per_frame, uint32_t begin, uint32_t end)
+	{
+		for (uint32_t index = begin; index < end; ++index)
+		{
+			if (States[index] == PoolSlotState::Running && !Slots[index].RunFrame(instructions_per_frame))
+				States[index] = PoolSlotState::Stopped;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "machine.h"
+#include "worker_pool.h"
+
+namespace chipotto
+{
+	enum class PoolSlotState : uint8_t
+	{
+		Free,
+		Running,
+		// RunFrame hit an unrecoverable opcode; the slot stays taken until released
+		Stopped
+	};
+
+	// Headless machines laid out back to back in one arena, backed by huge pages
+	// when the system has them. Free slots form a stack, so Acquire and Release
+	// are O(1) and never touch the heap; a slot index stays valid until it is
+	// released, which makes it a cheap session handle.
+	//
+	// Given the worker pool that will run it, the pool places each band of slots
+	// in memory local to the worker that steps it. Every worker touches its own
+	// band of the arena first, so the pages come from that worker's NUMA node,
+	// and RunFrame keeps the same bands on the same workers.
+	//
+	// Pages the machines write to come from a PageArena in a second region
+	// with room for every slot to make all of its memory private. The region
+	// is only reserved and blocks are committed chunk by chunk as they are
+	// carved, so they land on the node of the worker that wrote first, and
+	// copy-on-write never reaches the heap. Copies of a pooled
+	// machine may share those pages and must not outlive the pool.
+	class MachinePool
+	{
+	public:
+		static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+		explicit MachinePool(size_t capacity, WorkerPool* workers = nullptr);
+		~MachinePool();
+
+		MachinePool(const MachinePool& other) = delete;
+		MachinePool& operator=(const MachinePool& other) = delete;
+
+		// A machine in its power-on state, or InvalidIndex when the pool is full
+		uint32_t Acquire();
+		void Release(uint32_t index);
+
+		Machine& operator[](uint32_t index) { return Slots[index]; }
+		const Machine& operator[](uint32_t index) const { return Slots[index]; }
+		PoolSlotState GetState(uint32_t index) const { return States[index]; }
+
+		size_t GetCapacity() const { return Capacity; }
+		size_t GetActiveCount() const { return Capacity - FreeSlots.size(); }
+		size_t GetArenaSize() const { return ArenaSize; }
+		bool UsesHugePages() const { return HugePages; }
+		const PageArena& GetPageArena() const { return Pages; }
+
+		// Runs one frame on every running machine, split into bands over the
+		// workers when a pool is given. Pass the same pool the arena was placed
+		// with to keep the memory local.
+		void RunFrame(int instructions_per_frame, WorkerPool* workers = nullptr);
+
+		// Calls function(index, machine) for every taken slot, in index order
+		template<typename Function>
+		void ForEach(Function&& function)
+		{
+			for (uint32_t index = 0; index < Capacity; ++index)
+			{
+				if (States[index] != PoolSlotState::Free)
+					function(index, Slots[index]);
+			}
+		}
+
+	private:
+		void RunFrameRange(int instructions_per_frame, uint32_t begin, uint32_t end);
+
+		Machine* Slots = nullptr;
+		size_t Capacity = 0;
+		size_t ArenaSize = 0;
+		bool HugePages = false;
+		void* PageMemory = nullptr;
+		size_t PageMemorySize = 0;
+		PageArena Pages;
+		std::vector<PoolSlotState> States;
+		std::vector<uint32_t> FreeSlots;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace chipotto
+{
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	bool MappedFile::Open(const std::filesystem::path& path)
+	{
+		Close();
+#ifdef _WIN32
+		HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size))
+		{
+			CloseHandle(file);
+			return false;
+		}
+		if (file_size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			Opened = true;
+			return true;
+		}
+
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!mapping)
+			return false;
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!view)
+		{
+			CloseHandle(mapping);
+			return false;
+		}
+		MappingHandle = mapping;
+		Size = static_cast<size_t>(file_size.QuadPart);
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat status;
+		if (fstat(fd, &status) != 0)
+		{
+			::close(fd);
+			return false;
+		}
+		if (status.st_size == 0)
+		{
+			::close(fd);
+			Opened = true;
+			return true;
+		}
+
+		void* view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (view == MAP_FAILED)
+			return false;
+		Size = static_cast<size_t>(status.st_size);
+#endif
+		Data = static_cast<const uint8_t*>(view);
+		Opened = true;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		Opened = false;
+		if (!Data)
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile(Data);
+		CloseHandle(static_cast<HANDLE>(MappingHandle));
+		MappingHandle = nullptr;
+#else
+		munmap(const_cast<uint8_t*>(Data), Size);
+#endif
+		Data = nullptr;
+		Size = 0;
+	}
+}
\ No newline at end of file
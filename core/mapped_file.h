@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace chipotto
+{
+	// Read-only view of a whole file, mapped into memory (mmap, or a file mapping
+	// on Windows). Pages are only read from disk when they are touched. An empty
+	// file cannot be mapped: it opens as an empty view with no data.
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile& other) = delete;
+		MappedFile& operator=(const MappedFile& other) = delete;
+
+		bool Open(const std::filesystem::path& path);
+		void Close();
+		bool IsOpen() const { return Opened; }
+
+		const uint8_t* GetData() const { return Data; }
+		size_t GetSize() const { return Size; }
+
+	private:
+		const uint8_t* Data = nullptr;
+		size_t Size = 0;
+		bool Opened = false;
+#ifdef _WIN32
+		void* MappingHandle = nullptr;
+#endif
+	};
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "paged_memory.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace chipotto
+{
+	static const PagedMemory::Page ZeroPage = {};
+
+	// Hands allocate_shared blocks from the arena, falling back to the heap
+	template<typename T>
+	struct PageAllocator
+	{
+		using value_type = T;
+
+		PageArena* Arena;
+
+		explicit PageAllocator(PageArena* arena) : Arena(arena) {}
+		template<typename U>
+		PageAllocator(const PageAllocator<U>& other) : Arena(other.Arena) {}
+
+		T* allocate(size_t count)
+		{
+			void* block = Arena->Allocate(count * sizeof(T));
+			return static_cast<T*>(block ? block : ::operator new(count * sizeof(T)));
+		}
+
+		void deallocate(T* pointer, size_t)
+		{
+			if (!Arena->Deallocate(pointer))
+				::operator delete(pointer);
+		}
+
+		template<typename U>
+		bool operator==(const PageAllocator<U>& other) const { return Arena == other.Arena; }
+	};
+
+	PagedMemory::PagedMemory()
+	{
+		Pages.fill(ZeroPage.data());
+	}
+
+	PagedMemory::PagedMemory(const PagedMemory& other) : Pages(other.Pages), PrivatePages(other.PrivatePages)
+	{
+	}
+
+	PagedMemory& PagedMemory::operator=(const PagedMemory& other)
+	{
+		Pages = other.Pages;
+		PrivatePages = other.PrivatePages;
+		return *this;
+	}
+
+	void PagedMemory::Copy(uint16_t address, const uint8_t* data, size_t size)
+	{
+		while (size > 0)
+		{
+			size_t index = address / PageSize;
+			size_t offset = address % PageSize;
+			size_t count = std::min(size, PageSize - offset);
+			uint8_t* page = PrivatePages[index].use_count() == 1 ? PrivatePages[index]->data() : CopyOnWrite(index);
+			memcpy(page + offset, data, count);
+			address = static_cast<uint16_t>(address + count);
+			data += count;
+			size -= count;
+		}
+	}
+
+	void PagedMemory::Share(size_t index, const uint8_t* page)
+	{
+		PrivatePages[index].reset();
+		Pages[index] = page;
+	}
+
+	void PagedMemory::Clear()
+	{
+		for (auto& page : PrivatePages)
+			page.reset();
+		Pages.fill(ZeroPage.data());
+	}
+
+	void PagedMemory::MakePrivate()
+	{
+		for (size_t index = 0; index < PageCount; ++index)
+		{
+			if (PrivatePages[index].use_count() != 1)
+				CopyOnWrite(index);
+		}
+	}
+
+	size_t PagedMemory::GetPrivatePageCount() const
+	{
+		return std::count_if(PrivatePages.begin(), PrivatePages.end(), [](const auto& page) { return page != nullptr; });
+	}
+
+	uint8_t* PagedMemory::CopyOnWrite(size_t index)
+	{
+		auto page = Arena ? std::allocate_shared<Page>(PageAllocator<Page>(Arena)) : std::make_shared<Page>();
+		memcpy(page->data(), Pages[index], PageSize);
+		Pages[index] = page->data();
+		PrivatePages[index] = std::move(page);
+		return PrivatePages[index]->data();
+	}
+
+	void PageArena::Attach(void* memory, size_t size, CommitFunction commit)
+	{
+		std::lock_guard<std::mutex> lock(Lock);
+		Begin = static_cast<uint8_t*>(memory);
+		End = Begin + size / BlockSize * BlockSize;
+		Reserved = Begin + size;
+		Commit = commit;
+		Committed = commit ? Begin : Reserved;
+		Unused = Begin;
+		FreeList = nullptr;
+		BlocksInUse = 0;
+	}
+
+	void* PageArena::Allocate(size_t size)
+	{
+		if (size > BlockSize)
+			return nullptr;
+
+		std::lock_guard<std::mutex> lock(Lock);
+		void* block = nullptr;
+		if (FreeList)
+		{
+			block = FreeList;
+			FreeList = FreeList->Next;
+		}
+		else if (Unused != End)
+		{
+			if (Unused + BlockSize > Committed)
+			{
+				size_t chunk = std::min(CommitChunkSize, static_cast<size_t>(Reserved - Committed));
+				if (!Commit(Committed, chunk))
+					return nullptr;
+				Committed += chunk;
+			}
+			block = Unused;
+			Unused += BlockSize;
+		}
+		if (block)
+			BlocksInUse++;
+		return block;
+	}
+
+	bool PageArena::Deallocate(void* block)
+	{
+		uint8_t* address = static_cast<uint8_t*>(block);
+		if (address < Begin || address >= End)
+			return false;
+
+		std::lock_guard<std::mutex> lock(Lock);
+		FreeList = new (block) FreeBlock{ FreeList };
+		BlocksInUse--;
+		return true;
+	}
+
+	size_t PageArena::GetBlocksInUse() const
+	{
+		std::lock_guard<std::mutex> lock(Lock);
+		return BlocksInUse;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace chipotto
+{
+	class PageArena;
+
+	// 64 KB of guest memory in 256-byte pages. Pages start out pointing at shared,
+	// immutable data (the zero page, the fonts, a mapped ROM image) and are copied
+	// into a private page on the first write, so an instance only pays for the
+	// pages it has written to. Copies share the written pages too, each side
+	// copies a page again before writing to it while the other still holds it.
+	class PagedMemory
+	{
+	public:
+		static constexpr size_t Size = 0x10000;
+		static constexpr size_t PageSize = 0x100;
+		static constexpr size_t PageCount = Size / PageSize;
+
+		using Page = std::array<uint8_t, PageSize>;
+
+		PagedMemory();
+
+		// A copy shares every page but not the arena, which belongs to where
+		// the memory lives: assigning keeps the destination's
+		PagedMemory(const PagedMemory& other);
+		PagedMemory& operator=(const PagedMemory& other);
+
+		// Private pages are taken from arena instead of the heap from now on;
+		// it must outlive every page it hands out
+		void SetArena(PageArena* arena) { Arena = arena; }
+
+		uint8_t Read(uint16_t address) const { return Pages[address / PageSize][address % PageSize]; }
+		const uint8_t* GetPage(size_t index) const { return Pages[index]; }
+		void Write(uint16_t address, uint8_t value)
+		{
+			size_t index = address / PageSize;
+			uint8_t* page = PrivatePages[index].use_count() == 1 ? PrivatePages[index]->data() : CopyOnWrite(index);
+			page[address % PageSize] = value;
+		}
+		// Copies size bytes in at address, wrapping around the end of memory
+		void Copy(uint16_t address, const uint8_t* data, size_t size);
+
+		// Maps page index to PageSize bytes of shared data, which must stay alive
+		// and unchanged for as long as it is mapped
+		void Share(size_t index, const uint8_t* page);
+		// Maps every page to the zero page and frees the private ones
+		void Clear();
+		// Copies every page that is still shared, so that later writes never
+		// allocate; memory then costs the full 64 KB again
+		void MakePrivate();
+
+		// Written pages, whether or not a copy still shares them
+		size_t GetPrivatePageCount() const;
+
+	private:
+		uint8_t* CopyOnWrite(size_t index);
+
+		std::array<const uint8_t*, PageCount> Pages;
+		std::array<std::shared_ptr<Page>, PageCount> PrivatePages;
+		PageArena* Arena = nullptr;
+	};
+
+	// Fixed-size blocks for private pages, each holding a page and the
+	// shared_ptr control block allocated along with it. Blocks are carved in
+	// order from memory the owner supplies, so only the part in use is ever
+	// touched, and recycled through a free list. Any thread may allocate and
+	// free; when the memory runs out pages come from the heap again.
+	class PageArena
+	{
+	public:
+		static constexpr size_t BlockSize = PagedMemory::PageSize + 64;
+		static constexpr size_t CommitChunkSize = 2 * 1024 * 1024;
+
+		// Makes size bytes at address usable, for memory that is only reserved
+		using CommitFunction = bool (*)(void* address, size_t size);
+
+		PageArena() = default;
+
+		PageArena(const PageArena& other) = delete;
+		PageArena& operator=(const PageArena& other) = delete;
+
+		// size bytes at memory, which must be aligned to 64 bytes. With commit,
+		// the memory is committed CommitChunkSize bytes at a time as blocks
+		// are first carved from it.
+		void Attach(void* memory, size_t size, CommitFunction commit = nullptr);
+		// nullptr when size does not fit in a block or no block is left
+		void* Allocate(size_t size);
+		// False if block did not come from this arena
+		bool Deallocate(void* block);
+
+		size_t GetBlocksInUse() const;
+
+	private:
+		struct FreeBlock
+		{
+			FreeBlock* Next;
+		};
+
+		mutable std::mutex Lock;
+		uint8_t* Begin = nullptr;
+		uint8_t* End = nullptr;
+		uint8_t* Unused = nullptr;
+		uint8_t* Committed = nullptr;
+		uint8_t* Reserved = nullptr;
+		CommitFunction Commit = nullptr;
+		FreeBlock* FreeList = nullptr;
+		size_t BlocksInUse = 0;
+	};
+}
\ No newline at end of file
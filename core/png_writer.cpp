@@ -0,0 +1,257 @@
+#include "png_writer.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace chipotto
+{
+	namespace
+	{
+		class BitWriter
+		{
+		public:
+			explicit BitWriter(std::vector<uint8_t>& output) : Output(output) {}
+
+			void Put(uint32_t value, int bits)
+			{
+				Buffer |= static_cast<uint64_t>(value) << Count;
+				Count += bits;
+				while (Count >= 8)
+				{
+					Output.push_back(static_cast<uint8_t>(Buffer));
+					Buffer >>= 8;
+					Count -= 8;
+				}
+			}
+
+			// Huffman codes are stored most significant bit first
+			void PutCode(uint32_t code, int bits)
+			{
+				uint32_t reversed = 0;
+				for (int i = 0; i < bits; ++i)
+					reversed |= ((code >> i) & 0x1) << (bits - 1 - i);
+				Put(reversed, bits);
+			}
+
+			void Flush()
+			{
+				if (Count > 0)
+					Output.push_back(static_cast<uint8_t>(Buffer));
+				Buffer = 0;
+				Count = 0;
+			}
+
+		private:
+			std::vector<uint8_t>& Output;
+			uint64_t Buffer = 0;
+			int Count = 0;
+		};
+
+		const uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		const uint8_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		const uint16_t DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		const uint8_t DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		void PutLiteral(BitWriter& writer, int symbol)
+		{
+			if (symbol < 144)
+				writer.PutCode(0x30 + symbol, 8);
+			else if (symbol < 256)
+				writer.PutCode(0x190 + symbol - 144, 9);
+			else if (symbol < 280)
+				writer.PutCode(symbol - 256, 7);
+			else
+				writer.PutCode(0xC0 + symbol - 280, 8);
+		}
+
+		void PutMatch(BitWriter& writer, int length, int distance)
+		{
+			int length_code = 28;
+			while (LengthBase[length_code] > length)
+				length_code--;
+			PutLiteral(writer, 257 + length_code);
+			writer.Put(length - LengthBase[length_code], LengthExtra[length_code]);
+
+			int distance_code = 29;
+			while (DistanceBase[distance_code] > distance)
+				distance_code--;
+			writer.PutCode(distance_code, 5);
+			writer.Put(distance - DistanceBase[distance_code], DistanceExtra[distance_code]);
+		}
+
+		void PutU32(std::vector<uint8_t>& output, uint32_t value)
+		{
+			output.push_back(static_cast<uint8_t>(value >> 24));
+			output.push_back(static_cast<uint8_t>(value >> 16));
+			output.push_back(static_cast<uint8_t>(value >> 8));
+			output.push_back(static_cast<uint8_t>(value));
+		}
+
+		void PutChunk(std::vector<uint8_t>& output, const char* type, const std::vector<uint8_t>& data)
+		{
+			PutU32(output, static_cast<uint32_t>(data.size()));
+			size_t start = output.size();
+			output.insert(output.end(), type, type + 4);
+			output.insert(output.end(), data.begin(), data.end());
+			PutU32(output, PngWriter::Crc32(output.data() + start, output.size() - start));
+		}
+	}
+
+	void PngWriter::Deflate(const uint8_t* data, size_t size, std::vector<uint8_t>& output)
+	{
+		const int window_size = 32768;
+		const int min_match = 3;
+		const int max_match = 258;
+		const int max_chain = 32;
+		const int hash_bits = 15;
+
+		std::vector<int32_t> head(static_cast<size_t>(1) << hash_bits, -1);
+		std::vector<int32_t> previous(window_size, -1);
+		auto hash = [data](size_t position)
+		{
+			uint32_t value = data[position] | (data[position + 1] << 8) | (data[position + 2] << 16);
+			return (value * 2654435761u) >> (32 - hash_bits);
+		};
+		auto insert = [&](size_t position)
+		{
+			uint32_t key = hash(position);
+			previous[position % window_size] = head[key];
+			head[key] = static_cast<int32_t>(position);
+		};
+
+		BitWriter writer(output);
+		// Single final block with the fixed Huffman tables
+		writer.Put(1, 1);
+		writer.Put(1, 2);
+
+		size_t position = 0;
+		while (position < size)
+		{
+			int best_length = 0;
+			int best_distance = 0;
+			if (position + min_match <= size)
+			{
+				int limit = static_cast<int>(std::min<size_t>(max_match, size - position));
+				int32_t candidate = head[hash(position)];
+				for (int chain = 0; chain < max_chain && candidate >= 0; ++chain)
+				{
+					int distance = static_cast<int>(position - candidate);
+					if (distance > window_size)
+						break;
+					int length = 0;
+					while (length < limit && data[candidate + length] == data[position + length])
+						length++;
+					if (length > best_length)
+					{
+						best_length = length;
+						best_distance = distance;
+						if (length == limit)
+							break;
+					}
+					int32_t next = previous[candidate % window_size];
+					if (next >= candidate)
+						break;
+					candidate = next;
+				}
+			}
+
+			if (best_length >= min_match)
+			{
+				PutMatch(writer, best_length, best_distance);
+				for (int i = 0; i < best_length; ++i, ++position)
+				{
+					if (position + min_match <= size)
+						insert(position);
+				}
+			}
+			else
+			{
+				PutLiteral(writer, data[position]);
+				if (position + min_match <= size)
+					insert(position);
+				position++;
+			}
+		}
+
+		PutLiteral(writer, 256);
+		writer.Flush();
+	}
+
+	uint32_t PngWriter::Crc32(const uint8_t* data, size_t size, uint32_t crc)
+	{
+		static const std::array<uint32_t, 256> table = []()
+		{
+			std::array<uint32_t, 256> entries = {};
+			for (uint32_t n = 0; n < 256; ++n)
+			{
+				uint32_t value = n;
+				for (int bit = 0; bit < 8; ++bit)
+					value = value & 1 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+				entries[n] = value;
+			}
+			return entries;
+		}();
+
+		crc = ~crc;
+		for (size_t i = 0; i < size; ++i)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	uint32_t PngWriter::Adler32(const uint8_t* data, size_t size)
+	{
+		uint32_t a = 1;
+		uint32_t b = 0;
+		for (size_t i = 0; i < size; ++i)
+		{
+			a = (a + data[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+		return (b << 16) | a;
+	}
+
+	void PngWriter::Encode(int width, int height, const uint8_t* indices, const std::vector<PngColor>& palette, std::vector<uint8_t>& output)
+	{
+		const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		output.assign(signature, signature + 8);
+
+		std::vector<uint8_t> header;
+		PutU32(header, static_cast<uint32_t>(width));
+		PutU32(header, static_cast<uint32_t>(height));
+		// 8 bit indexed color, deflate, adaptive filtering, no interlace
+		header.insert(header.end(), { 8, 3, 0, 0, 0 });
+		PutChunk(output, "IHDR", header);
+
+		std::vector<uint8_t> colors;
+		for (const PngColor& color : palette)
+			colors.insert(colors.end(), color.begin(), color.end());
+		PutChunk(output, "PLTE", colors);
+
+		// Every scanline uses filter type 0 (none)
+		std::vector<uint8_t> scanlines;
+		scanlines.reserve(static_cast<size_t>(width + 1) * height);
+		for (int y = 0; y < height; ++y)
+		{
+			scanlines.push_back(0);
+			scanlines.insert(scanlines.end(), indices + static_cast<size_t>(y) * width, indices + static_cast<size_t>(y + 1) * width);
+		}
+
+		std::vector<uint8_t> compressed = { 0x78, 0x01 };
+		Deflate(scanlines.data(), scanlines.size(), compressed);
+		PutU32(compressed, Adler32(scanlines.data(), scanlines.size()));
+		PutChunk(output, "IDAT", compressed);
+		PutChunk(output, "IEND", {});
+	}
+
+	bool PngWriter::Write(const std::filesystem::path& path, int width, int height, const uint8_t* indices, const std::vector<PngColor>& palette)
+	{
+		std::vector<uint8_t> encoded;
+		Encode(width, height, indices, palette, encoded);
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open())
+			return false;
+		file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+		return file.good();
+	}
+}
\ No newline at end of file
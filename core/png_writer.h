@@ -0,0 +1,24 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace chipotto
+{
+	using PngColor = std::array<uint8_t, 3>;
+
+	// Palette PNG encoder (8 bits per index) with a small fixed-Huffman deflate:
+	// CHIP-8 screens are long runs of two colors, which LZ77 alone shrinks well.
+	class PngWriter
+	{
+	public:
+		static void Encode(int width, int height, const uint8_t* indices, const std::vector<PngColor>& palette, std::vector<uint8_t>& output);
+		static bool Write(const std::filesystem::path& path, int width, int height, const uint8_t* indices, const std::vector<PngColor>& palette);
+
+		static void Deflate(const uint8_t* data, size_t size, std::vector<uint8_t>& output);
+		static uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+		static uint32_t Adler32(const uint8_t* data, size_t size);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include "presenter.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace chipotto
+{
+	static uint32_t PackColor(SDL_Color color)
+	{
+		// SDL_PIXELFORMAT_RGBA32 is laid out R, G, B, A in memory regardless of endianness
+		uint8_t bytes[4] = { color.r, color.g, color.b, color.a };
+		uint32_t packed;
+		memcpy(&packed, bytes, sizeof(packed));
+		return packed;
+	}
+
+	Presenter::Presenter()
+	{
+		for (int value = 0; value < 256; ++value)
+		{
+			// Pixel n of the byte (most significant bit first) lands in nibble n
+			uint32_t spread = 0;
+			for (int bit = 0; bit < 8; ++bit)
+				spread |= static_cast<uint32_t>((value >> (7 - bit)) & 0x1) << (4 * bit);
+			SpreadTable[value] = spread;
+		}
+		for (int index = 0; index < Display::MaxColors; ++index)
+		{
+			const Display::Rgb& rgb = Display::DefaultPalette[index];
+			Colors[index] = PackColor({ rgb[0], rgb[1], rgb[2], 0xFF });
+		}
+		SetPalette({ 0x00, 0x00, 0x00, 0x00 }, { 0xFF, 0xFF, 0xFF, 0xFF });
+	}
+
+	void Presenter::Attach(SDL_Renderer* renderer, SDL_Texture* texture)
+	{
+		Renderer = renderer;
+		Texture = texture;
+		FullUpload = true;
+	}
+
+	void Presenter::EnableUpscaling(SDL_Texture* window_texture, int scale, UpscaleFilter filter, WorkerPool* pool)
+	{
+		UpscaledTexture = window_texture;
+		Scaler.Configure(scale, filter, pool);
+		Scaler.SetColors(Colors[0], Colors[1]);
+		FullUpload = true;
+	}
+
+	void Presenter::SetPalette(SDL_Color off, SDL_Color on)
+	{
+		Colors[0] = PackColor(off);
+		Colors[1] = PackColor(on);
+		UpdateTwoColorTable();
+	}
+
+	void Presenter::SetColor(int index, SDL_Color color)
+	{
+		index &= Display::MaxColors - 1;
+		Colors[index] = PackColor(color);
+		if (index < 2)
+			UpdateTwoColorTable();
+		FullUpload = true;
+	}
+
+	void Presenter::UpdateTwoColorTable()
+	{
+		for (int value = 0; value < 256; ++value)
+		{
+			for (int bit = 0; bit < 8; ++bit)
+			{
+				ExpandTable[value][bit] = Colors[(value >> (7 - bit)) & 0x1];
+			}
+		}
+		Scaler.SetColors(Colors[0], Colors[1]);
+		FullUpload = true;
+	}
+
+	void Presenter::ExpandRow(const Display::Row& row, int words, uint32_t* pixels) const
+	{
+		for (int w = 0; w < words; ++w)
+		{
+			uint64_t word = row[w];
+			for (int shift = 56; shift >= 0; shift -= 8)
+			{
+				memcpy(pixels, ExpandTable[(word >> shift) & 0xFF].data(), sizeof(uint32_t) * 8);
+				pixels += 8;
+			}
+		}
+	}
+
+	void Presenter::ExpandPlanes(const Display& display, int y, uint32_t* pixels) const
+	{
+		for (int w = 0; w < display.GetActiveWords(); ++w)
+		{
+			for (int shift = 56; shift >= 0; shift -= 8)
+			{
+				uint32_t nibbles = 0;
+				for (int plane = 0; plane < Display::MaxPlanes; ++plane)
+					nibbles |= SpreadTable[(display.GetRow(plane, y)[w] >> shift) & 0xFF] << plane;
+				for (int pixel = 0; pixel < 8; ++pixel)
+					pixels[pixel] = Colors[(nibbles >> (4 * pixel)) & 0xF];
+				pixels += 8;
+			}
+		}
+	}
+
+	bool Presenter::RowChanged(const Display& display, int y) const
+	{
+		for (int plane = 0; plane < Display::MaxPlanes; ++plane)
+		{
+			if (display.GetRow(plane, y) != PresentedPlanes[plane][y])
+				return true;
+		}
+		return false;
+	}
+
+	void Presenter::StoreRow(const Display& display, int y)
+	{
+		for (int plane = 0; plane < Display::MaxPlanes; ++plane)
+			PresentedPlanes[plane][y] = display.GetRow(plane, y);
+	}
+
+	bool Presenter::Present(const Display& display)
+	{
+		if (!Renderer || !Texture)
+			return false;
+
+		int height = display.GetHeight();
+		if (display.IsHighResolution() != PresentedHighResolution)
+		{
+			PresentedHighResolution = display.IsHighResolution();
+			Scaler.SetResolution(PresentedHighResolution);
+			FullUpload = true;
+		}
+
+		bool upscale = UpscaledTexture && display.IsMonochrome();
+		if (upscale != PresentedUpscaled)
+		{
+			PresentedUpscaled = upscale;
+			FullUpload = true;
+		}
+
+		if (upscale)
+		{
+			int first_row = height;
+			int last_row = 0;
+			for (int y = 0; y < height; ++y)
+			{
+				if (FullUpload || RowChanged(display, y))
+				{
+					first_row = std::min(first_row, y);
+					last_row = y + 1;
+				}
+			}
+			if (first_row < last_row && !UploadUpscaled(display, first_row, last_row))
+				return false;
+		}
+		else
+		{
+			// Upload contiguous runs of changed rows with one SDL_UpdateTexture each
+			int run_start = -1;
+			for (int y = 0; y <= height; ++y)
+			{
+				bool changed = y < height && (FullUpload || RowChanged(display, y));
+				if (changed && run_start < 0)
+				{
+					run_start = y;
+				}
+				else if (!changed && run_start >= 0)
+				{
+					if (!Upload(display, run_start, y - run_start))
+						return false;
+					run_start = -1;
+				}
+			}
+		}
+		FullUpload = false;
+
+		if (upscale)
+		{
+			SDL_RenderCopy(Renderer, UpscaledTexture, nullptr, nullptr);
+		}
+		else
+		{
+			SDL_Rect source = { 0, 0, display.GetWidth(), height };
+			SDL_RenderCopy(Renderer, Texture, &source, nullptr);
+		}
+		SDL_RenderPresent(Renderer);
+		return true;
+	}
+
+	bool Presenter::Upload(const Display& display, int first_row, int row_count)
+	{
+		for (int y = first_row; y < first_row + row_count; ++y)
+		{
+			uint32_t* pixels = Staging.data() + y * Display::MaxWidth;
+			if (display.IsMonochrome())
+				ExpandRow(display.GetRow(y), display.GetActiveWords(), pixels);
+			else
+				ExpandPlanes(display, y, pixels);
+			StoreRow(display, y);
+		}
+
+		SDL_Rect rect = { 0, first_row, display.GetWidth(), row_count };
+		int result = SDL_UpdateTexture(Texture, &rect, Staging.data() + first_row * Display::MaxWidth, Display::MaxWidth * sizeof(uint32_t));
+		if (result != 0)
+		{
+			SDL_Log("Failed to update texture: %s", SDL_GetError());
+			FullUpload = true;
+			return false;
+		}
+
+		RowsUploaded += row_count;
+		return true;
+	}
+
+	bool Presenter::UploadUpscaled(const Display& display, int first_row, int last_row)
+	{
+		// Smoothing reads the rows above and below, so their output changes too
+		if (Scaler.GetFilter() != UpscaleFilter::Nearest)
+		{
+			first_row = std::max(first_row - 1, 0);
+			last_row = std::min(last_row + 1, display.GetHeight());
+		}
+
+		int scale = Scaler.GetScale();
+		SDL_Rect rect = { 0, first_row * scale, Scaler.GetOutputWidth(), (last_row - first_row) * scale };
+		uint8_t* pixels = nullptr;
+		int pitch;
+		if (SDL_LockTexture(UpscaledTexture, &rect, reinterpret_cast<void**>(&pixels), &pitch) != 0)
+		{
+			SDL_Log("Failed to lock texture: %s", SDL_GetError());
+			FullUpload = true;
+			return false;
+		}
+
+		Scaler.Render(display, first_row, last_row, pixels, pitch);
+		SDL_UnlockTexture(UpscaledTexture);
+
+		for (int y = first_row; y < last_row; ++y)
+		{
+			StoreRow(display, y);
+		}
+		RowsUploaded += last_row - first_row;
+		return true;
+	}
+}
\ No newline at end of file
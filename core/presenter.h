@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "SDL.h"
+
+#include "display.h"
+#include "upscaler.h"
+
+namespace chipotto
+{
+	// Expands the 1-bit display into an RGBA32 streaming texture. Bytes are
+	// expanded through a 256-entry table (8 pixels per lookup) and only the rows
+	// that changed since the last presented frame are uploaded. The texture is
+	// sized for the high resolution mode; low resolution uses its top-left part.
+	//
+	// Once XO-CHIP planes beyond the first are in use, each byte of every plane
+	// is spread to one bit per 4-bit nibble, the planes are combined with shifts
+	// and the 8 colour indices go through the palette. The upscaling filters are
+	// two-colour only, so such frames take the texture path.
+	class Presenter
+	{
+	public:
+		Presenter();
+
+		void Attach(SDL_Renderer* renderer, SDL_Texture* texture);
+		void EnableUpscaling(SDL_Texture* window_texture, int scale, UpscaleFilter filter, WorkerPool* pool);
+		// Back to the streaming texture stretched by the renderer
+		void DisableUpscaling() { UpscaledTexture = nullptr; FullUpload = true; }
+		bool IsUpscaling() const { return UpscaledTexture != nullptr; }
+		UpscaleFilter GetUpscaleFilter() const { return Scaler.GetFilter(); }
+		void SetPalette(SDL_Color off, SDL_Color on);
+		void SetColor(int index, SDL_Color color);
+		void Invalidate() { FullUpload = true; }
+
+		bool Present(const Display& display);
+		void ExpandRow(const Display::Row& row, int words, uint32_t* pixels) const;
+		void ExpandPlanes(const Display& display, int y, uint32_t* pixels) const;
+
+		uint64_t GetRowsUploaded() const { return RowsUploaded; }
+
+	private:
+		void UpdateTwoColorTable();
+		bool Upload(const Display& display, int first_row, int row_count);
+		bool UploadUpscaled(const Display& display, int first_row, int last_row);
+		bool RowChanged(const Display& display, int y) const;
+		void StoreRow(const Display& display, int y);
+
+		SDL_Renderer* Renderer = nullptr;
+		SDL_Texture* Texture = nullptr;
+		SDL_Texture* UpscaledTexture = nullptr;
+		Upscaler Scaler;
+
+		std::array<uint32_t, Display::MaxColors> Colors;
+		std::array<std::array<uint32_t, 8>, 256> ExpandTable;
+		std::array<uint32_t, 256> SpreadTable;
+		std::array<Display::Frame, Display::MaxPlanes> PresentedPlanes = {};
+		std::array<uint32_t, Display::MaxWidth * Display::MaxHeight> Staging = {};
+		bool PresentedHighResolution = false;
+		bool PresentedUpscaled = false;
+		bool FullUpload = true;
+		uint64_t RowsUploaded = 0;
+	};
+}
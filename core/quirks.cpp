@@ -0,0 +1,34 @@
+#include "quirks.h"
+
+namespace chipotto
+{
+	static constexpr QuirkProfile Profiles[] = { QuirkProfile::Modern, QuirkProfile::CosmacVip, QuirkProfile::SuperChip, QuirkProfile::XoChip };
+
+	const char* GetQuirkProfileName(QuirkProfile profile)
+	{
+		switch (profile)
+		{
+		case QuirkProfile::CosmacVip:
+			return "vip";
+		case QuirkProfile::SuperChip:
+			return "schip";
+		case QuirkProfile::XoChip:
+			return "xochip";
+		default:
+			return "modern";
+		}
+	}
+
+	bool ParseQuirkProfile(const std::string& name, QuirkProfile& profile)
+	{
+		for (QuirkProfile candidate : Profiles)
+		{
+			if (name == GetQuirkProfileName(candidate))
+			{
+				profile = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+}
\ No newline at end of file
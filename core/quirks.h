@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace chipotto
+{
+	// Behaviours that differ between CHIP-8 interpreters. Each profile is a
+	// policy type whose constants are folded into its own instantiation of the
+	// interpreter, so a quirk costs nothing at run time.
+	struct ModernQuirks
+	{
+		// 8xy6/8xyE copy Vy into Vx before shifting
+		static constexpr bool ShiftUsesVy = false;
+		// Fx55/Fx65 leave I pointing past the last register
+		static constexpr bool LoadStoreIncrementsI = false;
+		// Bxnn jumps to xnn + Vx instead of nnn + V0
+		static constexpr bool JumpUsesVx = false;
+		// Sprites wrap around the screen edges instead of being clipped
+		static constexpr bool WrapSprites = false;
+		// 8xy1/8xy2/8xy3 reset VF
+		static constexpr bool LogicResetsVF = false;
+	};
+
+	struct CosmacVipQuirks
+	{
+		static constexpr bool ShiftUsesVy = true;
+		static constexpr bool LoadStoreIncrementsI = true;
+		static constexpr bool JumpUsesVx = false;
+		static constexpr bool WrapSprites = false;
+		static constexpr bool LogicResetsVF = true;
+	};
+
+	struct SuperChipQuirks
+	{
+		static constexpr bool ShiftUsesVy = false;
+		static constexpr bool LoadStoreIncrementsI = false;
+		static constexpr bool JumpUsesVx = true;
+		static constexpr bool WrapSprites = false;
+		static constexpr bool LogicResetsVF = false;
+	};
+
+	struct XoChipQuirks
+	{
+		static constexpr bool ShiftUsesVy = true;
+		static constexpr bool LoadStoreIncrementsI = true;
+		static constexpr bool JumpUsesVx = false;
+		static constexpr bool WrapSprites = true;
+		static constexpr bool LogicResetsVF = false;
+	};
+
+	// The pre-instantiated profiles; Modern is the emulator's historical behaviour
+	enum class QuirkProfile : uint8_t
+	{
+		Modern,
+		CosmacVip,
+		SuperChip,
+		XoChip
+	};
+
+	const char* GetQuirkProfileName(QuirkProfile profile);
+	// Accepts the names returned by GetQuirkProfileName
+	bool ParseQuirkProfile(const std::string& name, QuirkProfile& profile);
+}
\ No newline at end of file
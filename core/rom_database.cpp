@@ -0,0 +1,89 @@
+#include "rom_database.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace chipotto
+{
+	bool RomDatabase::Open(const std::filesystem::path& path)
+	{
+		Close();
+		if (!File.Open(path) || File.GetSize() < HeaderSize)
+		{
+			File.Close();
+			return false;
+		}
+
+		const uint8_t* header = File.GetData();
+		uint32_t magic;
+		uint16_t version;
+		uint16_t entry_size;
+		uint64_t count;
+		memcpy(&magic, header, sizeof(magic));
+		memcpy(&version, header + 4, sizeof(version));
+		memcpy(&entry_size, header + 6, sizeof(entry_size));
+		memcpy(&count, header + 8, sizeof(count));
+		if (magic != Magic || version != Version || entry_size != sizeof(RomDatabaseEntry) ||
+			count > (File.GetSize() - HeaderSize) / sizeof(RomDatabaseEntry))
+		{
+			File.Close();
+			return false;
+		}
+
+		// The mapping is page aligned, so entries after the header are 8-byte aligned
+		Entries = reinterpret_cast<const RomDatabaseEntry*>(header + HeaderSize);
+		Count = static_cast<size_t>(count);
+		return true;
+	}
+
+	void RomDatabase::Close()
+	{
+		File.Close();
+		Entries = nullptr;
+		Count = 0;
+	}
+
+	const RomDatabaseEntry* RomDatabase::Find(uint64_t hash) const
+	{
+		if (!Entries)
+			return nullptr;
+
+		const RomDatabaseEntry* end = Entries + Count;
+		const RomDatabaseEntry* entry = std::lower_bound(Entries, end, hash,
+			[](const RomDatabaseEntry& candidate, uint64_t value) { return candidate.Hash < value; });
+		return entry != end && entry->Hash == hash ? entry : nullptr;
+	}
+
+	bool RomDatabase::Write(const std::filesystem::path& path, std::vector<RomDatabaseEntry> entries)
+	{
+		std::sort(entries.begin(), entries.end(),
+			[](const RomDatabaseEntry& a, const RomDatabaseEntry& b) { return a.Hash < b.Hash; });
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		uint8_t header[HeaderSize] = {};
+		uint16_t entry_size = sizeof(RomDatabaseEntry);
+		uint64_t count = entries.size();
+		memcpy(header, &Magic, sizeof(Magic));
+		memcpy(header + 4, &Version, sizeof(Version));
+		memcpy(header + 6, &entry_size, sizeof(entry_size));
+		memcpy(header + 8, &count, sizeof(count));
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(RomDatabaseEntry));
+		return static_cast<bool>(file);
+	}
+
+	uint64_t HashRom(const uint8_t* data, size_t size)
+	{
+		uint64_t hash = 0xCBF29CE484222325ULL;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= data[i];
+			hash *= 0x100000001B3ULL;
+		}
+		return hash;
+	}
+}
\ No newline at end of file
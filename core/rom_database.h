@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <type_traits>
+#include <vector>
+
+#include "mapped_file.h"
+#include "quirks.h"
+
+namespace chipotto
+{
+	enum class RomDisplayMode : uint8_t
+	{
+		Default,
+		Nearest,
+		Scale2x,
+		Scale4x
+	};
+
+	inline constexpr std::array<uint8_t, 0x10> DefaultKeyLayout = { 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9, 0xA, 0xB, 0xC, 0xD, 0xE, 0xF };
+
+	// One known ROM. KeyLayout gives, for each CHIP-8 key, the keypad position
+	// (in the default 1234/QWER/ASDF/ZXCV layout) of the host key that drives it.
+	struct RomDatabaseEntry
+	{
+		uint64_t Hash = 0;
+		// Zero keeps the emulator's default
+		uint16_t InstructionsPerFrame = 0;
+		QuirkProfile Quirks = QuirkProfile::Modern;
+		RomDisplayMode DisplayMode = RomDisplayMode::Default;
+		std::array<uint8_t, 0x10> KeyLayout = DefaultKeyLayout;
+		uint32_t Reserved = 0;
+	};
+
+	static_assert(sizeof(QuirkProfile) == 1 && sizeof(RomDatabaseEntry) == 32, "database entries are stored as is");
+	static_assert(std::is_trivially_copyable_v<RomDatabaseEntry>, "database entries are stored as is");
+
+	// Fixed-size entries sorted by hash after a 16-byte header, in little-endian
+	// byte order. The file is mapped and searched in place with a binary search:
+	// opening it reads nothing but the header, however many ROMs it lists.
+	class RomDatabase
+	{
+	public:
+		static constexpr uint32_t Magic = 0x42443843; // "C8DB"
+		static constexpr uint16_t Version = 1;
+		static constexpr size_t HeaderSize = 16;
+
+		bool Open(const std::filesystem::path& path);
+		void Close();
+		bool IsOpen() const { return Entries != nullptr; }
+		size_t GetCount() const { return Count; }
+
+		const RomDatabaseEntry* Find(uint64_t hash) const;
+
+		// Sorts the entries and writes a database file
+		static bool Write(const std::filesystem::path& path, std::vector<RomDatabaseEntry> entries);
+
+	private:
+		MappedFile File;
+		const RomDatabaseEntry* Entries = nullptr;
+		size_t Count = 0;
+	};
+
+	// 64-bit FNV-1a of the ROM image
+	uint64_t HashRom(const uint8_t* data, size_t size);
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#include "rom_image.h"
+#include "rom_database.h"
+
+#include <cstring>
+
+namespace chipotto
+{
+	std::shared_ptr<const RomImage> RomImage::Open(const std::filesystem::path& path)
+	{
+		std::shared_ptr<RomImage> image(new RomImage());
+		if (!image->File.Open(path))
+			return nullptr;
+
+		image->Hash = HashRom(image->File.GetData(), image->File.GetSize());
+		size_t tail_size = image->File.GetSize() % PagedMemory::PageSize;
+		if (tail_size)
+			memcpy(image->TailPage.data(), image->File.GetData() + image->File.GetSize() - tail_size, tail_size);
+		return image;
+	}
+
+	const uint8_t* RomImage::GetPage(size_t index) const
+	{
+		bool partial = (index + 1) * PagedMemory::PageSize > File.GetSize();
+		return partial ? TailPage.data() : File.GetData() + index * PagedMemory::PageSize;
+	}
+}
\ No newline at end of file
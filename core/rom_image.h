@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+#include "mapped_file.h"
+#include "paged_memory.h"
+
+namespace chipotto
+{
+	// A ROM file mapped read-only and hashed once. Machines map its pages straight
+	// into guest memory, so any number of instances of one ROM share one copy and
+	// cost a single open.
+	class RomImage
+	{
+	public:
+		static std::shared_ptr<const RomImage> Open(const std::filesystem::path& path);
+
+		RomImage(const RomImage& other) = delete;
+		RomImage& operator=(const RomImage& other) = delete;
+
+		std::span<const std::byte> GetBytes() const { return { reinterpret_cast<const std::byte*>(File.GetData()), File.GetSize() }; }
+		size_t GetSize() const { return File.GetSize(); }
+		uint64_t GetHash() const { return Hash; }
+
+		// Guest memory pages of the ROM; the last one is padded with zeros
+		size_t GetPageCount() const { return (File.GetSize() + PagedMemory::PageSize - 1) / PagedMemory::PageSize; }
+		const uint8_t* GetPage(size_t index) const;
+
+	private:
+		RomImage() = default;
+
+		MappedFile File;
+		uint64_t Hash = 0;
+		// A copy of the trailing partial page, the mapping may end right after it
+		PagedMemory::Page TailPage = {};
+	};
+}
\ No newline at end of file
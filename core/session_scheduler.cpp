@@ -0,0 +1,242 @@
+#include "session_scheduler.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace chipotto
+{
+	SessionScheduler::SessionScheduler(int thread_count, int instructions_per_frame, int slice_budget)
+		: InstructionsPerFrame(std::max(1, instructions_per_frame)), SliceBudget(std::max(1, slice_budget)), BackgroundBudget(InstructionsPerFrame)
+	{
+		if (thread_count <= 0)
+			thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+		Workers.reserve(thread_count);
+		for (int i = 0; i < thread_count; ++i)
+			Workers.emplace_back(&SessionScheduler::WorkerLoop, this);
+	}
+
+	SessionScheduler::~SessionScheduler()
+	{
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			Stopping = true;
+		}
+		WakeCondition.notify_all();
+		for (std::thread& worker : Workers)
+			worker.join();
+
+		for (auto& session : Sessions)
+			session->Task.Handle.destroy();
+	}
+
+	SessionScheduler::SessionId SessionScheduler::AddSession(SessionPriority priority)
+	{
+		Sessions.push_back(std::make_unique<Session>());
+		Session& session = *Sessions.back();
+		session.Priority = priority;
+		session.Task = Run(session);
+		return static_cast<SessionId>(Sessions.size() - 1);
+	}
+
+	SessionScheduler::SessionId SessionScheduler::TryAddSession(SessionPriority priority)
+	{
+		if (!CanAdmit(priority))
+			return InvalidSession;
+		return AddSession(priority);
+	}
+
+	bool SessionScheduler::CanAdmit(SessionPriority priority) const
+	{
+		// Background and paused sessions are throttled instead of turned away
+		if (priority != SessionPriority::Foreground || NanosecondsPerInstruction == 0.0)
+			return true;
+
+		size_t foreground = std::count_if(Sessions.begin(), Sessions.end(),
+			[](const std::unique_ptr<Session>& session) { return session->Priority == SessionPriority::Foreground; });
+		double demand = static_cast<double>(foreground + 1) * InstructionsPerFrame * NanosecondsPerInstruction;
+		double capacity = static_cast<double>(FramePeriod.count()) * Workers.size() * 3 / 4;
+		return demand <= capacity;
+	}
+
+	double SessionScheduler::GetCpuShare(SessionId id) const
+	{
+		if (TotalCpuNanoseconds == 0)
+			return 0.0;
+		return static_cast<double>(Sessions[id]->Stats.CpuNanoseconds) / TotalCpuNanoseconds;
+	}
+
+	void SessionScheduler::SetKeys(SessionId id, uint16_t keys)
+	{
+		Session& session = *Sessions[id];
+		session.Keys.store(keys, std::memory_order_release);
+
+		SessionState parked = SessionState::Parked;
+		if (keys != 0)
+			session.State.compare_exchange_strong(parked, SessionState::FrameDone, std::memory_order_acq_rel);
+	}
+
+	void SessionScheduler::RunFrame()
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bool queued = false;
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			FrameCount++;
+			FrameDeadline = start + FramePeriod;
+			FrameCpuNanoseconds = 0;
+			FrameInstructions = 0;
+			// Foreground sessions go first so that they are done before the
+			// background ones compete for the workers
+			for (SessionPriority priority : { SessionPriority::Foreground, SessionPriority::Background })
+			{
+				for (auto& session : Sessions)
+				{
+					if (session->Priority != priority || session->State.load(std::memory_order_acquire) != SessionState::FrameDone)
+						continue;
+					session->FrameBudget = priority == SessionPriority::Foreground ? InstructionsPerFrame : BackgroundBudget;
+					RunQueue.push_back(session.get());
+				}
+			}
+			Pending = RunQueue.size();
+			queued = Pending > 0;
+		}
+
+		if (queued)
+		{
+			WakeCondition.notify_all();
+			std::unique_lock<std::mutex> lock(Mutex);
+			DoneCondition.wait(lock, [this]() { return Pending == 0; });
+		}
+
+		LastFrameTime = std::chrono::steady_clock::now() - start;
+		AdaptBudgets();
+	}
+
+	void SessionScheduler::AdaptBudgets()
+	{
+		if (FrameInstructions > 0)
+		{
+			double sample = static_cast<double>(FrameCpuNanoseconds) / FrameInstructions;
+			NanosecondsPerInstruction = NanosecondsPerInstruction == 0.0 ? sample : NanosecondsPerInstruction * 0.875 + sample * 0.125;
+		}
+
+		// Back off quickly when the frame gets close to its deadline and give
+		// the budget back slowly
+		if (LastFrameTime > FramePeriod * 3 / 4)
+			BackgroundBudget /= 2;
+		else if (LastFrameTime < FramePeriod / 2 && BackgroundBudget < InstructionsPerFrame)
+			BackgroundBudget++;
+	}
+
+	bool SessionScheduler::CompleteKeyWait(Session& session)
+	{
+		uint16_t keys = session.Keys.load(std::memory_order_acquire);
+		if (keys == 0)
+			return false;
+
+		session.Core.SetKeys(keys);
+		session.Core.CompleteKeyWait(static_cast<uint8_t>(std::countr_zero(keys)));
+		return true;
+	}
+
+	SessionTask SessionScheduler::Run(Session& session)
+	{
+		Machine& machine = session.Core;
+		int budget = session.FrameBudget;
+		machine.SetKeys(session.Keys.load(std::memory_order_acquire));
+		while (true)
+		{
+			if (machine.IsWaitingForKey() && !CompleteKeyWait(session))
+			{
+				session.ParkedFrame = FrameCount;
+				session.State.store(SessionState::Parked, std::memory_order_release);
+				// A key may have come in between the check and parking: take it back
+				// unless SetKeys already queued the session for the next frame
+				SessionState parked = SessionState::Parked;
+				if (!CompleteKeyWait(session) || !session.State.compare_exchange_strong(parked, SessionState::Running, std::memory_order_acq_rel))
+				{
+					co_await std::suspend_always{};
+					// Timers kept running in the frames this session sat out
+					uint64_t missed = std::min<uint64_t>(FrameCount - session.ParkedFrame, 0xFF);
+					for (uint64_t frame = 0; frame < missed; ++frame)
+						machine.TickTimers();
+					budget = session.FrameBudget;
+					continue;
+				}
+			}
+
+			if (budget == 0)
+			{
+				machine.TickTimers();
+				session.State.store(SessionState::FrameDone, std::memory_order_release);
+				co_await std::suspend_always{};
+				budget = session.FrameBudget;
+				machine.SetKeys(session.Keys.load(std::memory_order_acquire));
+				continue;
+			}
+
+			int slice = std::min(budget, SliceBudget);
+			for (int step = 0; step < slice; ++step)
+			{
+				budget--;
+				session.Stats.Instructions++;
+				OpcodeStatus status = machine.Step();
+				if (status == OpcodeStatus::WaitForKeyboard)
+					break;
+				if (!IsRunning(status))
+				{
+					session.State.store(SessionState::Finished, std::memory_order_release);
+					co_return;
+				}
+			}
+
+			if (budget > 0 && !machine.IsWaitingForKey())
+			{
+				session.State.store(SessionState::Yielded, std::memory_order_release);
+				co_await std::suspend_always{};
+			}
+		}
+	}
+
+	void SessionScheduler::WorkerLoop()
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		while (true)
+		{
+			WakeCondition.wait(lock, [this]() { return Stopping || !RunQueue.empty(); });
+			if (Stopping)
+				return;
+
+			Session* session = RunQueue.front();
+			RunQueue.pop_front();
+			lock.unlock();
+
+			uint64_t instructions = session->Stats.Instructions;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			session->State.store(SessionState::Running, std::memory_order_release);
+			session->Task.Handle.resume();
+			SessionState state = session->State.load(std::memory_order_acquire);
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+			uint64_t cpu = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+			session->Stats.CpuNanoseconds += cpu;
+
+			lock.lock();
+			FrameCpuNanoseconds += cpu;
+			TotalCpuNanoseconds += cpu;
+			FrameInstructions += session->Stats.Instructions - instructions;
+			if (state == SessionState::Yielded)
+			{
+				RunQueue.push_back(session);
+				continue;
+			}
+
+			session->Stats.Frames++;
+			if (end > FrameDeadline)
+				session->Stats.DeadlineMisses++;
+			if (--Pending == 0)
+				DoneCondition.notify_all();
+		}
+	}
+}
\ No newline at end of file
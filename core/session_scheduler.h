@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "machine.h"
+
+namespace chipotto
+{
+	enum class SessionState : uint8_t
+	{
+		// Waiting for the next RunFrame
+		FrameDone,
+		Running,
+		// Used up its slice; goes to the back of the run queue
+		Yielded,
+		// Blocked on LD Vx, K until SetKeys reports a key
+		Parked,
+		// Hit an unrecoverable opcode
+		Finished
+	};
+
+	enum class SessionPriority : uint8_t
+	{
+		// Always gets the full instructions-per-frame budget
+		Foreground,
+		// Runs on the budget the foreground sessions leave over
+		Background,
+		// Not scheduled at all; the machine, timers included, is frozen
+		Paused
+	};
+
+	struct SessionStats
+	{
+		uint64_t Frames = 0;
+		uint64_t DeadlineMisses = 0;
+		uint64_t Instructions = 0;
+		uint64_t CpuNanoseconds = 0;
+	};
+
+	// Coroutine handle owned by the scheduler; sessions start suspended
+	struct SessionTask
+	{
+		struct promise_type
+		{
+			SessionTask get_return_object() { return { std::coroutine_handle<promise_type>::from_promise(*this) }; }
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			std::suspend_always final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() { std::terminate(); }
+		};
+
+		std::coroutine_handle<promise_type> Handle;
+	};
+
+	// Runs many headless machines as coroutines on a few worker threads. Each
+	// frame every runnable session executes instructions_per_frame instructions in
+	// slices of slice_budget, going to the back of the run queue between slices so
+	// that one busy session cannot hold a worker for a whole frame. A session that
+	// waits on LD Vx, K is parked and costs nothing until SetKeys wakes it; its
+	// timers catch up with the frames it missed when it resumes.
+	//
+	// Foreground sessions always get the full budget. Background sessions share a
+	// budget that halves whenever a frame runs past three quarters of the frame
+	// period and grows back by one instruction per frame while there is headroom,
+	// so foreground sessions keep their 60 Hz deadline on a loaded host.
+	// TryAddSession turns away foreground sessions the measured capacity cannot
+	// carry.
+	class SessionScheduler
+	{
+	public:
+		using SessionId = uint32_t;
+		static constexpr SessionId InvalidSession = UINT32_MAX;
+		static constexpr std::chrono::nanoseconds DefaultFramePeriod { 1000000000 / 60 };
+
+		explicit SessionScheduler(int thread_count = 0, int instructions_per_frame = 11, int slice_budget = 4);
+		~SessionScheduler();
+
+		SessionScheduler(const SessionScheduler& other) = delete;
+		SessionScheduler& operator=(const SessionScheduler& other) = delete;
+
+		// Load the ROM through GetMachine before the next RunFrame. Not to be
+		// called while RunFrame is running.
+		SessionId AddSession(SessionPriority priority = SessionPriority::Foreground);
+		// Returns InvalidSession when the session would not fit in the measured
+		// capacity
+		SessionId TryAddSession(SessionPriority priority = SessionPriority::Foreground);
+		bool CanAdmit(SessionPriority priority) const;
+		Machine& GetMachine(SessionId id) { return Sessions[id]->Core; }
+		SessionState GetState(SessionId id) const { return Sessions[id]->State.load(std::memory_order_acquire); }
+		size_t GetSessionCount() const { return Sessions.size(); }
+
+		// Takes effect from the next RunFrame
+		void SetPriority(SessionId id, SessionPriority priority) { Sessions[id]->Priority = priority; }
+		SessionPriority GetPriority(SessionId id) const { return Sessions[id]->Priority; }
+
+		const SessionStats& GetStats(SessionId id) const { return Sessions[id]->Stats; }
+		// Fraction of the CPU time spent on all sessions that went to this one
+		double GetCpuShare(SessionId id) const;
+
+		// Safe from any thread; a parked session resumes in the next frame once a
+		// key is down
+		void SetKeys(SessionId id, uint16_t keys);
+
+		// Runs one 60 Hz frame of every session that is not parked or finished and
+		// returns when they have all reached the end of it
+		void RunFrame();
+		uint64_t GetFrameCount() const { return FrameCount; }
+		int GetThreadCount() const { return static_cast<int>(Workers.size()); }
+
+		void SetFramePeriod(std::chrono::nanoseconds frame_period) { FramePeriod = frame_period; }
+		std::chrono::nanoseconds GetFramePeriod() const { return FramePeriod; }
+		int GetBackgroundBudget() const { return BackgroundBudget; }
+		std::chrono::nanoseconds GetLastFrameTime() const { return LastFrameTime; }
+
+	private:
+		struct Session
+		{
+			Machine Core;
+			SessionTask Task;
+			std::atomic<SessionState> State = SessionState::FrameDone;
+			std::atomic<uint16_t> Keys = 0;
+			uint64_t ParkedFrame = 0;
+			SessionPriority Priority = SessionPriority::Foreground;
+			int FrameBudget = 0;
+			SessionStats Stats;
+		};
+
+		SessionTask Run(Session& session);
+		bool CompleteKeyWait(Session& session);
+		void WorkerLoop();
+		void AdaptBudgets();
+
+		int InstructionsPerFrame;
+		int SliceBudget;
+		uint64_t FrameCount = 0;
+
+		std::chrono::nanoseconds FramePeriod = DefaultFramePeriod;
+		std::chrono::nanoseconds LastFrameTime { 0 };
+		std::chrono::steady_clock::time_point FrameDeadline;
+		int BackgroundBudget;
+		// Running estimate of the host cost of one instruction, 0 until measured
+		double NanosecondsPerInstruction = 0.0;
+		uint64_t FrameCpuNanoseconds = 0;
+		uint64_t FrameInstructions = 0;
+		uint64_t TotalCpuNanoseconds = 0;
+		std::vector<std::unique_ptr<Session>> Sessions;
+
+		std::vector<std::thread> Workers;
+		std::mutex Mutex;
+		std::condition_variable WakeCondition;
+		std::condition_variable DoneCondition;
+		std::deque<Session*> RunQueue;
+		size_t Pending = 0;
+		bool Stopping = false;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "shared_framebuffer.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace chipotto
+{
+	SharedFramebuffer::~SharedFramebuffer()
+	{
+		Close();
+	}
+
+	bool SharedFramebuffer::Create(const std::string& name)
+	{
+		if (!Map(name, true))
+			return false;
+
+		Layout->Magic = SharedFrameLayout::MagicValue;
+		Layout->Version = SharedFrameLayout::CurrentVersion;
+		Layout->Sequence.store(0, std::memory_order_relaxed);
+		Layout->Width = Display::LowResWidth;
+		Layout->Height = Display::LowResHeight;
+		Layout->WordsPerRow = Display::WordsPerRow;
+		Layout->State = {};
+		Layout->Rows = {};
+		return true;
+	}
+
+	bool SharedFramebuffer::Open(const std::string& name)
+	{
+		if (!Map(name, false))
+			return false;
+
+		if (Layout->Magic != SharedFrameLayout::MagicValue || Layout->Version != SharedFrameLayout::CurrentVersion)
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	bool SharedFramebuffer::Map(const std::string& name, bool create)
+	{
+		Close();
+		size_t size = sizeof(SharedFrameLayout);
+#ifdef _WIN32
+		HANDLE mapping = create
+			? CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(size), name.c_str())
+			: OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+		if (!mapping)
+			return false;
+
+		void* view = MapViewOfFile(mapping, create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, size);
+		if (!view)
+		{
+			CloseHandle(mapping);
+			return false;
+		}
+		MappingHandle = mapping;
+		Name = name;
+#else
+		// POSIX shared memory object names start with a single slash
+		Name = name.empty() || name[0] != '/' ? "/" + name : name;
+		int fd = create ? shm_open(Name.c_str(), O_CREAT | O_RDWR, 0644) : shm_open(Name.c_str(), O_RDONLY, 0);
+		if (fd < 0)
+			return false;
+
+		if (create && ftruncate(fd, static_cast<off_t>(size)) != 0)
+		{
+			::close(fd);
+			shm_unlink(Name.c_str());
+			return false;
+		}
+
+		void* view = mmap(nullptr, size, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (view == MAP_FAILED)
+		{
+			if (create)
+				shm_unlink(Name.c_str());
+			return false;
+		}
+#endif
+		Layout = static_cast<SharedFrameLayout*>(view);
+		Owner = create;
+		return true;
+	}
+
+	void SharedFramebuffer::Close()
+	{
+		if (!Layout)
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile(Layout);
+		CloseHandle(static_cast<HANDLE>(MappingHandle));
+		MappingHandle = nullptr;
+#else
+		munmap(Layout, sizeof(SharedFrameLayout));
+		if (Owner)
+			shm_unlink(Name.c_str());
+#endif
+		Layout = nullptr;
+		Owner = false;
+	}
+
+	void SharedFramebuffer::Publish(const Display& display, const SharedFrameState& state)
+	{
+		if (!Layout || !Owner)
+			return;
+
+		uint32_t sequence = Layout->Sequence.load(std::memory_order_relaxed);
+		Layout->Sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		Layout->State = state;
+		Layout->Width = display.GetWidth();
+		Layout->Height = display.GetHeight();
+		Layout->Rows = display.GetFrame();
+
+		Layout->Sequence.store(sequence + 2, std::memory_order_release);
+	}
+
+	bool SharedFramebuffer::TryRead(SharedFrameSnapshot& snapshot, int max_attempts) const
+	{
+		if (!Layout)
+			return false;
+
+		for (int attempt = 0; attempt < max_attempts; ++attempt)
+		{
+			uint32_t before = Layout->Sequence.load(std::memory_order_acquire);
+			if (before & 0x1)
+				continue;
+
+			// The copy may race with the writer; a changed sequence discards it
+			memcpy(&snapshot.State, &Layout->State, sizeof(snapshot.State));
+			memcpy(snapshot.Rows.data(), Layout->Rows.data(), sizeof(snapshot.Rows));
+			snapshot.Width = Layout->Width;
+			snapshot.Height = Layout->Height;
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (Layout->Sequence.load(std::memory_order_relaxed) == before)
+				return true;
+		}
+		return false;
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "display.h"
+
+namespace chipotto
+{
+	struct SharedFrameState
+	{
+		uint64_t FrameNumber = 0;
+		uint16_t PC = 0;
+		uint16_t I = 0;
+		uint8_t SP = 0;
+		uint8_t DelayTimer = 0;
+		uint8_t SoundTimer = 0;
+		std::array<uint8_t, 0x10> Registers = {};
+	};
+
+	struct SharedFrameSnapshot
+	{
+		SharedFrameState State;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		Display::Frame Rows = {};
+	};
+
+	// Layout of the shared segment. Sequence is odd while the writer is updating
+	// the payload; readers copy the payload and retry if the sequence moved.
+	// Width and Height are the current display resolution and change with it;
+	// Rows always has room for the largest one and holds the first XO-CHIP plane.
+	struct SharedFrameLayout
+	{
+		static constexpr uint32_t MagicValue = 0x42463843; // "C8FB"
+		static constexpr uint32_t CurrentVersion = 2;
+
+		uint32_t Magic;
+		uint32_t Version;
+		std::atomic<uint32_t> Sequence;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t WordsPerRow;
+		SharedFrameState State;
+		Display::Frame Rows;
+	};
+
+	// Maps a named shared-memory segment (POSIX shm_open, or a named file mapping
+	// on Windows). The emulator publishes into it once per frame; external
+	// processes open it read-only and never block the emulation thread.
+	class SharedFramebuffer
+	{
+	public:
+		SharedFramebuffer() = default;
+		~SharedFramebuffer();
+
+		SharedFramebuffer(const SharedFramebuffer& other) = delete;
+		SharedFramebuffer& operator=(const SharedFramebuffer& other) = delete;
+
+		bool Create(const std::string& name);
+		bool Open(const std::string& name);
+		void Close();
+		bool IsOpen() const { return Layout != nullptr; }
+
+		void Publish(const Display& display, const SharedFrameState& state);
+		bool TryRead(SharedFrameSnapshot& snapshot, int max_attempts = 64) const;
+
+	private:
+		bool Map(const std::string& name, bool create);
+
+		SharedFrameLayout* Layout = nullptr;
+		std::string Name;
+		bool Owner = false;
+#ifdef _WIN32
+		void* MappingHandle = nullptr;
+#endif
+	};
+}
@@ -0,0 +1,198 @@
+#include "snapshot_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <tuple>
+#include <vector>
+
+namespace chipotto
+{
+	static auto SortKey(const SnapshotCacheEntry& entry)
+	{
+		return std::make_tuple(entry.RomHash, entry.Quirks, entry.InstructionsPerFrame, entry.FrameLimit);
+	}
+
+	static auto SortKey(const SnapshotKey& key)
+	{
+		return std::make_tuple(key.RomHash, key.Quirks, key.InstructionsPerFrame, key.FrameLimit);
+	}
+
+	bool RunBoot(Machine& machine, int instructions_per_frame, int frame_limit)
+	{
+		machine.SetKeys(0);
+		for (int frame = 0; frame < frame_limit && !machine.IsWaitingForKey(); ++frame)
+		{
+			if (!machine.RunFrame(instructions_per_frame))
+				return false;
+		}
+		return true;
+	}
+
+	bool SnapshotCache::Open(const std::filesystem::path& path)
+	{
+		Close();
+		Path = path;
+		if (!File.Open(path) || File.GetSize() < HeaderSize)
+		{
+			File.Close();
+			return false;
+		}
+
+		const uint8_t* header = File.GetData();
+		uint32_t magic;
+		uint16_t version;
+		uint16_t entry_size;
+		uint64_t count;
+		uint64_t layout;
+		memcpy(&magic, header, sizeof(magic));
+		memcpy(&version, header + 4, sizeof(version));
+		memcpy(&entry_size, header + 6, sizeof(entry_size));
+		memcpy(&count, header + 8, sizeof(count));
+		memcpy(&layout, header + 16, sizeof(layout));
+		if (magic != Magic || version != Version || entry_size != sizeof(SnapshotCacheEntry) || layout != Machine::GetStateLayout() ||
+			count > (File.GetSize() - HeaderSize) / sizeof(SnapshotCacheEntry))
+		{
+			File.Close();
+			return false;
+		}
+
+		Entries = reinterpret_cast<const SnapshotCacheEntry*>(header + HeaderSize);
+		Count = static_cast<size_t>(count);
+		for (size_t index = 0; index < Count; ++index)
+		{
+			if (Entries[index].Offset > File.GetSize() || Entries[index].Size > File.GetSize() - Entries[index].Offset)
+			{
+				Close();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void SnapshotCache::Close()
+	{
+		File.Close();
+		Entries = nullptr;
+		Count = 0;
+	}
+
+	const SnapshotCacheEntry* SnapshotCache::Find(const SnapshotKey& key) const
+	{
+		if (!Entries)
+			return nullptr;
+
+		const SnapshotCacheEntry* end = Entries + Count;
+		const SnapshotCacheEntry* entry = std::lower_bound(Entries, end, key,
+			[](const SnapshotCacheEntry& candidate, const SnapshotKey& value) { return SortKey(candidate) < SortKey(value); });
+		return entry != end && SortKey(*entry) == SortKey(key) ? entry : nullptr;
+	}
+
+	bool SnapshotCache::Restore(const SnapshotKey& key, Machine& machine) const
+	{
+		const SnapshotCacheEntry* entry = Find(key);
+		if (!entry)
+			return false;
+		return machine.LoadState({ File.GetData() + entry->Offset, entry->Size });
+	}
+
+	bool SnapshotCache::Store(const SnapshotKey& key, const Machine& machine)
+	{
+		if (Path.empty())
+			return false;
+
+		// Everything is read out of the mapping before the file is replaced
+		std::vector<SnapshotCacheEntry> entries;
+		std::vector<std::vector<uint8_t>> states;
+		for (size_t index = 0; index < Count; ++index)
+		{
+			if (SortKey(Entries[index]) == SortKey(key))
+				continue;
+			entries.push_back(Entries[index]);
+			const uint8_t* state = File.GetData() + Entries[index].Offset;
+			states.emplace_back(state, state + Entries[index].Size);
+		}
+
+		SnapshotCacheEntry added;
+		added.RomHash = key.RomHash;
+		added.Quirks = key.Quirks;
+		added.InstructionsPerFrame = key.InstructionsPerFrame;
+		added.FrameLimit = key.FrameLimit;
+		entries.push_back(added);
+		states.emplace_back();
+		machine.SaveState(states.back());
+
+		std::vector<size_t> order(entries.size());
+		for (size_t index = 0; index < order.size(); ++index)
+			order[index] = index;
+		std::sort(order.begin(), order.end(), [&entries](size_t a, size_t b) { return SortKey(entries[a]) < SortKey(entries[b]); });
+
+		std::vector<SnapshotCacheEntry> table;
+		uint64_t offset = HeaderSize + entries.size() * sizeof(SnapshotCacheEntry);
+		for (size_t index : order)
+		{
+			SnapshotCacheEntry entry = entries[index];
+			entry.Offset = offset;
+			entry.Size = static_cast<uint32_t>(states[index].size());
+			offset += entry.Size;
+			table.push_back(entry);
+		}
+
+		// Written next to the cache and renamed over it, so a reader never sees
+		// half a file
+		Close();
+		std::filesystem::path temporary = Path;
+		temporary += ".tmp";
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				Open(Path);
+				return false;
+			}
+
+			uint8_t header[HeaderSize] = {};
+			uint16_t entry_size = sizeof(SnapshotCacheEntry);
+			uint64_t count = table.size();
+			uint64_t layout = Machine::GetStateLayout();
+			memcpy(header, &Magic, sizeof(Magic));
+			memcpy(header + 4, &Version, sizeof(Version));
+			memcpy(header + 6, &entry_size, sizeof(entry_size));
+			memcpy(header + 8, &count, sizeof(count));
+			memcpy(header + 16, &layout, sizeof(layout));
+			file.write(reinterpret_cast<const char*>(header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(SnapshotCacheEntry));
+			for (size_t index : order)
+				file.write(reinterpret_cast<const char*>(states[index].data()), states[index].size());
+			if (!file)
+			{
+				file.close();
+				std::error_code error;
+				std::filesystem::remove(temporary, error);
+				Open(Path);
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporary, Path, error);
+		return Open(Path) && !error;
+	}
+
+	bool SnapshotCache::Boot(Machine& machine, int instructions_per_frame, int frame_limit)
+	{
+		SnapshotKey key;
+		key.RomHash = machine.GetRomHash();
+		key.Quirks = machine.GetQuirks();
+		key.InstructionsPerFrame = static_cast<uint16_t>(instructions_per_frame);
+		key.FrameLimit = static_cast<uint32_t>(std::max(0, frame_limit));
+		if (Restore(key, machine))
+			return true;
+
+		if (!RunBoot(machine, instructions_per_frame, frame_limit))
+			return false;
+		// A cache that cannot be written only costs the next launch its boot
+		Store(key, machine);
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <type_traits>
+
+#include "machine.h"
+#include "mapped_file.h"
+#include "quirks.h"
+
+namespace chipotto
+{
+	// What a post-boot state depends on besides the ROM itself
+	struct SnapshotKey
+	{
+		uint64_t RomHash = 0;
+		QuirkProfile Quirks = QuirkProfile::Modern;
+		uint16_t InstructionsPerFrame = 0;
+		uint32_t FrameLimit = 0;
+	};
+
+	struct SnapshotCacheEntry
+	{
+		uint64_t RomHash = 0;
+		// Of the saved state, from the start of the file
+		uint64_t Offset = 0;
+		uint32_t Size = 0;
+		uint32_t FrameLimit = 0;
+		uint16_t InstructionsPerFrame = 0;
+		QuirkProfile Quirks = QuirkProfile::Modern;
+		uint8_t Reserved[5] = {};
+	};
+
+	static_assert(sizeof(SnapshotCacheEntry) == 32 && std::is_trivially_copyable_v<SnapshotCacheEntry>, "cache entries are stored as is");
+
+	// Runs a freshly loaded machine with no keys held until it first waits on
+	// LD Vx, K, or for frame_limit frames if it never does. Returns false if it
+	// hits an unrecoverable opcode on the way.
+	bool RunBoot(Machine& machine, int instructions_per_frame, int frame_limit);
+
+	// Machine states taken at the end of RunBoot, so that a ROM that spends its
+	// first seconds on a title screen or clearing memory only does so once. The
+	// file has a 24-byte header, a table of fixed-size entries sorted by key, and
+	// the states after it. It is mapped and searched in place like the ROM
+	// database, and written again as a whole when a state is added. The states
+	// are raw images of the machine, so the header records
+	// Machine::GetStateLayout and a file from a build that lays it out
+	// differently is not opened.
+	class SnapshotCache
+	{
+	public:
+		static constexpr uint32_t Magic = 0x53533843; // "C8SS"
+		static constexpr uint16_t Version = 2;
+		static constexpr size_t HeaderSize = 24;
+
+		// A missing, unreadable or mismatched file leaves the cache empty and
+		// returns false; Store creates it either way
+		bool Open(const std::filesystem::path& path);
+		void Close();
+		bool IsOpen() const { return Entries != nullptr; }
+		size_t GetCount() const { return Count; }
+
+		const SnapshotCacheEntry* Find(const SnapshotKey& key) const;
+		bool Restore(const SnapshotKey& key, Machine& machine) const;
+		// Adds or replaces the state for key and rewrites the file
+		bool Store(const SnapshotKey& key, const Machine& machine);
+
+		// Restores the machine's post-boot state if the cache has it, otherwise
+		// runs RunBoot and stores the result. The machine must have just been
+		// loaded with its ROM and quirk profile.
+		bool Boot(Machine& machine, int instructions_per_frame, int frame_limit);
+
+	private:
+		std::filesystem::path Path;
+		MappedFile File;
+		const SnapshotCacheEntry* Entries = nullptr;
+		size_t Count = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "terminal_renderer.h"
+
+namespace chipotto
+{
+	// Writing a couple of unchanged cells is cheaper than a cursor move sequence
+	static constexpr int MaxBridgedCells = 2;
+
+	TerminalRenderer::TerminalRenderer(TerminalGlyphs glyphs) : Glyphs(glyphs)
+	{
+		CellWidth = Glyphs == TerminalGlyphs::Braille ? 2 : 1;
+		CellHeight = Glyphs == TerminalGlyphs::Braille ? 4 : 2;
+		SetResolution(false);
+	}
+
+	void TerminalRenderer::SetResolution(bool high_resolution)
+	{
+		HighResolution = high_resolution;
+		Columns = (HighResolution ? Display::MaxWidth : Display::LowResWidth) / CellWidth;
+		Rows = (HighResolution ? Display::MaxHeight : Display::LowResHeight) / CellHeight;
+		FullRedraw = true;
+	}
+
+	uint8_t TerminalRenderer::GetCellValue(const Display& display, int column, int row) const
+	{
+		int x = column * CellWidth;
+		int y = row * CellHeight;
+		if (Glyphs == TerminalGlyphs::HalfBlock)
+		{
+			return (display.IsLit(x, y) ? 0x1 : 0x0) | (display.IsLit(x, y + 1) ? 0x2 : 0x0);
+		}
+
+		// Braille dot numbering: dots 1-3 and 4-6 run down the left and right
+		// columns of the first three rows, dots 7 and 8 are the fourth row.
+		static constexpr uint8_t DotBits[4][2] = { { 0x01, 0x08 }, { 0x02, 0x10 }, { 0x04, 0x20 }, { 0x40, 0x80 } };
+		uint8_t value = 0;
+		for (int dy = 0; dy < 4; ++dy)
+		{
+			for (int dx = 0; dx < 2; ++dx)
+			{
+				if (display.IsLit(x + dx, y + dy))
+					value |= DotBits[dy][dx];
+			}
+		}
+		return value;
+	}
+
+	void TerminalRenderer::AppendGlyph(uint8_t value, std::string& output) const
+	{
+		if (Glyphs == TerminalGlyphs::HalfBlock)
+		{
+			// ' ', U+2580 upper half, U+2584 lower half, U+2588 full block
+			static constexpr const char* Blocks[4] = { " ", "\xE2\x96\x80", "\xE2\x96\x84", "\xE2\x96\x88" };
+			output += Blocks[value];
+			return;
+		}
+
+		// U+2800 + dot pattern, always three bytes in UTF-8
+		uint32_t codepoint = 0x2800 + value;
+		output += static_cast<char>(0xE0 | (codepoint >> 12));
+		output += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+		output += static_cast<char>(0x80 | (codepoint & 0x3F));
+	}
+
+	void TerminalRenderer::AppendMoveTo(int column, int row, std::string& output) const
+	{
+		output += "\x1b[";
+		output += std::to_string(row + 1);
+		output += ';';
+		output += std::to_string(column + 1);
+		output += 'H';
+	}
+
+	void TerminalRenderer::Render(const Display& display, std::string& output)
+	{
+		if (display.IsHighResolution() != HighResolution)
+			SetResolution(display.IsHighResolution());
+
+		bool full_redraw = FullRedraw;
+		if (full_redraw)
+		{
+			// Clear the screen and hide the cursor
+			output += "\x1b[2J\x1b[?25l";
+		}
+
+		for (int row = 0; row < Rows; ++row)
+		{
+			bool row_changed = full_redraw;
+			for (int y = row * CellHeight; y < (row + 1) * CellHeight && !row_changed; ++y)
+			{
+				row_changed = display.GetLitRow(y) != RenderedRows[y];
+			}
+			if (!row_changed)
+				continue;
+
+			int cursor_column = -1;
+			for (int column = 0; column < Columns; ++column)
+			{
+				uint8_t value = GetCellValue(display, column, row);
+				uint8_t& cell = Cells[row * Columns + column];
+				if (!full_redraw && value == cell)
+					continue;
+
+				if (cursor_column >= 0 && column > cursor_column && column - cursor_column <= MaxBridgedCells)
+				{
+					for (int bridged = cursor_column; bridged < column; ++bridged)
+					{
+						AppendGlyph(Cells[row * Columns + bridged], output);
+					}
+				}
+				else if (cursor_column != column)
+				{
+					AppendMoveTo(column, row, output);
+				}
+
+				AppendGlyph(value, output);
+				cell = value;
+				cursor_column = column + 1;
+				CellsWritten++;
+			}
+
+			for (int y = row * CellHeight; y < (row + 1) * CellHeight; ++y)
+			{
+				RenderedRows[y] = display.GetLitRow(y);
+			}
+		}
+
+		FullRedraw = false;
+	}
+
+	void TerminalRenderer::Finish(std::string& output) const
+	{
+		AppendMoveTo(0, Rows, output);
+		output += "\x1b[?25h";
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "display.h"
+
+namespace chipotto
+{
+	enum class TerminalGlyphs
+	{
+		HalfBlock,
+		Braille
+	};
+
+	// Draws the display on a VT100-compatible terminal. Half blocks map 1x2
+	// pixels to a cell, Braille maps 2x4. Only cells that changed since the last
+	// call are written, so a mostly static screen costs a few bytes per frame.
+	// A resolution switch changes the cell grid and redraws the whole screen.
+	class TerminalRenderer
+	{
+	public:
+		explicit TerminalRenderer(TerminalGlyphs glyphs = TerminalGlyphs::HalfBlock);
+
+		void Invalidate() { FullRedraw = true; }
+
+		// Appends the escape sequences that bring the terminal up to date
+		void Render(const Display& display, std::string& output);
+		// Appends the sequences that restore the cursor below the picture
+		void Finish(std::string& output) const;
+
+		int GetColumns() const { return Columns; }
+		int GetRows() const { return Rows; }
+		uint64_t GetCellsWritten() const { return CellsWritten; }
+
+	private:
+		static constexpr int MaxCells = Display::MaxWidth * Display::MaxHeight / 2;
+
+		void SetResolution(bool high_resolution);
+		uint8_t GetCellValue(const Display& display, int column, int row) const;
+		void AppendGlyph(uint8_t value, std::string& output) const;
+		void AppendMoveTo(int column, int row, std::string& output) const;
+
+		TerminalGlyphs Glyphs;
+		int CellWidth;
+		int CellHeight;
+		int Columns;
+		int Rows;
+
+		std::array<uint8_t, MaxCells> Cells = {};
+		Display::Frame RenderedRows = {};
+		bool HighResolution = false;
+		bool FullRedraw = true;
+		uint64_t CellsWritten = 0;
+	};
+}
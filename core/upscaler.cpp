@@ -0,0 +1,211 @@
+#include "upscaler.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CHIPOTTO_UPSCALER_SSE2
+#endif
+
+namespace chipotto
+{
+	static void FillPixels(uint32_t* pixels, uint32_t color, int count)
+	{
+		int i = 0;
+#ifdef CHIPOTTO_UPSCALER_SSE2
+		__m128i value = _mm_set1_epi32(static_cast<int>(color));
+		for (; i + 8 <= count; i += 8)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), value);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i + 4), value);
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			pixels[i] = color;
+		}
+	}
+
+	// Moves bit k of a 32-bit value to bit 2k of the result
+	static uint64_t SpreadBits(uint32_t value)
+	{
+		uint64_t x = value;
+		x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+		x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+		x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+		x = (x | (x << 2)) & 0x3333333333333333ull;
+		x = (x | (x << 1)) & 0x5555555555555555ull;
+		return x;
+	}
+
+	// Neighbour masks with edge pixels replicated. Pixels are stored MSB first, so
+	// the left neighbour of every pixel is the row shifted right by one bit.
+	static void LeftNeighbours(const uint64_t* row, int words, uint64_t* out)
+	{
+		for (int w = 0; w < words; ++w)
+		{
+			uint64_t carry = w > 0 ? row[w - 1] << 63 : row[0] & 0x8000000000000000ull;
+			out[w] = (row[w] >> 1) | carry;
+		}
+	}
+
+	static void RightNeighbours(const uint64_t* row, int words, uint64_t* out)
+	{
+		for (int w = 0; w < words; ++w)
+		{
+			uint64_t carry = w + 1 < words ? row[w + 1] >> 63 : row[w] & 0x1;
+			out[w] = (row[w] << 1) | carry;
+		}
+	}
+
+	void Upscaler::Scale2xRows(const uint64_t* source, int words_per_row, int height, uint64_t* destination)
+	{
+		constexpr int MaxWords = 16;
+		uint64_t d[MaxWords];
+		uint64_t f[MaxWords];
+		int out_words = words_per_row * 2;
+
+		for (int y = 0; y < height; ++y)
+		{
+			const uint64_t* e = source + y * words_per_row;
+			const uint64_t* b = y > 0 ? e - words_per_row : e;
+			const uint64_t* h = y + 1 < height ? e + words_per_row : e;
+			LeftNeighbours(e, words_per_row, d);
+			RightNeighbours(e, words_per_row, f);
+
+			uint64_t* top = destination + (2 * y) * out_words;
+			uint64_t* bottom = top + out_words;
+			for (int w = 0; w < words_per_row; ++w)
+			{
+				uint64_t db = ~(d[w] ^ b[w]);
+				uint64_t bf = ~(b[w] ^ f[w]);
+				uint64_t dh = ~(d[w] ^ h[w]);
+				uint64_t hf = ~(h[w] ^ f[w]);
+
+				uint64_t c0 = db & ~bf & ~dh;
+				uint64_t c1 = bf & ~db & ~hf;
+				uint64_t c2 = dh & ~db & ~hf;
+				uint64_t c3 = hf & ~dh & ~bf;
+
+				uint64_t e0 = (c0 & d[w]) | (~c0 & e[w]);
+				uint64_t e1 = (c1 & f[w]) | (~c1 & e[w]);
+				uint64_t e2 = (c2 & d[w]) | (~c2 & e[w]);
+				uint64_t e3 = (c3 & f[w]) | (~c3 & e[w]);
+
+				// Interleave left/right sub-pixels: the upper 32 source pixels fill the
+				// first output word, the lower 32 the second.
+				top[2 * w] = (SpreadBits(static_cast<uint32_t>(e0 >> 32)) << 1) | SpreadBits(static_cast<uint32_t>(e1 >> 32));
+				top[2 * w + 1] = (SpreadBits(static_cast<uint32_t>(e0)) << 1) | SpreadBits(static_cast<uint32_t>(e1));
+				bottom[2 * w] = (SpreadBits(static_cast<uint32_t>(e2 >> 32)) << 1) | SpreadBits(static_cast<uint32_t>(e3 >> 32));
+				bottom[2 * w + 1] = (SpreadBits(static_cast<uint32_t>(e2)) << 1) | SpreadBits(static_cast<uint32_t>(e3));
+			}
+		}
+	}
+
+	void Upscaler::Configure(int scale, UpscaleFilter filter, WorkerPool* pool)
+	{
+		LowResScale = scale < 1 ? 1 : scale;
+		RequestedFilter = filter;
+		Pool = pool;
+		SetResolution(HighResolution);
+	}
+
+	void Upscaler::SetResolution(bool high_resolution)
+	{
+		HighResolution = high_resolution;
+		Scale = HighResolution ? std::max(1, LowResScale / 2) : LowResScale;
+		Words = HighResolution ? Display::WordsPerRow : 1;
+		Height = HighResolution ? Display::MaxHeight : Display::LowResHeight;
+
+		// Fall back to a smaller smoothing factor when it does not divide the scale
+		Filter = RequestedFilter;
+		if (Filter == UpscaleFilter::Scale4x && Scale % 4 != 0)
+			Filter = UpscaleFilter::Scale2x;
+		if (Filter == UpscaleFilter::Scale2x && Scale % 2 != 0)
+			Filter = UpscaleFilter::Nearest;
+
+		SmoothFactor = Filter == UpscaleFilter::Scale4x ? 4 : Filter == UpscaleFilter::Scale2x ? 2 : 1;
+		PixelFactor = Scale / SmoothFactor;
+
+		size_t source_words = static_cast<size_t>(Words) * Height;
+		SourceRows.assign(source_words, 0);
+		SmoothedRows.assign(source_words * SmoothFactor * SmoothFactor, 0);
+		ScratchRows.assign(Filter == UpscaleFilter::Scale4x ? source_words * 4 : 0, 0);
+	}
+
+	void Upscaler::Smooth(const Display& display)
+	{
+		// Gather the active words of each row so smoothing sees a dense image
+		for (int y = 0; y < Height; ++y)
+		{
+			memcpy(SourceRows.data() + y * Words, display.GetRow(y).data(), Words * sizeof(uint64_t));
+		}
+
+		if (Filter == UpscaleFilter::Nearest)
+		{
+			memcpy(SmoothedRows.data(), SourceRows.data(), SmoothedRows.size() * sizeof(uint64_t));
+		}
+		else if (Filter == UpscaleFilter::Scale2x)
+		{
+			Scale2xRows(SourceRows.data(), Words, Height, SmoothedRows.data());
+		}
+		else
+		{
+			Scale2xRows(SourceRows.data(), Words, Height, ScratchRows.data());
+			Scale2xRows(ScratchRows.data(), Words * 2, Height * 2, SmoothedRows.data());
+		}
+	}
+
+	void Upscaler::ExpandLine(const uint64_t* row, uint32_t* line) const
+	{
+		int words = Words * SmoothFactor;
+		for (int w = 0; w < words; ++w)
+		{
+			uint64_t word = row[w];
+			int bit = 0;
+			while (bit < 64)
+			{
+				// Length of the run of pixels equal to the current one
+				uint64_t value = (word >> 63) & 0x1;
+				uint64_t normalized = value ? ~word : word;
+				int run = normalized == 0 ? 64 - bit : std::min(std::countl_zero(normalized), 64 - bit);
+
+				FillPixels(line, Colors[value], run * PixelFactor);
+				line += run * PixelFactor;
+				bit += run;
+				word = run < 64 ? word << run : 0;
+			}
+		}
+	}
+
+	void Upscaler::Render(const Display& display, int first_row, int last_row, uint8_t* pixels, int pitch)
+	{
+		if (display.IsHighResolution() != HighResolution)
+			SetResolution(display.IsHighResolution());
+		Smooth(display);
+
+		int words = Words * SmoothFactor;
+		int first_line = first_row * SmoothFactor;
+		int line_count = (last_row - first_row) * SmoothFactor;
+		auto render_band = [&](int begin, int end)
+		{
+			for (int line = begin; line < end; ++line)
+			{
+				const uint64_t* row = SmoothedRows.data() + (first_line + line) * words;
+				uint8_t* target = pixels + static_cast<size_t>(line) * PixelFactor * pitch;
+				ExpandLine(row, reinterpret_cast<uint32_t*>(target));
+				for (int copy = 1; copy < PixelFactor; ++copy)
+				{
+					memcpy(target + copy * pitch, target, GetOutputWidth() * sizeof(uint32_t));
+				}
+			}
+		};
+
+		if (Pool)
+			Pool->ParallelFor(line_count, render_band);
+		else
+			render_band(0, line_count);
+	}
+}
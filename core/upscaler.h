@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "display.h"
+#include "worker_pool.h"
+
+namespace chipotto
+{
+	enum class UpscaleFilter
+	{
+		Nearest,
+		Scale2x,
+		Scale4x
+	};
+
+	// CPU upscaler for renderers without a GPU. Edge smoothing (Scale2x, applied
+	// twice for Scale4x) runs on the bit-packed rows 64 pixels per operation; the
+	// remaining integer factor is applied while expanding to RGBA32, filling runs
+	// of equal pixels at once. Output rows are split across the worker pool.
+	//
+	// The output size is fixed by the low resolution scale; in the SUPER-CHIP
+	// high resolution mode every pixel is half that size.
+	class Upscaler
+	{
+	public:
+		void Configure(int scale, UpscaleFilter filter, WorkerPool* pool);
+		void SetResolution(bool high_resolution);
+		void SetColors(uint32_t off, uint32_t on) { Colors = { off, on }; }
+
+		// Output pixels per display pixel at the current resolution
+		int GetScale() const { return Scale; }
+		UpscaleFilter GetFilter() const { return Filter; }
+		bool IsHighResolution() const { return HighResolution; }
+		int GetOutputWidth() const { return Display::LowResWidth * LowResScale; }
+		int GetOutputHeight() const { return Display::LowResHeight * LowResScale; }
+
+		// Renders display rows [first_row, last_row) into pixels, which points at
+		// the first output line of first_row in a texture of GetOutputWidth().
+		void Render(const Display& display, int first_row, int last_row, uint8_t* pixels, int pitch);
+
+		static void Scale2xRows(const uint64_t* source, int words_per_row, int height, uint64_t* destination);
+
+	private:
+		void Smooth(const Display& display);
+		void ExpandLine(const uint64_t* row, uint32_t* line) const;
+
+		int LowResScale = 1;
+		int Scale = 1;
+		UpscaleFilter RequestedFilter = UpscaleFilter::Nearest;
+		UpscaleFilter Filter = UpscaleFilter::Nearest;
+		bool HighResolution = false;
+		WorkerPool* Pool = nullptr;
+
+		int Words = 1;
+		int Height = Display::LowResHeight;
+		int SmoothFactor = 1;
+		int PixelFactor = 1;
+		std::array<uint32_t, 2> Colors = { 0x00000000, 0xFFFFFFFF };
+
+		std::vector<uint64_t> SourceRows;
+		std::vector<uint64_t> SmoothedRows;
+		std::vector<uint64_t> ScratchRows;
+	};
+}
@@ -0,0 +1,197 @@
+#include "vector_env.h"
+
+#include <algorithm>
+
+namespace chipotto
+{
+	// Ors each pair of neighbouring bits into one, halving a 64-bit row to 32
+	static uint64_t SquashPairs(uint64_t bits)
+	{
+		bits = (bits | (bits >> 1)) & 0x5555555555555555ull;
+		bits = (bits | (bits >> 1)) & 0x3333333333333333ull;
+		bits = (bits | (bits >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+		bits = (bits | (bits >> 4)) & 0x00FF00FF00FF00FFull;
+		bits = (bits | (bits >> 8)) & 0x0000FFFF0000FFFFull;
+		bits = (bits | (bits >> 16)) & 0x00000000FFFFFFFFull;
+		return bits;
+	}
+
+	VectorEnv::VectorEnv(size_t count, const VectorEnvConfig& config, WorkerPool* workers)
+		: Config(config), Count(count), Workers(workers), Machines(count, workers)
+	{
+		Config.FrameSkip = std::max(1, Config.FrameSkip);
+		for (size_t index = 0; index < Count; ++index)
+			Machines.Acquire();
+
+		Observations.assign(Count * ObservationSize, 0);
+		Rewards.assign(Count, 0.0f);
+		Dones.assign(Count, 0);
+		RewardValues.assign(Count * Config.Rewards.size(), 0);
+		EpisodeSteps.assign(Count, 0);
+		Episodes.assign(Count, 0);
+		Snapshot.SetQuirks(Config.Quirks);
+	}
+
+	bool VectorEnv::Load(std::shared_ptr<const RomImage> image)
+	{
+		Snapshot = Machine();
+		Snapshot.SetQuirks(Config.Quirks);
+		if (!Snapshot.LoadFromImage(std::move(image)))
+			return false;
+		return Boot();
+	}
+
+	bool VectorEnv::Load(std::span<const std::byte> rom)
+	{
+		Snapshot = Machine();
+		Snapshot.SetQuirks(Config.Quirks);
+		if (!Snapshot.LoadFromSpan(rom))
+			return false;
+		return Boot();
+	}
+
+	bool VectorEnv::Boot()
+	{
+		bool booted = Cache ? Cache->Boot(Snapshot, Config.InstructionsPerFrame, Config.BootFrames)
+			: RunBoot(Snapshot, Config.InstructionsPerFrame, Config.BootFrames);
+		if (!booted)
+			return false;
+		Reset();
+		return true;
+	}
+
+	void VectorEnv::Reset()
+	{
+		auto reset_range = [this](size_t begin, size_t end)
+		{
+			for (size_t index = begin; index < end; ++index)
+			{
+				ResetInstance(index);
+				Rewards[index] = 0.0f;
+				Dones[index] = 0;
+			}
+		};
+		if (Workers)
+			Workers->ParallelFor(static_cast<int>(Count), reset_range);
+		else
+			reset_range(0, Count);
+	}
+
+	bool VectorEnv::Step(std::span<const uint16_t> keys)
+	{
+		if (keys.size() != Count)
+			return false;
+
+		if (Workers)
+		{
+			Workers->ParallelFor(static_cast<int>(Count), [this, &keys](int begin, int end)
+			{
+				StepRange(keys.data(), begin, end);
+			});
+		}
+		else
+		{
+			StepRange(keys.data(), 0, Count);
+		}
+		return true;
+	}
+
+	void VectorEnv::ResetInstance(size_t index)
+	{
+		Machine& machine = Machines[static_cast<uint32_t>(index)];
+		// Shares every page with the snapshot, so resets copy no guest memory
+		machine = Snapshot;
+		machine.SetRandomSeed(Config.Seed ^ static_cast<uint32_t>(index * 0x9E3779B9u) ^ (Episodes[index] * 0x85EBCA6Bu));
+		Episodes[index]++;
+		EpisodeSteps[index] = 0;
+
+		int* values = RewardValues.data() + index * Config.Rewards.size();
+		for (size_t term = 0; term < Config.Rewards.size(); ++term)
+			values[term] = ReadRewardTerm(machine, Config.Rewards[term]);
+		PackObservation(machine.GetDisplay(), Observations.data() + index * ObservationSize, false);
+	}
+
+	void VectorEnv::StepRange(const uint16_t* keys, size_t begin, size_t end)
+	{
+		for (size_t index = begin; index < end; ++index)
+		{
+			Machine& machine = Machines[static_cast<uint32_t>(index)];
+			uint8_t* observation = Observations.data() + index * ObservationSize;
+			machine.SetKeys(keys[index]);
+
+			bool running = true;
+			bool pooled = false;
+			for (int frame = 0; frame < Config.FrameSkip && running; ++frame)
+			{
+				running = machine.RunFrame(Config.InstructionsPerFrame);
+				// Sprites that flicker between frames still show up
+				if (running && frame == Config.FrameSkip - 2)
+				{
+					PackObservation(machine.GetDisplay(), observation, false);
+					pooled = true;
+				}
+			}
+			PackObservation(machine.GetDisplay(), observation, pooled);
+
+			float reward = 0.0f;
+			int* values = RewardValues.data() + index * Config.Rewards.size();
+			for (size_t term = 0; term < Config.Rewards.size(); ++term)
+			{
+				int value = ReadRewardTerm(machine, Config.Rewards[term]);
+				reward += Config.Rewards[term].Scale * static_cast<float>(value - values[term]);
+				values[term] = value;
+			}
+			Rewards[index] = reward;
+
+			EpisodeSteps[index]++;
+			bool truncated = Config.MaxEpisodeSteps > 0 && EpisodeSteps[index] >= static_cast<uint32_t>(Config.MaxEpisodeSteps);
+			bool done = !running || truncated || IsDone(machine);
+			Dones[index] = done ? 1 : 0;
+			if (done)
+				ResetInstance(index);
+		}
+	}
+
+	int VectorEnv::ReadRewardTerm(const Machine& machine, const RewardTerm& term) const
+	{
+		int value = machine.GetMemoryLocValue(term.Address);
+		if (term.Size > 1)
+			value = (value << 8) | machine.GetMemoryLocValue(static_cast<uint16_t>(term.Address + 1));
+		return value;
+	}
+
+	bool VectorEnv::IsDone(const Machine& machine) const
+	{
+		for (const DoneTerm& term : Config.DoneWhen)
+		{
+			if (machine.GetMemoryLocValue(term.Address) == term.Value)
+				return true;
+		}
+		return false;
+	}
+
+	void VectorEnv::PackObservation(const Display& display, uint8_t* observation, bool accumulate)
+	{
+		for (int y = 0; y < ObservationHeight; ++y)
+		{
+			uint64_t bits;
+			if (display.IsHighResolution())
+			{
+				Display::Row top = display.GetLitRow(y * 2);
+				Display::Row bottom = display.GetLitRow(y * 2 + 1);
+				bits = (SquashPairs(top[0] | bottom[0]) << 32) | SquashPairs(top[1] | bottom[1]);
+			}
+			else
+			{
+				bits = display.GetLitRow(y)[0];
+			}
+
+			uint8_t* row = observation + y * (ObservationWidth / 8);
+			for (int byte = 0; byte < ObservationWidth / 8; ++byte)
+			{
+				uint8_t value = static_cast<uint8_t>(bits >> (56 - byte * 8));
+				row[byte] = accumulate ? static_cast<uint8_t>(row[byte] | value) : value;
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "machine.h"
+#include "machine_pool.h"
+#include "snapshot_cache.h"
+#include "worker_pool.h"
+
+namespace chipotto
+{
+	// Guest memory value the reward follows: Size bytes (1 or 2, big-endian) at
+	// Address. Each step adds Scale times its change to the reward.
+	struct RewardTerm
+	{
+		uint16_t Address = 0;
+		uint8_t Size = 1;
+		float Scale = 1.0f;
+	};
+
+	// An episode ends when the byte at Address holds Value
+	struct DoneTerm
+	{
+		uint16_t Address = 0;
+		uint8_t Value = 0;
+	};
+
+	struct VectorEnvConfig
+	{
+		int InstructionsPerFrame = 11;
+		// Emulated frames per Step with the same keys held; the observation is the
+		// pixel-wise max of the last two
+		int FrameSkip = 4;
+		QuirkProfile Quirks = QuirkProfile::Modern;
+		// Frames run with no keys held after loading, stopping early at the first
+		// LD Vx, K, before the snapshot every reset starts from
+		int BootFrames = 0;
+		// Steps before an episode is cut short, 0 for no limit
+		int MaxEpisodeSteps = 0;
+		// Mixed with the instance and episode numbers to seed RND on every reset
+		uint32_t Seed = 1;
+		std::vector<RewardTerm> Rewards;
+		std::vector<DoneTerm> DoneWhen;
+	};
+
+	// Steps N headless instances of one ROM in lockstep for agents to train on.
+	// Inputs and outputs are flat arrays indexed by instance: one 16-bit keypad
+	// mask in, and out a bit-packed 64x32 observation (row-major, most
+	// significant bit first, SUPER-CHIP screens downscaled by OR-ing 2x2 blocks),
+	// a reward and a done flag. An instance whose episode ends is reset from the
+	// post-boot snapshot in the same step, so its observation is already the
+	// first one of the next episode.
+	class VectorEnv
+	{
+	public:
+		static constexpr int ObservationWidth = Display::LowResWidth;
+		static constexpr int ObservationHeight = Display::LowResHeight;
+		static constexpr size_t ObservationSize = ObservationWidth * ObservationHeight / 8;
+
+		// Instances are stepped in bands over the workers when a pool is given
+		VectorEnv(size_t count, const VectorEnvConfig& config, WorkerPool* workers = nullptr);
+
+		VectorEnv(const VectorEnv& other) = delete;
+		VectorEnv& operator=(const VectorEnv& other) = delete;
+
+		// Boot states are restored from the cache and stored in it when missing;
+		// it must outlive the calls to Load
+		void SetSnapshotCache(SnapshotCache* cache) { Cache = cache; }
+		// Boots the ROM once, then resets every instance from the snapshot
+		bool Load(std::shared_ptr<const RomImage> image);
+		bool Load(std::span<const std::byte> rom);
+		void Reset();
+		// keys holds one mask per instance; returns false if the count is wrong
+		bool Step(std::span<const uint16_t> keys);
+
+		size_t GetCount() const { return Count; }
+		std::span<const uint8_t> GetObservations() const { return Observations; }
+		std::span<const uint8_t> GetObservation(size_t index) const { return { Observations.data() + index * ObservationSize, ObservationSize }; }
+		std::span<const float> GetRewards() const { return Rewards; }
+		std::span<const uint8_t> GetDones() const { return Dones; }
+
+		const Machine& GetMachine(size_t index) const { return Machines[static_cast<uint32_t>(index)]; }
+		const Machine& GetSnapshot() const { return Snapshot; }
+		const VectorEnvConfig& GetConfig() const { return Config; }
+
+		// OR-s the screen into 256 bytes, or overwrites them when accumulate is false
+		static void PackObservation(const Display& display, uint8_t* observation, bool accumulate);
+
+	private:
+		bool Boot();
+		void ResetInstance(size_t index);
+		void StepRange(const uint16_t* keys, size_t begin, size_t end);
+		int ReadRewardTerm(const Machine& machine, const RewardTerm& term) const;
+		bool IsDone(const Machine& machine) const;
+
+		VectorEnvConfig Config;
+		size_t Count;
+		WorkerPool* Workers;
+		SnapshotCache* Cache = nullptr;
+		MachinePool Machines;
+		Machine Snapshot;
+
+		std::vector<uint8_t> Observations;
+		std::vector<float> Rewards;
+		std::vector<uint8_t> Dones;
+		// Last value of every reward term, Rewards.size() per instance
+		std::vector<int> RewardValues;
+		std::vector<uint32_t> EpisodeSteps;
+		std::vector<uint32_t> Episodes;
+	};
+}
\ No newline at end of file
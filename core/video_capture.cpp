@@ -0,0 +1,390 @@
+#include "video_capture.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string>
+
+namespace chipotto
+{
+	VideoCapture::~VideoCapture()
+	{
+		Close();
+	}
+
+	bool VideoCapture::Open(const std::filesystem::path& path, const CaptureOptions& options)
+	{
+		Close();
+
+		Options = options;
+		Options.Scale = std::max(2, (Options.Scale + 1) & ~1);
+		if (path == "-")
+		{
+			File = stdout;
+			OwnsFile = false;
+		}
+		else
+		{
+#ifdef _WIN32
+			File = _wfopen(path.c_str(), L"wb");
+#else
+			File = std::fopen(path.c_str(), "wb");
+#endif
+			OwnsFile = true;
+		}
+		if (!File)
+			return false;
+
+		HasSubmitted = false;
+		PendingRepeats = 0;
+		FramesSubmitted = 0;
+		FramesDeduplicated = 0;
+		FramesDropped = 0;
+		GifFramesWritten = 0;
+		GifCentisecondsWritten = 0;
+
+		if (Options.Format == CaptureFormat::Y4M)
+			WriteY4MHeader();
+		else
+			WriteGifHeader();
+
+		Queue = std::make_unique<BoundedQueue<CaptureItem>>(Options.QueueCapacity);
+		Thread = std::thread(&VideoCapture::EncoderLoop, this);
+		return true;
+	}
+
+	void VideoCapture::Submit(const Display& display)
+	{
+		if (!Queue)
+			return;
+
+		FramesSubmitted++;
+		if (HasSubmitted && display.SameImage(LastSubmitted))
+		{
+			PendingRepeats++;
+			FramesDeduplicated++;
+			return;
+		}
+
+		CaptureItem item;
+		item.Screen = display;
+		item.PreviousRepeats = PendingRepeats;
+		bool queued = Options.Policy == CaptureQueuePolicy::Block ? Queue->Push(item) : Queue->TryPush(item);
+		if (!queued)
+		{
+			// Keep the timeline intact: the last queued frame simply lasts longer
+			PendingRepeats++;
+			FramesDropped++;
+			return;
+		}
+
+		LastSubmitted = item.Screen;
+		HasSubmitted = true;
+		PendingRepeats = 0;
+	}
+
+	void VideoCapture::Close()
+	{
+		if (!Queue)
+			return;
+
+		CaptureItem final_item;
+		final_item.PreviousRepeats = PendingRepeats;
+		final_item.Final = true;
+		Queue->Push(final_item);
+		Queue->Close();
+		Thread.join();
+		Queue.reset();
+
+		if (OwnsFile)
+			std::fclose(File);
+		else
+			std::fflush(File);
+		File = nullptr;
+	}
+
+	void VideoCapture::EncoderLoop()
+	{
+		CaptureItem item;
+		Display previous;
+		Display pending;
+		bool has_pending = false;
+
+		while (Queue->Pop(item))
+		{
+			if (Options.Format == CaptureFormat::Y4M)
+			{
+				// Repeats reuse the frame that is already converted in Buffer
+				for (uint32_t repeat = 0; repeat < item.PreviousRepeats && has_pending; ++repeat)
+				{
+					std::fwrite("FRAME\n", 1, 6, File);
+					std::fwrite(Buffer.data(), 1, Buffer.size(), File);
+				}
+				if (!item.Final)
+				{
+					WriteY4MFrame(item.Screen);
+					has_pending = true;
+				}
+			}
+			else
+			{
+				// A GIF frame carries its own duration, so it is written once the next one arrives
+				if (has_pending)
+				{
+					WriteGifFrame(pending, previous, GifFramesWritten == 0, 1 + item.PreviousRepeats);
+					previous = pending;
+				}
+				pending = item.Screen;
+				has_pending = !item.Final;
+			}
+
+			if (item.Final)
+				break;
+		}
+
+		if (Options.Format == CaptureFormat::Gif)
+			WriteGifTrailer();
+	}
+
+	void VideoCapture::WriteY4MHeader()
+	{
+		std::string header = "YUV4MPEG2 W" + std::to_string(Display::LowResWidth * Options.Scale) +
+			" H" + std::to_string(Display::LowResHeight * Options.Scale) + " F60:1 Ip A1:1 C420jpeg\n";
+		std::fwrite(header.data(), 1, header.size(), File);
+	}
+
+	SDL_Color VideoCapture::PaletteColor(int index) const
+	{
+		if (index == 0)
+			return Options.Off;
+		if (index == 1)
+			return Options.On;
+		const Display::Rgb& rgb = Display::DefaultPalette[index];
+		return { rgb[0], rgb[1], rgb[2], 0xFF };
+	}
+
+	static void ToYCbCr(SDL_Color color, uint8_t& y, uint8_t& cb, uint8_t& cr)
+	{
+		// Full-range BT.601, as implied by C420jpeg
+		double r = color.r;
+		double g = color.g;
+		double b = color.b;
+		y = static_cast<uint8_t>(std::clamp(0.299 * r + 0.587 * g + 0.114 * b + 0.5, 0.0, 255.0));
+		cb = static_cast<uint8_t>(std::clamp(128.0 - 0.168736 * r - 0.331264 * g + 0.5 * b + 0.5, 0.0, 255.0));
+		cr = static_cast<uint8_t>(std::clamp(128.0 + 0.5 * r - 0.418688 * g - 0.081312 * b + 0.5, 0.0, 255.0));
+	}
+
+	void VideoCapture::WriteY4MFrame(const Display& display)
+	{
+		int width = Display::LowResWidth * Options.Scale;
+		int height = Display::LowResHeight * Options.Scale;
+		int chroma_width = (width + 1) / 2;
+		int chroma_height = (height + 1) / 2;
+		Buffer.resize(static_cast<size_t>(width) * height + 2 * static_cast<size_t>(chroma_width) * chroma_height);
+
+		std::array<uint8_t, Display::MaxColors> luma;
+		std::array<uint8_t, Display::MaxColors> blue;
+		std::array<uint8_t, Display::MaxColors> red;
+		for (int index = 0; index < Display::MaxColors; ++index)
+			ToYCbCr(PaletteColor(index), luma[index], blue[index], red[index]);
+
+		Indices.resize(static_cast<size_t>(width) * height);
+		display.Rasterize(Indices.data(), width, Options.Scale);
+
+		uint8_t* y_plane = Buffer.data();
+		for (size_t i = 0; i < Indices.size(); ++i)
+			y_plane[i] = luma[Indices[i]];
+
+		// Chroma is subsampled 2x2; every block lies within a single source pixel
+		// because both scales are even
+		uint8_t* cb_plane = y_plane + static_cast<size_t>(width) * height;
+		uint8_t* cr_plane = cb_plane + static_cast<size_t>(chroma_width) * chroma_height;
+		for (int cy = 0; cy < chroma_height; ++cy)
+		{
+			for (int cx = 0; cx < chroma_width; ++cx)
+			{
+				uint8_t value = Indices[static_cast<size_t>(cy) * 2 * width + cx * 2];
+				cb_plane[cy * chroma_width + cx] = blue[value];
+				cr_plane[cy * chroma_width + cx] = red[value];
+			}
+		}
+
+		std::fwrite("FRAME\n", 1, 6, File);
+		std::fwrite(Buffer.data(), 1, Buffer.size(), File);
+	}
+
+	static void PutU16(std::vector<uint8_t>& out, uint16_t value)
+	{
+		out.push_back(static_cast<uint8_t>(value));
+		out.push_back(static_cast<uint8_t>(value >> 8));
+	}
+
+	void VideoCapture::WriteGifHeader()
+	{
+		std::vector<uint8_t> header = { 'G', 'I', 'F', '8', '9', 'a' };
+		PutU16(header, static_cast<uint16_t>(Display::LowResWidth * Options.Scale));
+		PutU16(header, static_cast<uint16_t>(Display::LowResHeight * Options.Scale));
+		// Global color table present, one entry per XO-CHIP colour
+		header.push_back(0x83);
+		header.push_back(0);
+		header.push_back(0);
+		for (int index = 0; index < Display::MaxColors; ++index)
+		{
+			SDL_Color color = PaletteColor(index);
+			header.insert(header.end(), { color.r, color.g, color.b });
+		}
+		// NETSCAPE2.0 application extension: loop forever
+		header.insert(header.end(), { 0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00 });
+		std::fwrite(header.data(), 1, header.size(), File);
+	}
+
+	void VideoCapture::WriteGifFrame(const Display& display, const Display& previous, bool first, uint32_t duration)
+	{
+		// Only the band of rows that changed is stored; the rest of the canvas is
+		// kept. A resolution switch redraws the whole canvas.
+		const Display::Frame& frame = display.GetFrame();
+		int first_row = 0;
+		int last_row = display.GetHeight();
+		if (!first && display.IsHighResolution() == previous.IsHighResolution())
+		{
+			const Display::Frame& shown = previous.GetFrame();
+			while (first_row < last_row && frame[first_row] == shown[first_row])
+				first_row++;
+			while (last_row > first_row && frame[last_row - 1] == shown[last_row - 1])
+				last_row--;
+			if (first_row == last_row)
+				last_row = first_row + 1;
+		}
+
+		// 60 frames per second in centiseconds, without accumulating rounding drift
+		GifFramesWritten += duration;
+		uint64_t target = (GifFramesWritten * 100 + 30) / 60;
+		uint16_t delay = static_cast<uint16_t>(std::min<uint64_t>(target - GifCentisecondsWritten, 0xFFFF));
+		GifCentisecondsWritten += delay;
+
+		int row_scale = display.IsHighResolution() ? Options.Scale / 2 : Options.Scale;
+		int width = Display::LowResWidth * Options.Scale;
+		int top = first_row * row_scale;
+		int height = (last_row - first_row) * row_scale;
+
+		// Rasterize the whole frame and keep the band
+		Indices.resize(static_cast<size_t>(width) * Display::LowResHeight * Options.Scale);
+		display.Rasterize(Indices.data(), width, Options.Scale);
+		if (top > 0)
+			memmove(Indices.data(), Indices.data() + static_cast<size_t>(top) * width, static_cast<size_t>(height) * width);
+		Indices.resize(static_cast<size_t>(width) * height);
+
+		Buffer.clear();
+		// Graphic control extension: no disposal, delay in centiseconds
+		Buffer.insert(Buffer.end(), { 0x21, 0xF9, 0x04, 0x04 });
+		PutU16(Buffer, delay);
+		Buffer.insert(Buffer.end(), { 0x00, 0x00 });
+		// Image descriptor
+		Buffer.push_back(0x2C);
+		PutU16(Buffer, 0);
+		PutU16(Buffer, static_cast<uint16_t>(top));
+		PutU16(Buffer, static_cast<uint16_t>(width));
+		PutU16(Buffer, static_cast<uint16_t>(height));
+		Buffer.push_back(0x00);
+
+		const int min_code_size = 4;
+		Buffer.push_back(min_code_size);
+		std::vector<uint8_t> compressed;
+		EncodeGifLzw(Indices.data(), Indices.size(), min_code_size, compressed);
+		for (size_t offset = 0; offset < compressed.size(); offset += 255)
+		{
+			size_t block = std::min<size_t>(255, compressed.size() - offset);
+			Buffer.push_back(static_cast<uint8_t>(block));
+			Buffer.insert(Buffer.end(), compressed.begin() + offset, compressed.begin() + offset + block);
+		}
+		Buffer.push_back(0x00);
+
+		std::fwrite(Buffer.data(), 1, Buffer.size(), File);
+	}
+
+	void VideoCapture::WriteGifTrailer()
+	{
+		std::fputc(0x3B, File);
+	}
+
+	void EncodeGifLzw(const uint8_t* indices, size_t count, int min_code_size, std::vector<uint8_t>& output)
+	{
+		const int clear_code = 1 << min_code_size;
+		const int end_code = clear_code + 1;
+		const int max_codes = 4096;
+
+		// Open-addressing table from (prefix code, next index) to code
+		const size_t table_size = 8192;
+		std::vector<int32_t> keys(table_size, -1);
+		std::vector<int16_t> values(table_size, 0);
+
+		uint32_t bit_buffer = 0;
+		int bit_count = 0;
+		int code_size = min_code_size + 1;
+		int next_code = end_code + 1;
+
+		auto emit = [&](int code)
+		{
+			bit_buffer |= static_cast<uint32_t>(code) << bit_count;
+			bit_count += code_size;
+			while (bit_count >= 8)
+			{
+				output.push_back(static_cast<uint8_t>(bit_buffer));
+				bit_buffer >>= 8;
+				bit_count -= 8;
+			}
+		};
+		auto reset = [&]()
+		{
+			std::fill(keys.begin(), keys.end(), -1);
+			code_size = min_code_size + 1;
+			next_code = end_code + 1;
+		};
+
+		emit(clear_code);
+		if (count == 0)
+		{
+			emit(end_code);
+			if (bit_count > 0)
+				output.push_back(static_cast<uint8_t>(bit_buffer));
+			return;
+		}
+
+		int prefix = indices[0];
+		for (size_t i = 1; i < count; ++i)
+		{
+			int32_t key = (prefix << 8) | indices[i];
+			size_t slot = (static_cast<uint32_t>(key) * 2654435761u) & (table_size - 1);
+			while (keys[slot] != -1 && keys[slot] != key)
+				slot = (slot + 1) & (table_size - 1);
+
+			if (keys[slot] == key)
+			{
+				prefix = values[slot];
+				continue;
+			}
+
+			emit(prefix);
+			if (next_code < max_codes)
+			{
+				keys[slot] = key;
+				values[slot] = static_cast<int16_t>(next_code);
+				// The decoder widens its codes one step later than it allocates them
+				if (next_code == (1 << code_size) && code_size < 12)
+					code_size++;
+				next_code++;
+			}
+			else
+			{
+				emit(clear_code);
+				reset();
+			}
+			prefix = indices[i];
+		}
+
+		emit(prefix);
+		emit(end_code);
+		if (bit_count > 0)
+			output.push_back(static_cast<uint8_t>(bit_buffer));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "SDL.h"
+
+#include "bounded_queue.h"
+#include "display.h"
+
+namespace chipotto
+{
+	enum class CaptureFormat
+	{
+		Y4M,
+		Gif
+	};
+
+	enum class CaptureQueuePolicy
+	{
+		Drop,
+		Block
+	};
+
+	struct CaptureOptions
+	{
+		CaptureFormat Format = CaptureFormat::Y4M;
+		CaptureQueuePolicy Policy = CaptureQueuePolicy::Drop;
+		size_t QueueCapacity = 120;
+		// Output pixels per low resolution pixel; rounded up to an even number so
+		// high resolution frames scale by an integer too
+		int Scale = 4;
+		// Colours 0 and 1; the other XO-CHIP colours use Display::DefaultPalette
+		SDL_Color Off = { 0x00, 0x00, 0x00, 0xFF };
+		SDL_Color On = { 0xFF, 0xFF, 0xFF, 0xFF };
+	};
+
+	// Records frames to raw Y4M (a path of "-" writes to stdout, for piping into
+	// an encoder) or to an animated GIF. Frames are handed to an encoder thread
+	// through a bounded queue; identical consecutive frames are never queued, they
+	// only extend how long the previous frame is shown.
+	class VideoCapture
+	{
+	public:
+		VideoCapture() = default;
+		~VideoCapture();
+
+		VideoCapture(const VideoCapture& other) = delete;
+		VideoCapture& operator=(const VideoCapture& other) = delete;
+
+		bool Open(const std::filesystem::path& path, const CaptureOptions& options);
+		void Submit(const Display& display);
+		void Close();
+
+		bool IsOpen() const { return Queue != nullptr; }
+		uint64_t GetFramesSubmitted() const { return FramesSubmitted; }
+		uint64_t GetFramesDeduplicated() const { return FramesDeduplicated; }
+		uint64_t GetFramesDropped() const { return FramesDropped; }
+
+	private:
+		struct CaptureItem
+		{
+			Display Screen;
+			// Extra frames the previously queued frame stays on screen
+			uint32_t PreviousRepeats = 0;
+			bool Final = false;
+		};
+
+		SDL_Color PaletteColor(int index) const;
+		void EncoderLoop();
+		void WriteY4MHeader();
+		void WriteY4MFrame(const Display& display);
+		void WriteGifHeader();
+		void WriteGifFrame(const Display& display, const Display& previous, bool first, uint32_t duration);
+		void WriteGifTrailer();
+
+		CaptureOptions Options;
+		std::FILE* File = nullptr;
+		bool OwnsFile = false;
+		std::unique_ptr<BoundedQueue<CaptureItem>> Queue;
+		std::thread Thread;
+
+		Display LastSubmitted;
+		bool HasSubmitted = false;
+		uint32_t PendingRepeats = 0;
+		uint64_t FramesSubmitted = 0;
+		uint64_t FramesDeduplicated = 0;
+		uint64_t FramesDropped = 0;
+
+		// Encoder thread state
+		std::vector<uint8_t> Buffer;
+		std::vector<uint8_t> Indices;
+		uint64_t GifFramesWritten = 0;
+		uint64_t GifCentisecondsWritten = 0;
+	};
+
+	// Variable-length LZW coder used for GIF image data
+	void EncodeGifLzw(const uint8_t* indices, size_t count, int min_code_size, std::vector<uint8_t>& output);
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "worker_pool.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace chipotto
+{
+	// Cores this process may run on, in ascending order
+	static std::vector<int> GetAllowedCpus()
+	{
+		std::vector<int> cpus;
+#ifdef _WIN32
+		DWORD_PTR process_mask = 0;
+		DWORD_PTR system_mask = 0;
+		if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+		{
+			for (int cpu = 0; cpu < static_cast<int>(sizeof(DWORD_PTR) * 8); ++cpu)
+			{
+				if (process_mask & (static_cast<DWORD_PTR>(1) << cpu))
+					cpus.push_back(cpu);
+			}
+		}
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) == 0)
+		{
+			for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+			{
+				if (CPU_ISSET(cpu, &set))
+					cpus.push_back(cpu);
+			}
+		}
+#endif
+		return cpus;
+	}
+
+	static bool PinCurrentThread(int cpu)
+	{
+		if (cpu < 0)
+			return false;
+#ifdef _WIN32
+		return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+		return false;
+#endif
+	}
+
+	WorkerPool::WorkerPool(int thread_count, bool pin_threads)
+	{
+		if (thread_count <= 0)
+			thread_count = static_cast<int>(std::thread::hardware_concurrency());
+		if (thread_count <= 0)
+			thread_count = 1;
+
+		if (pin_threads)
+		{
+			// More bands than cores wrap around and share
+			std::vector<int> cpus = GetAllowedCpus();
+			for (int band = 0; band < thread_count && !cpus.empty(); ++band)
+				BandCpus.push_back(cpus[band % cpus.size()]);
+		}
+
+		for (int band = 1; band < thread_count; ++band)
+		{
+			Threads.emplace_back(&WorkerPool::WorkerLoop, this, band);
+		}
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			Stopping = true;
+		}
+		WakeCondition.notify_all();
+		for (std::thread& thread : Threads)
+		{
+			thread.join();
+		}
+	}
+
+	bool WorkerPool::PinCallingThread() const
+	{
+		return PinCurrentThread(GetBandCpu(0));
+	}
+
+	void WorkerPool::Run(int count, JobFunction function, void* context)
+	{
+		if (count <= 0)
+			return;
+
+		if (Threads.empty() || count == 1)
+		{
+			function(context, 0, count);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			Job = function;
+			JobContext = context;
+			JobCount = count;
+			PendingBands = static_cast<int>(Threads.size());
+			Generation++;
+		}
+		WakeCondition.notify_all();
+
+		RunBand(0);
+
+		std::unique_lock<std::mutex> lock(Mutex);
+		DoneCondition.wait(lock, [this] { return PendingBands == 0; });
+		Job = nullptr;
+		JobContext = nullptr;
+	}
+
+	void WorkerPool::RunBand(int band)
+	{
+		int bands = GetThreadCount();
+		int begin = static_cast<int>(static_cast<int64_t>(JobCount) * band / bands);
+		int end = static_cast<int>(static_cast<int64_t>(JobCount) * (band + 1) / bands);
+		if (begin < end)
+			Job(JobContext, begin, end);
+	}
+
+	void WorkerPool::WorkerLoop(int band)
+	{
+		if (IsPinned())
+			PinCurrentThread(BandCpus[band]);
+
+		uint64_t seen_generation = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(Mutex);
+				WakeCondition.wait(lock, [this, seen_generation] { return Stopping || Generation != seen_generation; });
+				if (Stopping)
+					return;
+				seen_generation = Generation;
+			}
+
+			RunBand(band);
+
+			{
+				std::lock_guard<std::mutex> lock(Mutex);
+				PendingBands--;
+			}
+			DoneCondition.notify_one();
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace chipotto
+{
+	// Persistent worker threads that split an index range into contiguous bands.
+	// The calling thread runs the first band itself and blocks until every band
+	// is done, so a ParallelFor behaves like a plain loop to the caller.
+	//
+	// Bands are fixed for a given count, so the same index always lands on the
+	// same thread. With pin_threads every worker is bound to its own core, in
+	// the order the process affinity mask lists them. Memory that a band touches
+	// first then comes from that core's NUMA node and stays there.
+	class WorkerPool
+	{
+	public:
+		explicit WorkerPool(int thread_count = 0, bool pin_threads = false);
+		~WorkerPool();
+
+		WorkerPool(const WorkerPool& other) = delete;
+		WorkerPool& operator=(const WorkerPool& other) = delete;
+
+		int GetThreadCount() const { return static_cast<int>(Threads.size()) + 1; }
+		bool IsPinned() const { return !BandCpus.empty(); }
+		// The core band runs on, or -1 when the pool is not pinned
+		int GetBandCpu(int band) const { return BandCpus.empty() ? -1 : BandCpus[band]; }
+
+		// Band 0 runs on the calling thread, which the pool leaves alone unless
+		// this is called from it. Returns false if the platform refused.
+		bool PinCallingThread() const;
+
+		template<typename Function>
+		void ParallelFor(int count, Function&& function)
+		{
+			using Callable = std::remove_reference_t<Function>;
+			auto invoke = [](void* context, int begin, int end) { (*static_cast<Callable*>(context))(begin, end); };
+			Run(count, invoke, const_cast<void*>(static_cast<const void*>(&function)));
+		}
+
+	private:
+		using JobFunction = void (*)(void* context, int begin, int end);
+
+		void Run(int count, JobFunction function, void* context);
+		void RunBand(int band);
+		void WorkerLoop(int band);
+
+		std::vector<std::thread> Threads;
+		std::vector<int> BandCpus;
+		std::mutex Mutex;
+		std::condition_variable WakeCondition;
+		std::condition_variable DoneCondition;
+
+		JobFunction Job = nullptr;
+		void* JobContext = nullptr;
+		int JobCount = 0;
+		int PendingBands = 0;
+		uint64_t Generation = 0;
+		bool Stopping = false;
+	};
+}
@@ -0,0 +1,188 @@
+#include "chip-8.h"
+#include "machine.h"
+#include "machine_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#define CLOVE_SUITE_NAME Allocations
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+// Every allocation of the test executable goes through these, so a test can
+// assert that a stretch of emulation never reaches the heap.
+static std::atomic<uint64_t> AllocationCount = 0;
+
+void* operator new(size_t size)
+{
+    AllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+// Machine and MachineState are over-aligned, so their allocations take these
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    AllocationCount.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    size_t rounded = (std::max<size_t>(size, 1) + align - 1) / align * align;
+#ifdef _WIN32
+    void* pointer = _aligned_malloc(rounded, align);
+#else
+    void* pointer = std::aligned_alloc(align, rounded);
+#endif
+    if (pointer)
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+static void FreeAligned(void* pointer)
+{
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    FreeAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+    FreeAligned(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept
+{
+    FreeAligned(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept
+{
+    FreeAligned(pointer);
+}
+
+static uint64_t GetAllocationCount()
+{
+    return AllocationCount.load(std::memory_order_relaxed);
+}
+
+// Draws, scrolls, reads the keypad, stores to memory and uses both timers in a loop
+static const uint16_t BusyProgram[] = {
+    0x00a3, // 0x200 LD I, 0x300
+    0x0560, // 0x202 LD V0, 5
+    0xc0d0, // 0x204 DRW V0, V0, 0 (16x16 sprite)
+    0xc100, // 0x206 SCD 1
+    0xc1c1, // 0x208 RND V1, 0xC1
+    0x33f1, // 0x20A LD B, V1
+    0x15f1, // 0x20C LD DT, V1
+    0x18f1, // 0x20E LD ST, V1
+    0x9ee0, // 0x210 SKP V0
+    0x55f2, // 0x212 LD [I], V2
+    0x0412, // 0x214 JP 0x204
+};
+
+CLOVE_TEST(OverAlignedAllocationsAreCounted)
+{
+    uint64_t before = GetAllocationCount();
+    Machine* machine = new Machine();
+    CLOVE_IS_TRUE(GetAllocationCount() > before);
+    CLOVE_SIZET_EQ(0, reinterpret_cast<uintptr_t>(machine) % alignof(Machine));
+    delete machine;
+}
+
+CLOVE_TEST(MachineSteadyStateDoesNotAllocate)
+{
+    Machine machine;
+    machine.SetQuirks(QuirkProfile::SuperChip);
+    machine.LoadFromBuffer(BusyProgram, sizeof(BusyProgram) / sizeof(uint16_t));
+    machine.MakeMemoryPrivate();
+
+    uint64_t before = GetAllocationCount();
+    for (int frame = 0; frame < 600; ++frame)
+    {
+        machine.SetKeys(frame & 1 ? 0x20 : 0x0);
+        CLOVE_IS_TRUE(machine.RunFrame(20));
+    }
+    CLOVE_ULLONG_EQ(before, GetAllocationCount());
+}
+
+CLOVE_TEST(PooledCopyOnWriteDoesNotAllocate)
+{
+    MachinePool pool(2);
+    uint32_t index = pool.Acquire();
+    pool[index].SetQuirks(QuirkProfile::SuperChip);
+    uint64_t before = GetAllocationCount();
+    // Loading and the first writes copy pages, from the pool's arena
+    CLOVE_IS_TRUE(pool[index].LoadFromBuffer(BusyProgram, sizeof(BusyProgram) / sizeof(uint16_t)));
+    for (int frame = 0; frame < 60; ++frame)
+        pool.RunFrame(20);
+    CLOVE_ULLONG_EQ(before, GetAllocationCount());
+    CLOVE_IS_TRUE(pool.GetPageArena().GetBlocksInUse() >= 2);
+
+    pool.Release(index);
+    CLOVE_SIZET_EQ(0, pool.GetPageArena().GetBlocksInUse());
+}
+
+CLOVE_TEST(EmulatorSteadyStateDoesNotAllocate)
+{
+    Emulator emulator;
+    emulator.GetMachine().SetQuirks(QuirkProfile::SuperChip);
+    CLOVE_IS_TRUE(emulator.LoadFromBuffer(BusyProgram, sizeof(BusyProgram) / sizeof(uint16_t)));
+
+    // From the very first tick after loading
+    uint64_t before = GetAllocationCount();
+    for (int tick = 0; tick < 600; ++tick)
+        CLOVE_IS_TRUE(emulator.Tick());
+    CLOVE_ULLONG_EQ(before, GetAllocationCount());
+}
+
+CLOVE_TEST(UpscaledEmulatorDoesNotAllocate)
+{
+    Emulator emulator;
+    CLOVE_IS_TRUE(emulator.EnableSoftwareUpscaler(UpscaleFilter::Scale2x, 2));
+    emulator.GetMachine().SetQuirks(QuirkProfile::SuperChip);
+    CLOVE_IS_TRUE(emulator.LoadFromBuffer(BusyProgram, sizeof(BusyProgram) / sizeof(uint16_t)));
+
+    uint64_t before = GetAllocationCount();
+    for (int tick = 0; tick < 600; ++tick)
+        CLOVE_IS_TRUE(emulator.Tick());
+    CLOVE_ULLONG_EQ(before, GetAllocationCount());
+}
\ No newline at end of file
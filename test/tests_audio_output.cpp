@@ -0,0 +1,110 @@
+#include "audio_output.h"
+
+#include <cstdlib>
+#include <vector>
+
+#define CLOVE_SUITE_NAME AudioOutput
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+CLOVE_TEST(RateControlHoldsAverage)
+{
+    AudioRateControl rate;
+    rate.Configure(800.0, 2400);
+
+    // At target fill every frame gets exactly its share
+    int total = 0;
+    for (int frame = 0; frame < 60; ++frame)
+        total += rate.NextFrameSamples(2400);
+    CLOVE_INT_EQ(48000, total);
+    CLOVE_IS_TRUE(rate.GetRatio() == 1.0);
+}
+
+CLOVE_TEST(RateControlIsBounded)
+{
+    AudioRateControl rate;
+    rate.Configure(800.0, 2400, 0.005);
+
+    int starving = rate.NextFrameSamples(0);
+    CLOVE_IS_TRUE(starving > 800 && starving <= 804);
+    int flooded = rate.NextFrameSamples(100000);
+    CLOVE_IS_TRUE(flooded < 800 && flooded >= 795);
+}
+
+CLOVE_TEST(RateControlConvergesOnTarget)
+{
+    // Device drains exactly 800 samples per frame, queue starts short
+    AudioRateControl rate;
+    rate.Configure(800.0, 2400, 0.005);
+    double queued = 1200;
+    for (int frame = 0; frame < 60 * 60 * 10; ++frame)
+    {
+        queued += rate.NextFrameSamples(static_cast<uint32_t>(queued));
+        queued -= 800;
+    }
+    CLOVE_IS_TRUE(queued > 2390 && queued < 2410);
+}
+
+CLOVE_TEST(DevicePacedFramesKeepTheNominalRate)
+{
+    // Frames are requested whenever the queue drops below target, as in
+    // audio-paced mode: a minute of 44.1 kHz playback must take a minute of
+    // emulated frames, not fewer stretched ones
+    AudioRateControl rate;
+    rate.Configure(735.0, 2205, 0.005);
+    double queued = 2205;
+    int frames = 0;
+    for (int ms = 0; ms < 60 * 1000; ++ms)
+    {
+        queued -= 44.1;
+        while (queued < 2205)
+        {
+            queued += rate.NominalFrameSamples();
+            frames++;
+        }
+    }
+    CLOVE_IS_TRUE(frames >= 3599 && frames <= 3601);
+    CLOVE_IS_TRUE(rate.GetRatio() == 1.0);
+}
+
+CLOVE_TEST(SquareWaveRampsWithoutClicks)
+{
+    SquareWave wave;
+    wave.Configure(48000, 440.0, 6000);
+
+    std::vector<int16_t> samples(800);
+    wave.Generate(samples.data(), 800, true);
+    // No full-scale jump on the first sample after gating on
+    CLOVE_IS_TRUE(std::abs(samples[0]) < 100);
+    CLOVE_IS_TRUE(std::abs(samples[400]) == 6000);
+
+    wave.Generate(samples.data(), 800, false);
+    CLOVE_IS_TRUE(std::abs(samples[0]) > 5000);
+    CLOVE_INT_EQ(0, samples[799]);
+}
+
+
+CLOVE_TEST(PatternBitRateFollowsPitch)
+{
+    CLOVE_IS_TRUE(PatternWave::BitRate(64) == 4000.0);
+    CLOVE_IS_TRUE(std::abs(PatternWave::BitRate(112) - 8000.0) < 1e-6);
+}
+
+CLOVE_TEST(PatternWavePlaysBits)
+{
+    PatternWave wave;
+    wave.Configure(8000, 6000);
+    // Alternating bits; at pitch 64 and 8 kHz each bit lasts two samples
+    std::array<uint8_t, 16> pattern;
+    pattern.fill(0xAA);
+    wave.SetPattern(pattern, 64);
+
+    std::vector<int16_t> samples(64);
+    wave.Generate(samples.data(), 64, true);
+    // Past the gain ramp, even bits are high and odd bits low
+    CLOVE_INT_EQ(6000, samples[40]);
+    CLOVE_INT_EQ(6000, samples[41]);
+    CLOVE_INT_EQ(-6000, samples[42]);
+    CLOVE_INT_EQ(-6000, samples[43]);
+}
\ No newline at end of file
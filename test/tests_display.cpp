@@ -0,0 +1,156 @@
+#include "display.h"
+
+#define CLOVE_SUITE_NAME Display
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+CLOVE_TEST(DrawSpriteSetsPixels)
+{
+    Display display;
+    uint8_t sprite[] = { 0x81 };
+    bool collision = display.DrawSprite(10, 5, sprite, 1);
+    CLOVE_IS_FALSE(collision);
+    CLOVE_IS_TRUE(display.GetPixel(10, 5));
+    CLOVE_IS_FALSE(display.GetPixel(11, 5));
+    CLOVE_IS_TRUE(display.GetPixel(17, 5));
+}
+
+CLOVE_TEST(DrawSpriteClipsAtRightEdge)
+{
+    Display display;
+    uint8_t sprite[] = { 0xFF };
+    display.DrawSprite(Display::LowResWidth - 4, 0, sprite, 1);
+    CLOVE_IS_TRUE(display.GetPixel(Display::LowResWidth - 1, 0));
+    CLOVE_IS_FALSE(display.GetPixel(0, 0));
+    CLOVE_IS_FALSE(display.GetPixel(0, 1));
+}
+
+CLOVE_TEST(DrawSpriteClipsAtBottomEdge)
+{
+    Display display;
+    uint8_t sprite[] = { 0x80, 0x80 };
+    display.DrawSprite(0, Display::LowResHeight - 1, sprite, 2);
+    CLOVE_IS_TRUE(display.GetPixel(0, Display::LowResHeight - 1));
+    CLOVE_IS_FALSE(display.GetPixel(0, 0));
+}
+
+CLOVE_TEST(DrawSpriteReportsCollision)
+{
+    Display display;
+    uint8_t sprite[] = { 0x3C };
+    display.DrawSprite(0, 0, sprite, 1);
+    CLOVE_IS_TRUE(display.DrawSprite(2, 0, sprite, 1));
+    CLOVE_IS_FALSE(display.GetPixel(4, 0));
+    CLOVE_IS_TRUE(display.GetPixel(2, 0));
+}
+
+CLOVE_TEST(ClearMarksDirty)
+{
+    Display display;
+    display.ClearDirty();
+    CLOVE_IS_FALSE(display.IsDirty());
+    display.Clear();
+    CLOVE_IS_TRUE(display.IsDirty());
+}
+
+
+CLOVE_TEST(HighResolutionUsesFullSize)
+{
+    Display display;
+    uint8_t sprite[] = { 0x80 };
+    display.DrawSprite(0, 0, sprite, 1);
+    display.SetHighResolution(true);
+    CLOVE_INT_EQ(Display::MaxWidth, display.GetWidth());
+    CLOVE_INT_EQ(Display::MaxHeight, display.GetHeight());
+    CLOVE_IS_FALSE(display.GetPixel(0, 0));
+
+    display.DrawSprite(Display::MaxWidth - 4, Display::MaxHeight - 1, sprite, 1);
+    CLOVE_IS_TRUE(display.GetPixel(Display::MaxWidth - 4, Display::MaxHeight - 1));
+}
+
+CLOVE_TEST(DrawSpriteStraddlesWords)
+{
+    Display display;
+    display.SetHighResolution(true);
+    uint8_t sprite[] = { 0xFF };
+    display.DrawSprite(60, 3, sprite, 1);
+    CLOVE_IS_TRUE(display.GetPixel(63, 3));
+    CLOVE_IS_TRUE(display.GetPixel(64, 3));
+    CLOVE_IS_TRUE(display.GetPixel(67, 3));
+    CLOVE_IS_FALSE(display.GetPixel(68, 3));
+}
+
+CLOVE_TEST(ScrollMovesPixels)
+{
+    Display display;
+    display.SetHighResolution(true);
+    uint8_t sprite[] = { 0x80 };
+    display.DrawSprite(62, 10, sprite, 1);
+
+    display.ScrollDown(4);
+    CLOVE_IS_TRUE(display.GetPixel(62, 14));
+    CLOVE_IS_FALSE(display.GetPixel(62, 10));
+    display.ScrollRight(4);
+    CLOVE_IS_TRUE(display.GetPixel(66, 14));
+    display.ScrollLeft(4);
+    CLOVE_IS_TRUE(display.GetPixel(62, 14));
+    CLOVE_IS_FALSE(display.GetPixel(66, 14));
+
+    display.ScrollDown(Display::MaxHeight);
+    CLOVE_IS_FALSE(display.GetPixel(62, 14));
+}
+
+CLOVE_TEST(DrawLargeSprite)
+{
+    Display display;
+    display.SetHighResolution(true);
+    uint8_t sprite[32];
+    for (int i = 0; i < 32; ++i)
+        sprite[i] = 0xFF;
+
+    CLOVE_IS_FALSE(display.DrawLargeSprite(56, 0, sprite));
+    CLOVE_IS_TRUE(display.GetPixel(56, 0));
+    CLOVE_IS_TRUE(display.GetPixel(71, 15));
+    CLOVE_IS_FALSE(display.GetPixel(72, 15));
+    CLOVE_IS_FALSE(display.GetPixel(56, 16));
+    CLOVE_IS_TRUE(display.DrawLargeSprite(56, 0, sprite));
+    CLOVE_IS_FALSE(display.GetPixel(71, 15));
+}
+
+
+CLOVE_TEST(PlanesCombineIntoColors)
+{
+    Display display;
+    // Plane 0 data first, then plane 1
+    uint8_t sprite[] = { 0xC0, 0xA0 };
+    display.SelectPlanes(0x3);
+    display.DrawSprite(0, 0, sprite, 1);
+
+    CLOVE_INT_EQ(3, display.GetColor(0, 0));
+    CLOVE_INT_EQ(1, display.GetColor(1, 0));
+    CLOVE_INT_EQ(2, display.GetColor(2, 0));
+    CLOVE_INT_EQ(0, display.GetColor(3, 0));
+    CLOVE_IS_FALSE(display.IsMonochrome());
+    CLOVE_IS_TRUE(display.GetLitRow(0)[0] == 0xE000000000000000ULL);
+}
+
+CLOVE_TEST(ClearOnlyTouchesSelectedPlanes)
+{
+    Display display;
+    uint8_t sprite[] = { 0x80 };
+    display.SelectPlanes(0x2);
+    display.DrawSprite(0, 0, sprite, 1);
+    display.SelectPlanes(0x1);
+    display.DrawSprite(0, 1, sprite, 1);
+
+    display.Clear();
+    CLOVE_INT_EQ(2, display.GetColor(0, 0));
+    CLOVE_INT_EQ(0, display.GetColor(0, 1));
+
+    display.SelectPlanes(0x2);
+    display.ScrollDown(1);
+    CLOVE_INT_EQ(2, display.GetColor(0, 1));
+    display.Clear();
+    CLOVE_IS_TRUE(display.IsMonochrome());
+}
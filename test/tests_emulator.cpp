@@ -452,7 +452,33 @@ CLOVE_TEST(OpcodeC_RND_Vx_byte)
 
 CLOVE_TEST(OpcodeD_DRW_Vx_Vy_nibble)
 {
-    // TODO
+    Emulator emulator;
+    uint16_t opcodes[] = { 0x0060, 0x0061, 0x00a0, 0x15d0, 0x15d0 };
+    emulator.LoadFromBuffer(opcodes, 5);
+
+    bool success = emulator.Tick();
+    CLOVE_IS_TRUE(success);
+    success = emulator.Tick();
+    CLOVE_IS_TRUE(success);
+    success = emulator.Tick();
+    CLOVE_IS_TRUE(success);
+    CLOVE_INT_EQ(0x0, emulator.GetI());
+
+    success = emulator.Tick();
+    CLOVE_IS_TRUE(success);
+    CLOVE_INT_EQ(0x0, emulator.GetRegisterValue(0xf));
+    CLOVE_IS_TRUE(emulator.GetDisplay().GetPixel(0, 0));
+    CLOVE_IS_TRUE(emulator.GetDisplay().GetPixel(3, 0));
+    CLOVE_IS_FALSE(emulator.GetDisplay().GetPixel(4, 0));
+    CLOVE_IS_TRUE(emulator.GetDisplay().GetPixel(0, 1));
+    CLOVE_IS_FALSE(emulator.GetDisplay().GetPixel(1, 1));
+
+    // Drawing the same sprite again erases it and reports a collision
+    success = emulator.Tick();
+    CLOVE_IS_TRUE(success);
+    CLOVE_INT_EQ(0x1, emulator.GetRegisterValue(0xf));
+    CLOVE_IS_FALSE(emulator.GetDisplay().GetPixel(0, 0));
+    CLOVE_IS_FALSE(emulator.GetDisplay().GetPixel(0, 1));
 }
 
 CLOVE_TEST(OpcodeE_SKP_Vx)
@@ -465,13 +491,18 @@ CLOVE_TEST(OpcodeE_SKP_Vx)
     CLOVE_IS_TRUE(success);
     CLOVE_INT_EQ(0x5, emulator.GetRegisterValue(0));
 
+    // A key press with no LD Vx, K pending changes nothing by itself, and
+    // key 5 is not held
     pumpEvent();
 
     uint16_t previousPC = emulator.GetPC();
     success = emulator.Tick();
     CLOVE_IS_TRUE(success);
-    CLOVE_INT_EQ(previousPC + 2 * sizeof(uint16_t), emulator.GetPC());
+    CLOVE_INT_EQ(previousPC + sizeof(uint16_t), emulator.GetPC());
+    CLOVE_INT_EQ(0x5, emulator.GetRegisterValue(0));
 
+    success = emulator.Tick();
+    CLOVE_IS_TRUE(success);
     success = emulator.Tick();
     CLOVE_IS_TRUE(success);
     CLOVE_INT_EQ(0x12, emulator.GetRegisterValue(1));
@@ -480,7 +511,7 @@ CLOVE_TEST(OpcodeE_SKP_Vx)
 CLOVE_TEST(OpcodeE_SKNP_Vx)
 {
     Emulator emulator;
-    uint16_t opcodes[] = { 0x660, 0x9ee0, 0xe000, 0x1261 };
+    uint16_t opcodes[] = { 0x660, 0xa1e0, 0xe000, 0x1261 };
     emulator.LoadFromBuffer(opcodes, 4);
 
     bool success = emulator.Tick();
@@ -493,6 +524,7 @@ CLOVE_TEST(OpcodeE_SKNP_Vx)
     success = emulator.Tick();
     CLOVE_IS_TRUE(success);
     CLOVE_INT_EQ(previousPC + 2 * sizeof(uint16_t), emulator.GetPC());
+    CLOVE_INT_EQ(0x6, emulator.GetRegisterValue(0));
 
     success = emulator.Tick();
     CLOVE_IS_TRUE(success);
@@ -524,6 +556,10 @@ CLOVE_TEST(OpcodeF_LD_Vx_K)
     CLOVE_IS_TRUE(success);
     CLOVE_INT_EQ(0x0, emulator.GetRegisterValue(0));
 
+    success = emulator.Tick();
+    CLOVE_IS_TRUE(success);
+    CLOVE_IS_TRUE(emulator.GetMachine().IsWaitingForKey());
+
     pumpEvent();
 
     success = emulator.Tick();
@@ -585,7 +621,19 @@ CLOVE_TEST(OpcodeF_ADD_I_VX)
 
 CLOVE_TEST(OpcodeF_LD_F_VX)
 {
-    // TODO
+    Emulator emulator;
+    uint16_t opcodes[] = { 0x0a60, 0x29f0 };
+    emulator.LoadFromBuffer(opcodes, 2);
+
+    bool success = emulator.Tick();
+    CLOVE_IS_TRUE(success);
+    CLOVE_INT_EQ(0xa, emulator.GetRegisterValue(0));
+
+    success = emulator.Tick();
+    CLOVE_IS_TRUE(success);
+    CLOVE_INT_EQ(50, emulator.GetI());
+    CLOVE_INT_EQ(0xF0, emulator.GetMemoryLocValue(emulator.GetI()));
+    CLOVE_INT_EQ(0x90, emulator.GetMemoryLocValue(emulator.GetI() + 1));
 }
 
 CLOVE_TEST(OpcodeF_LD_B_VX)
@@ -675,4 +723,157 @@ CLOVE_TEST(OpcodeF_LD_Vx_locI)
     CLOVE_INT_EQ(0x2, emulator.GetRegisterValue(1));
     CLOVE_INT_EQ(0x3, emulator.GetRegisterValue(2));
     CLOVE_INT_EQ(0x4, emulator.GetRegisterValue(3));
+}
+
+CLOVE_TEST(AudioPacedTickRunsWholeFrames)
+{
+    Emulator emulator;
+    // LD V0, 1; ADD V0, 1; JP 0x202
+    uint16_t opcodes[] = { 0x0160, 0x0170, 0x0212 };
+    emulator.LoadFromBuffer(opcodes, 3);
+    emulator.SetInstructionsPerFrame(2);
+    CLOVE_IS_TRUE(emulator.EnableAudio(true));
+
+    for (int tick = 0; tick < 20 && emulator.GetPC() == 0x200; ++tick)
+    {
+        CLOVE_IS_TRUE(emulator.Tick());
+    }
+    CLOVE_INT_EQ(0x204, emulator.GetPC());
+    CLOVE_INT_EQ(2, emulator.GetRegisterValue(0));
+}
+
+CLOVE_TEST(TickRunsInstructionsPerFrame)
+{
+    Emulator emulator;
+    // ADD V0, 1; JP 0x200
+    uint16_t opcodes[] = { 0x0170, 0x0012 };
+    emulator.LoadFromBuffer(opcodes, 2);
+    emulator.SetInstructionsPerFrame(3);
+
+    // Well inside the first frame, the extra ticks only wait for the next one
+    for (int tick = 0; tick < 6; ++tick)
+    {
+        CLOVE_IS_TRUE(emulator.Tick());
+    }
+    CLOVE_INT_EQ(2, emulator.GetRegisterValue(0));
+    CLOVE_INT_EQ(0x202, emulator.GetPC());
+}
+
+CLOVE_TEST(LateFrameRunsItsWholeBudget)
+{
+    Emulator emulator;
+    // ADD V0, 1; JP 0x200
+    uint16_t opcodes[] = { 0x0170, 0x0012 };
+    emulator.LoadFromBuffer(opcodes, 2);
+    emulator.SetInstructionsPerFrame(5);
+
+    CLOVE_IS_TRUE(emulator.Tick());
+    CLOVE_INT_EQ(1, emulator.GetRegisterValue(0));
+
+    // The host falls several frames behind: each frame the pacer hands out on
+    // the way back still runs all five instructions
+    SDL_Delay(100);
+    CLOVE_IS_TRUE(emulator.Tick());
+    CLOVE_INT_EQ(3, emulator.GetRegisterValue(0));
+    CLOVE_INT_EQ(0x202, emulator.GetPC());
+    CLOVE_IS_TRUE(emulator.Tick());
+    CLOVE_INT_EQ(5, emulator.GetRegisterValue(0));
+    CLOVE_INT_EQ(0x200, emulator.GetPC());
+}
+
+CLOVE_TEST(ResetKeepsHostResources)
+{
+    Emulator emulator;
+    SDL_Texture* texture = emulator.GetTexture();
+    uint16_t opcodes[] = { 0x0560, 0xff00 };
+    emulator.LoadFromBuffer(opcodes, 2);
+    CLOVE_IS_TRUE(emulator.Tick());
+    CLOVE_IS_TRUE(emulator.Tick());
+    CLOVE_INT_EQ(128, emulator.GetWidth());
+
+    emulator.Reset();
+    CLOVE_PTR_EQ(texture, emulator.GetTexture());
+    CLOVE_INT_EQ(0x200, emulator.GetPC());
+    CLOVE_INT_EQ(0, emulator.GetRegisterValue(0));
+    CLOVE_INT_EQ(0, emulator.GetMemoryLocValue(0x200));
+    CLOVE_INT_EQ(64, emulator.GetWidth());
+}
+
+CLOVE_TEST(ResetPrimesAudioQueue)
+{
+    Emulator emulator;
+    CLOVE_IS_TRUE(emulator.EnableAudio(false));
+    emulator.Reset();
+    // A new program starts on silence, not on an empty queue
+    CLOVE_IS_TRUE(emulator.GetAudio()->GetQueuedSamples() > 0);
+}
+
+CLOVE_TEST(LoadRomUndoesDatabaseSettings)
+{
+    std::filesystem::path known_path = std::filesystem::temp_directory_path() / "chipotto_known.ch8";
+    std::filesystem::path other_path = std::filesystem::temp_directory_path() / "chipotto_other.ch8";
+    std::filesystem::path database_path = std::filesystem::temp_directory_path() / "chipotto_emulator.c8db";
+    const uint8_t known[] = { 0x12, 0x00 };
+    const uint8_t other[] = { 0x12, 0x02 };
+    std::ofstream(known_path, std::ios::binary).write(reinterpret_cast<const char*>(known), sizeof(known));
+    std::ofstream(other_path, std::ios::binary).write(reinterpret_cast<const char*>(other), sizeof(other));
+
+    RomDatabaseEntry entry;
+    entry.Hash = HashRom(known, sizeof(known));
+    entry.InstructionsPerFrame = 30;
+    entry.Quirks = QuirkProfile::CosmacVip;
+    CLOVE_IS_TRUE(RomDatabase::Write(database_path, { entry }));
+
+    Emulator emulator;
+    CLOVE_IS_TRUE(emulator.OpenRomDatabase(database_path));
+    CLOVE_IS_TRUE(emulator.LoadRom(known_path));
+    CLOVE_INT_EQ(30, emulator.GetInstructionsPerFrame());
+    CLOVE_IS_TRUE(emulator.GetMachine().GetQuirks() == QuirkProfile::CosmacVip);
+
+    CLOVE_IS_TRUE(emulator.LoadRom(other_path));
+    CLOVE_INT_EQ(11, emulator.GetInstructionsPerFrame());
+    CLOVE_IS_TRUE(emulator.GetMachine().GetQuirks() == QuirkProfile::Modern);
+    CLOVE_INT_EQ(0x12, emulator.GetMemoryLocValue(0x200));
+    CLOVE_INT_EQ(0x02, emulator.GetMemoryLocValue(0x201));
+
+    std::filesystem::remove(known_path);
+    std::filesystem::remove(other_path);
+    std::filesystem::remove(database_path);
+}
+
+CLOVE_TEST(LoadRomUndoesDisplayMode)
+{
+    std::filesystem::path known_path = std::filesystem::temp_directory_path() / "chipotto_scaled.ch8";
+    std::filesystem::path other_path = std::filesystem::temp_directory_path() / "chipotto_unscaled.ch8";
+    std::filesystem::path database_path = std::filesystem::temp_directory_path() / "chipotto_display.c8db";
+    const uint8_t known[] = { 0x12, 0x00 };
+    const uint8_t other[] = { 0x12, 0x02 };
+    std::ofstream(known_path, std::ios::binary).write(reinterpret_cast<const char*>(known), sizeof(known));
+    std::ofstream(other_path, std::ios::binary).write(reinterpret_cast<const char*>(other), sizeof(other));
+
+    RomDatabaseEntry entry;
+    entry.Hash = HashRom(known, sizeof(known));
+    entry.DisplayMode = RomDisplayMode::Scale2x;
+    CLOVE_IS_TRUE(RomDatabase::Write(database_path, { entry }));
+
+    Emulator emulator;
+    bool baseline = emulator.IsUpscaling();
+    CLOVE_IS_TRUE(emulator.OpenRomDatabase(database_path));
+    CLOVE_IS_TRUE(emulator.LoadRom(known_path));
+    CLOVE_IS_TRUE(emulator.IsUpscaling());
+    CLOVE_IS_TRUE(emulator.GetUpscaleFilter() == UpscaleFilter::Scale2x);
+
+    CLOVE_IS_TRUE(emulator.LoadRom(other_path));
+    CLOVE_IS_TRUE(emulator.IsUpscaling() == baseline);
+
+    CLOVE_IS_TRUE(emulator.EnableSoftwareUpscaler(UpscaleFilter::Nearest));
+    CLOVE_IS_TRUE(emulator.LoadRom(known_path));
+    CLOVE_IS_TRUE(emulator.GetUpscaleFilter() == UpscaleFilter::Scale2x);
+    emulator.Reset();
+    CLOVE_IS_TRUE(emulator.IsUpscaling());
+    CLOVE_IS_TRUE(emulator.GetUpscaleFilter() == UpscaleFilter::Nearest);
+
+    std::filesystem::remove(known_path);
+    std::filesystem::remove(other_path);
+    std::filesystem::remove(database_path);
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "frame_pacer.h"
+
+#define CLOVE_SUITE_NAME FramePacer
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+CLOVE_TEST(FirstFramePresents)
+{
+    FramePacer pacer;
+    CLOVE_INT_EQ(static_cast<int>(FrameAction::Present), static_cast<int>(pacer.Advance(1000)));
+    CLOVE_INT_EQ(static_cast<int>(FrameAction::None), static_cast<int>(pacer.Advance(1001)));
+    CLOVE_ULLONG_EQ(1, pacer.GetFramesPresented());
+}
+
+CLOVE_TEST(OnTimeFramesAreNotDropped)
+{
+    FramePacer pacer;
+    for (uint64_t frame = 0; frame < 10; ++frame)
+    {
+        CLOVE_INT_EQ(static_cast<int>(FrameAction::Present), static_cast<int>(pacer.Advance(frame * 1000 / 60)));
+    }
+    CLOVE_ULLONG_EQ(10, pacer.GetFramesPresented());
+    CLOVE_ULLONG_EQ(0, pacer.GetFramesDropped());
+}
+
+CLOVE_TEST(LateFramesAreSkippedUpToMax)
+{
+    FramePacer pacer;
+    pacer.SetMaxFrameSkip(2);
+    pacer.Advance(0);
+
+    // 100ms late: six frames are overdue
+    CLOVE_INT_EQ(static_cast<int>(FrameAction::Skip), static_cast<int>(pacer.Advance(100)));
+    CLOVE_INT_EQ(static_cast<int>(FrameAction::Skip), static_cast<int>(pacer.Advance(100)));
+    CLOVE_INT_EQ(static_cast<int>(FrameAction::Present), static_cast<int>(pacer.Advance(100)));
+    CLOVE_ULLONG_EQ(2, pacer.GetFramesDropped());
+}
+
+CLOVE_TEST(NoSkipWhenDisabled)
+{
+    FramePacer pacer;
+    pacer.SetMaxFrameSkip(0);
+    pacer.Advance(0);
+    CLOVE_INT_EQ(static_cast<int>(FrameAction::Present), static_cast<int>(pacer.Advance(100)));
+    CLOVE_ULLONG_EQ(0, pacer.GetFramesDropped());
+}
@@ -0,0 +1,165 @@
+#include "frame_stream.h"
+
+#include <filesystem>
+#include <vector>
+
+#define CLOVE_SUITE_NAME FrameStream
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+static std::filesystem::path StreamPath(const char* name)
+{
+    return std::filesystem::temp_directory_path() / name;
+}
+
+static void DrawFrame(Display& display, int frame)
+{
+    uint8_t sprite[] = { static_cast<uint8_t>(frame | 0x81) };
+    display.DrawSprite(frame % Display::LowResWidth, frame % Display::LowResHeight, sprite, 1);
+}
+
+CLOVE_TEST(DeltaRoundTrip)
+{
+    Display previous;
+    Display current;
+    uint8_t sprite[] = { 0xFF, 0x81 };
+    current.DrawSprite(3, 4, sprite, 2);
+
+    std::vector<uint8_t> payload;
+    FrameStreamFormat::EncodeDeltaFrame(current.GetFrame(), previous.GetFrame(), payload);
+
+    Display::Frame decoded = previous.GetFrame();
+    CLOVE_IS_TRUE(FrameStreamFormat::DecodeFrame(FrameStreamFormat::DeltaFrame, payload.data(), payload.size(), decoded));
+    CLOVE_IS_TRUE(decoded == current.GetFrame());
+}
+
+CLOVE_TEST(UnchangedFrameIsTiny)
+{
+    Display display;
+    std::vector<uint8_t> payload;
+    FrameStreamFormat::EncodeDeltaFrame(display.GetFrame(), display.GetFrame(), payload);
+    CLOVE_IS_TRUE(payload.size() <= 4);
+}
+
+CLOVE_TEST(WriteThenSeek)
+{
+    std::filesystem::path path = StreamPath("chipotto_stream_seek.c8fs");
+    std::vector<Display::Frame> expected;
+    {
+        FrameStreamWriter writer;
+        CLOVE_IS_TRUE(writer.Open(path, 8));
+        Display display;
+        for (int frame = 0; frame < 50; ++frame)
+        {
+            DrawFrame(display, frame);
+            writer.Submit(display);
+            expected.push_back(display.GetFrame());
+        }
+        writer.Close();
+        CLOVE_ULLONG_EQ(50, writer.GetFramesWritten());
+    }
+
+    FrameStreamReader reader;
+    CLOVE_IS_TRUE(reader.Open(path));
+    CLOVE_ULLONG_EQ(50, reader.GetFrameCount());
+
+    Display::Frame frame;
+    uint64_t order[] = { 37, 0, 49, 12, 13, 14, 8 };
+    for (uint64_t index : order)
+    {
+        CLOVE_IS_TRUE(reader.ReadFrame(index, frame));
+        CLOVE_IS_TRUE(frame == expected[index]);
+    }
+    CLOVE_IS_FALSE(reader.ReadFrame(50, frame));
+
+    std::filesystem::remove(path);
+}
+
+CLOVE_TEST(FullQueueDropsInsteadOfWaiting)
+{
+    std::filesystem::path path = StreamPath("chipotto_stream_drop.c8fs");
+    uint64_t dropped;
+    {
+        FrameStreamWriter writer;
+        CLOVE_IS_TRUE(writer.Open(path, 8, 1));
+        Display display;
+        for (int frame = 0; frame < 200; ++frame)
+        {
+            DrawFrame(display, frame);
+            writer.Submit(display);
+        }
+        writer.Close();
+        dropped = writer.GetFramesDropped();
+        // Dropped frames are written as repeats, so none go missing
+        CLOVE_ULLONG_EQ(200, writer.GetFramesWritten());
+    }
+    CLOVE_IS_TRUE(dropped < 200);
+
+    FrameStreamReader reader;
+    CLOVE_IS_TRUE(reader.Open(path));
+    CLOVE_ULLONG_EQ(200, reader.GetFrameCount());
+    Display::Frame frame;
+    CLOVE_IS_TRUE(reader.ReadFrame(199, frame));
+
+    std::filesystem::remove(path);
+}
+
+CLOVE_TEST(TruncatedStreamIsScanned)
+{
+    std::filesystem::path path = StreamPath("chipotto_stream_truncated.c8fs");
+    std::vector<Display::Frame> expected;
+    {
+        FrameStreamWriter writer;
+        CLOVE_IS_TRUE(writer.Open(path, 4));
+        Display display;
+        for (int frame = 0; frame < 10; ++frame)
+        {
+            DrawFrame(display, frame);
+            writer.Submit(display);
+            expected.push_back(display.GetFrame());
+        }
+    }
+
+    // Drop the footer as if the process had died before closing
+    uint64_t size = std::filesystem::file_size(path);
+    std::filesystem::resize_file(path, size - FrameStreamFormat::FooterSize - 3 * 16);
+
+    FrameStreamReader reader;
+    CLOVE_IS_TRUE(reader.Open(path));
+    CLOVE_ULLONG_EQ(10, reader.GetFrameCount());
+    Display::Frame frame;
+    CLOVE_IS_TRUE(reader.ReadFrame(9, frame));
+    CLOVE_IS_TRUE(frame == expected[9]);
+
+    std::filesystem::remove(path);
+}
+
+
+CLOVE_TEST(ResolutionIsRecorded)
+{
+    std::filesystem::path path = StreamPath("chipotto_stream_hires.c8fs");
+    Display high;
+    {
+        FrameStreamWriter writer;
+        CLOVE_IS_TRUE(writer.Open(path, 4));
+        Display display;
+        writer.Submit(display);
+        display.SetHighResolution(true);
+        uint8_t sprite[] = { 0xFF };
+        display.DrawSprite(120, 60, sprite, 1);
+        writer.Submit(display);
+        high = display;
+    }
+
+    FrameStreamReader reader;
+    CLOVE_IS_TRUE(reader.Open(path));
+    Display::Frame frame;
+    CLOVE_IS_TRUE(reader.ReadFrame(0, frame));
+    CLOVE_IS_FALSE(reader.IsHighResolution());
+    CLOVE_IS_TRUE(reader.ReadFrame(1, frame));
+    CLOVE_IS_TRUE(reader.IsHighResolution());
+    CLOVE_IS_TRUE(frame == high.GetFrame());
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,462 @@
+#include "machine.h"
+
+#include <vector>
+
+#define CLOVE_SUITE_NAME Machine
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+CLOVE_TEST(StepWithoutWindow)
+{
+    Machine machine;
+    uint16_t opcodes[] = { 0x2a60, 0x0570 };
+    machine.LoadFromBuffer(opcodes, 2);
+
+    CLOVE_IS_TRUE(machine.Step() == OpcodeStatus::IncrementPC);
+    CLOVE_IS_TRUE(machine.Step() == OpcodeStatus::IncrementPC);
+    CLOVE_INT_EQ(0x2f, machine.GetRegisterValue(0));
+    CLOVE_INT_EQ(0x204, machine.GetPC());
+}
+
+CLOVE_TEST(TimersTickOncePerFrame)
+{
+    Machine machine;
+    // LD V0, 3; LD DT, V0; LD ST, V0; JP 0x206
+    uint16_t opcodes[] = { 0x0360, 0x15f0, 0x18f0, 0x0612 };
+    machine.LoadFromBuffer(opcodes, 4);
+
+    CLOVE_IS_TRUE(machine.RunFrame(3));
+    CLOVE_INT_EQ(2, machine.GetDelayTimer());
+    CLOVE_INT_EQ(2, machine.GetSoundTimer());
+    CLOVE_IS_TRUE(machine.RunFrame(3));
+    CLOVE_IS_TRUE(machine.RunFrame(3));
+    CLOVE_IS_TRUE(machine.RunFrame(3));
+    CLOVE_INT_EQ(0, machine.GetDelayTimer());
+    CLOVE_INT_EQ(0, machine.GetSoundTimer());
+}
+
+CLOVE_TEST(KeypadMask)
+{
+    Machine machine;
+    // LD V0, 7; SKP V0; LD V1, 1; LD V2, 2
+    uint16_t opcodes[] = { 0x0760, 0x9ee0, 0x0161, 0x0262 };
+    machine.LoadFromBuffer(opcodes, 4);
+
+    machine.SetKeys(1 << 7);
+    machine.Step();
+    machine.Step();
+    machine.Step();
+    CLOVE_INT_EQ(0, machine.GetRegisterValue(1));
+    CLOVE_INT_EQ(2, machine.GetRegisterValue(2));
+}
+
+CLOVE_TEST(KeyWaitResumesWithHeldKey)
+{
+    Machine machine;
+    // LD V3, K; LD V4, 4
+    uint16_t opcodes[] = { 0x0af3, 0x0464 };
+    machine.LoadFromBuffer(opcodes, 2);
+
+    CLOVE_IS_TRUE(machine.RunFrame(10));
+    CLOVE_IS_TRUE(machine.IsWaitingForKey());
+    CLOVE_INT_EQ(0x200, machine.GetPC());
+
+    machine.SetKeys((1 << 0xB) | (1 << 0xE));
+    CLOVE_IS_TRUE(machine.RunFrame(1));
+    CLOVE_IS_FALSE(machine.IsWaitingForKey());
+    CLOVE_INT_EQ(0xB, machine.GetRegisterValue(3));
+    CLOVE_INT_EQ(4, machine.GetRegisterValue(4));
+}
+
+CLOVE_TEST(KeyPressWithoutWaitIsIgnored)
+{
+    Machine machine;
+    // LD V0, 5; LD V1, 6
+    uint16_t opcodes[] = { 0x0560, 0x0661 };
+    machine.LoadFromBuffer(opcodes, 2);
+    machine.Step();
+
+    machine.CompleteKeyWait(0xA);
+    CLOVE_IS_FALSE(machine.IsWaitingForKey());
+    CLOVE_INT_EQ(0x202, machine.GetPC());
+    CLOVE_INT_EQ(5, machine.GetRegisterValue(0));
+    for (int index = 1; index < 0x10; ++index)
+    {
+        CLOVE_INT_EQ(0, machine.GetRegisterValue(index));
+    }
+}
+
+CLOVE_TEST(RandomIsReproducible)
+{
+    Machine first;
+    Machine second;
+    uint16_t opcodes[] = { 0xffc0, 0xffc1, 0xffc2 };
+    first.LoadFromBuffer(opcodes, 3);
+    second.LoadFromBuffer(opcodes, 3);
+    first.SetRandomSeed(1234);
+    second.SetRandomSeed(1234);
+
+    first.RunFrame(3);
+    second.RunFrame(3);
+    for (int index = 0; index < 3; ++index)
+    {
+        CLOVE_INT_EQ(first.GetRegisterValue(index), second.GetRegisterValue(index));
+    }
+}
+
+CLOVE_TEST(FontIsLoaded)
+{
+    Machine machine;
+    // Glyph F starts at 5 * 0xF
+    CLOVE_INT_EQ(0xF0, machine.GetMemoryLocValue(75));
+    CLOVE_INT_EQ(0x80, machine.GetMemoryLocValue(79));
+}
+
+CLOVE_TEST(UnknownOpcodeStopsFrame)
+{
+    Machine machine;
+    uint16_t opcodes[] = { 0xffff };
+    machine.LoadFromBuffer(opcodes, 1);
+    CLOVE_IS_FALSE(machine.RunFrame(10));
+}
+
+CLOVE_TEST(SwitchResolution)
+{
+    Machine machine;
+    // HIGH; LOW
+    uint16_t opcodes[] = { 0xff00, 0xfe00 };
+    machine.LoadFromBuffer(opcodes, 2);
+
+    machine.Step();
+    CLOVE_IS_TRUE(machine.GetDisplay().IsHighResolution());
+    machine.Step();
+    CLOVE_IS_FALSE(machine.GetDisplay().IsHighResolution());
+}
+
+CLOVE_TEST(ScrollOpcodes)
+{
+    Machine machine;
+    // HIGH; SCD 4; SCR; SCL
+    uint16_t opcodes[] = { 0xff00, 0xc400, 0xfb00, 0xfc00 };
+    machine.LoadFromBuffer(opcodes, 4);
+    machine.Step();
+
+    uint8_t sprite[] = { 0x80 };
+    machine.GetDisplay().DrawSprite(10, 10, sprite, 1);
+    machine.Step();
+    CLOVE_IS_TRUE(machine.GetDisplay().GetPixel(10, 14));
+    machine.Step();
+    CLOVE_IS_TRUE(machine.GetDisplay().GetPixel(14, 14));
+    machine.Step();
+    CLOVE_IS_TRUE(machine.GetDisplay().GetPixel(10, 14));
+    CLOVE_IS_FALSE(machine.GetDisplay().GetPixel(14, 14));
+}
+
+CLOVE_TEST(DrawLargeSprite)
+{
+    Machine machine;
+    // HIGH; LD I, 0x20A; DRW V0, V1, 0; JP 0x206; then a solid 16x16 sprite
+    uint16_t opcodes[21] = { 0xff00, 0x0aa2, 0x10d0, 0x0612, 0x0000 };
+    for (int i = 5; i < 21; ++i)
+        opcodes[i] = 0xffff;
+    machine.LoadFromBuffer(opcodes, 21);
+
+    CLOVE_IS_TRUE(machine.RunFrame(3));
+    CLOVE_IS_TRUE(machine.GetDisplay().GetPixel(0, 0));
+    CLOVE_IS_TRUE(machine.GetDisplay().GetPixel(15, 15));
+    CLOVE_IS_FALSE(machine.GetDisplay().GetPixel(16, 15));
+    CLOVE_IS_FALSE(machine.GetDisplay().GetPixel(15, 16));
+    CLOVE_INT_EQ(0, machine.GetRegisterValue(0xF));
+}
+
+CLOVE_TEST(LargeFontAddress)
+{
+    Machine machine;
+    // LD V0, 5; LD HF, V0
+    uint16_t opcodes[] = { 0x0560, 0x30f0 };
+    machine.LoadFromBuffer(opcodes, 2);
+
+    machine.Step();
+    machine.Step();
+    CLOVE_INT_EQ(Machine::LargeFontAddress + 50, machine.GetI());
+    // Large glyph 0 starts with a full-width top row
+    CLOVE_INT_EQ(0xFF, machine.GetMemoryLocValue(Machine::LargeFontAddress));
+}
+
+CLOVE_TEST(FlagRegistersRoundTrip)
+{
+    Machine machine;
+    // LD V0, 1; LD V1, 2; LD R, V1; LD V0, 0; LD V1, 0; LD V1, R
+    uint16_t opcodes[] = { 0x0160, 0x0261, 0x75f1, 0x0060, 0x0061, 0x85f1 };
+    machine.LoadFromBuffer(opcodes, 6);
+
+    for (int i = 0; i < 6; ++i)
+        machine.Step();
+    CLOVE_INT_EQ(2, machine.GetFlags()[1]);
+    CLOVE_INT_EQ(1, machine.GetRegisterValue(0));
+    CLOVE_INT_EQ(2, machine.GetRegisterValue(1));
+}
+
+CLOVE_TEST(ExitStopsFrame)
+{
+    Machine machine;
+    uint16_t opcodes[] = { 0xfd00 };
+    machine.LoadFromBuffer(opcodes, 1);
+    CLOVE_IS_TRUE(machine.Step() == OpcodeStatus::Exit);
+    CLOVE_IS_FALSE(machine.RunFrame(10));
+}
+
+
+CLOVE_TEST(LongLoadAndSkip)
+{
+    Machine machine;
+    // LD I, LONG 0x1234; SE V0, 0; LD I, LONG 0xFFFF; LD V1, 1
+    uint16_t opcodes[] = { 0x00f0, 0x3412, 0x0030, 0x00f0, 0xffff, 0x0161 };
+    machine.LoadFromBuffer(opcodes, 6);
+
+    machine.Step();
+    CLOVE_INT_EQ(0x1234, machine.GetI());
+    CLOVE_INT_EQ(0x204, machine.GetPC());
+    // The skip steps over all four bytes of the long load
+    machine.Step();
+    CLOVE_INT_EQ(0x20A, machine.GetPC());
+    machine.Step();
+    CLOVE_INT_EQ(1, machine.GetRegisterValue(1));
+    CLOVE_INT_EQ(0x1234, machine.GetI());
+}
+
+CLOVE_TEST(HighMemoryIsAddressable)
+{
+    Machine machine;
+    // LD I, LONG 0xFFFE; LD V0, 7; LD V1, 9; LD V2, 4; LD [I], V2
+    uint16_t opcodes[] = { 0x00f0, 0xfeff, 0x0760, 0x0961, 0x0462, 0x55f2 };
+    machine.LoadFromBuffer(opcodes, 6);
+
+    for (int i = 0; i < 5; ++i)
+        machine.Step();
+    CLOVE_INT_EQ(7, machine.GetMemoryLocValue(0xFFFE));
+    CLOVE_INT_EQ(9, machine.GetMemoryLocValue(0xFFFF));
+    // Addresses wrap around the 64 KB space
+    CLOVE_INT_EQ(4, machine.GetMemoryLocValue(0x0000));
+}
+
+CLOVE_TEST(SaveAndLoadRegisterRange)
+{
+    Machine machine;
+    // LD I, 0x300; LD V2, 2; LD V3, 3; LD V4, 4; SAVE V2 - V4; LOAD V7 - V5
+    uint16_t opcodes[] = { 0x00a3, 0x0262, 0x0363, 0x0464, 0x4252, 0x5357 };
+    machine.LoadFromBuffer(opcodes, 6);
+
+    for (int i = 0; i < 6; ++i)
+        machine.Step();
+    CLOVE_INT_EQ(0x300, machine.GetI());
+    CLOVE_INT_EQ(2, machine.GetMemoryLocValue(0x300));
+    CLOVE_INT_EQ(4, machine.GetMemoryLocValue(0x302));
+    // Descending range: V7 takes the first byte
+    CLOVE_INT_EQ(2, machine.GetRegisterValue(7));
+    CLOVE_INT_EQ(3, machine.GetRegisterValue(6));
+    CLOVE_INT_EQ(4, machine.GetRegisterValue(5));
+}
+
+CLOVE_TEST(DrawOnSelectedPlanes)
+{
+    Machine machine;
+    // PLANE 3; LD I, 0x20A; DRW V0, V0, 1; JP 0x206; plane 0 then plane 1 data
+    uint16_t opcodes[] = { 0x01f3, 0x0aa2, 0x01d0, 0x0612, 0x0000, 0xa0c0 };
+    machine.LoadFromBuffer(opcodes, 6);
+
+    CLOVE_IS_TRUE(machine.RunFrame(3));
+    CLOVE_INT_EQ(3, machine.GetDisplay().GetColor(0, 0));
+    CLOVE_INT_EQ(1, machine.GetDisplay().GetColor(1, 0));
+    CLOVE_INT_EQ(2, machine.GetDisplay().GetColor(2, 0));
+}
+
+CLOVE_TEST(AudioPatternAndPitch)
+{
+    Machine machine;
+    // LD I, 0; AUDIO; LD V0, 0x70; PITCH V0
+    uint16_t opcodes[] = { 0x00a0, 0x02f0, 0x7060, 0x3af0 };
+    machine.LoadFromBuffer(opcodes, 4);
+
+    CLOVE_IS_FALSE(machine.HasAudioPattern());
+    CLOVE_INT_EQ(Machine::DefaultPitch, machine.GetPitch());
+    for (int i = 0; i < 4; ++i)
+        machine.Step();
+    CLOVE_IS_TRUE(machine.HasAudioPattern());
+    // The pattern is the font glyph for 0 that sits at address 0
+    CLOVE_INT_EQ(0xF0, machine.GetAudioPattern()[0]);
+    CLOVE_INT_EQ(0x70, machine.GetPitch());
+}
+
+CLOVE_TEST(ModernQuirksByDefault)
+{
+    Machine machine;
+    // LD V1, 0x81; LD V2, 4; SHR V1, V2; LD I, 0x300; LD [I], V0; LD V0, 2; JP V0, 0x300
+    uint16_t opcodes[] = { 0x8161, 0x0462, 0x2681, 0x00a3, 0x55f0, 0x0260, 0x00b3 };
+    machine.LoadFromBuffer(opcodes, 7);
+
+    CLOVE_IS_TRUE(machine.GetQuirks() == QuirkProfile::Modern);
+    for (int i = 0; i < 7; ++i)
+        machine.Step();
+    CLOVE_INT_EQ(0x40, machine.GetRegisterValue(1));
+    CLOVE_INT_EQ(0x300, machine.GetI());
+    CLOVE_INT_EQ(0x302, machine.GetPC());
+}
+
+CLOVE_TEST(CosmacVipQuirks)
+{
+    Machine machine;
+    machine.SetQuirks(QuirkProfile::CosmacVip);
+    // LD V1, 0x81; LD V2, 4; SHR V1, V2; LD I, 0x300; LD [I], V0; LD VF, 1; OR V1, V2
+    uint16_t opcodes[] = { 0x8161, 0x0462, 0x2681, 0x00a3, 0x55f0, 0x016f, 0x2181 };
+    machine.LoadFromBuffer(opcodes, 7);
+
+    for (int i = 0; i < 7; ++i)
+        machine.Step();
+    // Shift reads Vy, Fx55 advances I, logic ops reset VF
+    CLOVE_INT_EQ(0x06, machine.GetRegisterValue(1));
+    CLOVE_INT_EQ(0x301, machine.GetI());
+    CLOVE_INT_EQ(0, machine.GetRegisterValue(0xF));
+}
+
+CLOVE_TEST(SuperChipJumpUsesVx)
+{
+    Machine machine;
+    machine.SetQuirks(QuirkProfile::SuperChip);
+    // LD V0, 8; LD V3, 2; JP V3, 0x300
+    uint16_t opcodes[] = { 0x0860, 0x0263, 0x00b3 };
+    machine.LoadFromBuffer(opcodes, 3);
+
+    for (int i = 0; i < 3; ++i)
+        machine.Step();
+    CLOVE_INT_EQ(0x302, machine.GetPC());
+}
+
+CLOVE_TEST(XoChipSpritesWrap)
+{
+    Machine machine;
+    machine.SetQuirks(QuirkProfile::XoChip);
+    // LD V0, 60; LD V1, 31; LD I, 0x20A; DRW V0, V1, 2; JP 0x208; sprite
+    uint16_t opcodes[] = { 0x3c60, 0x1f61, 0x0aa2, 0x12d0, 0x0812, 0xffff };
+    machine.LoadFromBuffer(opcodes, 6);
+
+    CLOVE_IS_TRUE(machine.RunFrame(4));
+    const Display& display = machine.GetDisplay();
+    CLOVE_IS_TRUE(display.GetPixel(63, 31));
+    CLOVE_IS_TRUE(display.GetPixel(0, 31));
+    CLOVE_IS_TRUE(display.GetPixel(3, 0));
+    CLOVE_IS_FALSE(display.GetPixel(4, 0));
+}
+
+CLOVE_TEST(ResetClearsProgramState)
+{
+    Machine machine;
+    machine.SetQuirks(QuirkProfile::SuperChip);
+    // LD I, 0; LD V0, 0xAA; LD [I], V0; HIGH; CALL 0x300
+    uint16_t opcodes[] = { 0x00a0, 0xaa60, 0x55f0, 0xff00, 0x0023 };
+    machine.LoadFromBuffer(opcodes, 5);
+    for (int i = 0; i < 5; ++i)
+        machine.Step();
+    CLOVE_INT_EQ(0xAA, machine.GetMemoryLocValue(0));
+    CLOVE_IS_TRUE(machine.GetDisplay().IsHighResolution());
+
+    machine.Reset();
+    CLOVE_INT_EQ(0xF0, machine.GetMemoryLocValue(0));
+    CLOVE_INT_EQ(0, machine.GetMemoryLocValue(0x200));
+    CLOVE_INT_EQ(0, machine.GetRegisterValue(0));
+    CLOVE_INT_EQ(0x200, machine.GetPC());
+    CLOVE_INT_EQ(0, machine.GetI());
+    CLOVE_IS_FALSE(machine.GetDisplay().IsHighResolution());
+    CLOVE_ULLONG_EQ(0, machine.GetRomHash());
+    CLOVE_IS_TRUE(machine.GetQuirks() == QuirkProfile::SuperChip);
+}
+
+CLOVE_TEST(LoadFromSpanIsBoundsChecked)
+{
+    Machine machine;
+    std::vector<std::byte> rom(Machine::MaxRomSize + 1, std::byte{ 0x11 });
+    CLOVE_IS_FALSE(machine.LoadFromSpan(rom));
+    CLOVE_INT_EQ(0, machine.GetMemoryLocValue(0x200));
+
+    rom.pop_back();
+    CLOVE_IS_TRUE(machine.LoadFromSpan(rom));
+    CLOVE_INT_EQ(0x11, machine.GetMemoryLocValue(0x200));
+    CLOVE_INT_EQ(0x11, machine.GetMemoryLocValue(0xFFFF));
+}
+
+CLOVE_TEST(LoadFromBufferIsBoundsChecked)
+{
+    Machine machine;
+    std::vector<uint16_t> words(Machine::MaxRomSize / 2 + 1, 0x1111);
+    CLOVE_IS_FALSE(machine.LoadFromBuffer(words.data(), words.size()));
+    CLOVE_INT_EQ(0, machine.GetMemoryLocValue(0x200));
+    CLOVE_IS_TRUE(machine.LoadFromBuffer(words.data(), words.size() - 1));
+    CLOVE_INT_EQ(0x11, machine.GetMemoryLocValue(0x200));
+}
+
+CLOVE_TEST(LoadFromSpanKeepsByteOrder)
+{
+    Machine machine;
+    const std::byte rom[] = { std::byte{ 0x00 }, std::byte{ 0xE0 } };
+    CLOVE_IS_TRUE(machine.LoadFromSpan(rom));
+    CLOVE_INT_EQ(0x00E0, machine.GetCurrentOpcode());
+}
+
+CLOVE_TEST(ForkRunsIndependently)
+{
+    Machine machine;
+    // LD I, 0x300; RND V1, 0xFF; ADD V0, 1; LD [I], V0; JP 0x202
+    uint16_t opcodes[] = { 0x00a3, 0xffc1, 0x0170, 0x55f0, 0x0212 };
+    machine.LoadFromBuffer(opcodes, 5);
+    machine.SetRandomSeed(1234);
+    for (int i = 0; i < 4; ++i)
+        machine.Step();
+    machine.SetKeys(0x8);
+    machine.TickTimers();
+
+    Machine fork = machine.Fork();
+    CLOVE_INT_EQ(machine.GetPC(), fork.GetPC());
+    CLOVE_INT_EQ(1, fork.GetMemoryLocValue(0x300));
+    CLOVE_INT_EQ(0x8, fork.GetKeys());
+    // Both hold the written program and data pages until one writes again
+    CLOVE_SIZET_EQ(machine.GetMemory().GetPrivatePageCount(), fork.GetMemory().GetPrivatePageCount());
+
+    for (int i = 0; i < 4; ++i)
+        fork.Step();
+    CLOVE_INT_EQ(2, fork.GetMemoryLocValue(0x300));
+    CLOVE_INT_EQ(1, machine.GetMemoryLocValue(0x300));
+
+    for (int i = 0; i < 4; ++i)
+        machine.Step();
+    CLOVE_INT_EQ(2, machine.GetMemoryLocValue(0x300));
+    // The random state was copied, so both draw the same numbers
+    CLOVE_INT_EQ(machine.GetRegisterValue(1), fork.GetRegisterValue(1));
+}
+
+CLOVE_TEST(SaveStateRoundTrip)
+{
+    Machine machine;
+    // LD V0, 7; LD I, 0x300; LD [I], V0; DRW V0, V0, 5; LD DT, V0
+    uint16_t opcodes[] = { 0x0760, 0x00a3, 0x55f0, 0x05d0, 0x15f0 };
+    machine.LoadFromBuffer(opcodes, 5);
+    for (int i = 0; i < 5; ++i)
+        machine.Step();
+
+    std::vector<uint8_t> state;
+    machine.SaveState(state);
+    Machine restored;
+    CLOVE_IS_FALSE(restored.LoadState(std::span(state).first(state.size() - 1)));
+    CLOVE_INT_EQ(0x200, restored.GetPC());
+    CLOVE_IS_TRUE(restored.LoadState(state));
+
+    CLOVE_INT_EQ(machine.GetPC(), restored.GetPC());
+    CLOVE_INT_EQ(7, restored.GetRegisterValue(0));
+    CLOVE_INT_EQ(0x300, restored.GetI());
+    CLOVE_INT_EQ(7, restored.GetDelayTimer());
+    CLOVE_INT_EQ(7, restored.GetMemoryLocValue(0x300));
+    CLOVE_ULLONG_EQ(machine.GetRomHash(), restored.GetRomHash());
+    CLOVE_IS_TRUE(restored.GetDisplay().SameImage(machine.GetDisplay()));
+    // The font page is shared again rather than copied
+    CLOVE_SIZET_EQ(2, restored.GetMemory().GetPrivatePageCount());
+}
\ No newline at end of file
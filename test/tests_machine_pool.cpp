@@ -0,0 +1,103 @@
+#include "machine_pool.h"
+
+#define CLOVE_SUITE_NAME MachinePool
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+CLOVE_TEST(AcquireUntilFull)
+{
+    MachinePool pool(4);
+    CLOVE_SIZET_EQ(4, pool.GetCapacity());
+    for (uint32_t expected = 0; expected < 4; ++expected)
+    {
+        CLOVE_UINT_EQ(expected, pool.Acquire());
+    }
+    CLOVE_UINT_EQ(MachinePool::InvalidIndex, pool.Acquire());
+    CLOVE_SIZET_EQ(4, pool.GetActiveCount());
+    // Slots are contiguous
+    CLOVE_PTR_EQ((&pool[0] + 3), &pool[3]);
+}
+
+CLOVE_TEST(ReleasedSlotIsReusedFresh)
+{
+    MachinePool pool(2);
+    uint32_t first = pool.Acquire();
+    uint32_t second = pool.Acquire();
+    uint16_t opcodes[] = { 0x0560 };
+    pool[first].LoadFromBuffer(opcodes, 1);
+    pool[first].Step();
+    CLOVE_INT_EQ(5, pool[first].GetRegisterValue(0));
+
+    pool.Release(first);
+    CLOVE_IS_TRUE(pool.GetState(first) == PoolSlotState::Free);
+    CLOVE_SIZET_EQ(1, pool.GetActiveCount());
+
+    CLOVE_UINT_EQ(first, pool.Acquire());
+    CLOVE_INT_EQ(0, pool[first].GetRegisterValue(0));
+    CLOVE_INT_EQ(0x200, pool[first].GetPC());
+    CLOVE_IS_TRUE(pool.GetState(second) == PoolSlotState::Running);
+}
+
+CLOVE_TEST(RunFrameStepsRunningMachines)
+{
+    MachinePool pool(64);
+    WorkerPool workers(4);
+    // ADD V0, 1; JP 0x200
+    uint16_t counter[] = { 0x0170, 0x0012 };
+    uint16_t broken[] = { 0xffff };
+    for (int i = 0; i < 40; ++i)
+    {
+        uint32_t index = pool.Acquire();
+        pool[index].LoadFromBuffer(i == 7 ? broken : counter, i == 7 ? 1 : 2);
+    }
+
+    pool.RunFrame(10, &workers);
+    pool.RunFrame(10);
+
+    int visited = 0;
+    pool.ForEach([&](uint32_t index, Machine& machine)
+    {
+        visited++;
+        if (index == 7)
+        {
+            CLOVE_IS_TRUE(pool.GetState(index) == PoolSlotState::Stopped);
+        }
+        else
+        {
+            CLOVE_INT_EQ(10, machine.GetRegisterValue(0));
+        }
+    });
+    CLOVE_INT_EQ(40, visited);
+}
+
+CLOVE_TEST(PlacedPoolKeepsMachinesOnTheirWorker)
+{
+    WorkerPool workers(4, true);
+    MachinePool pool(64, &workers);
+    uint16_t counter[] = { 0x0170, 0x0012 };
+    for (int i = 0; i < 64; ++i)
+    {
+        uint32_t index = pool.Acquire();
+        pool[index].LoadFromBuffer(counter, 2);
+    }
+
+    // RunFrame uses the bands the arena was placed with, on every frame
+    std::vector<std::thread::id> first(64);
+    std::vector<std::thread::id> second(64);
+    for (std::vector<std::thread::id>* owners : { &first, &second })
+    {
+        workers.ParallelFor(static_cast<int>(pool.GetCapacity()), [&](int begin, int end)
+        {
+            for (int index = begin; index < end; ++index)
+                (*owners)[index] = std::this_thread::get_id();
+        });
+        pool.RunFrame(10, &workers);
+    }
+    CLOVE_IS_TRUE(first == second);
+
+    pool.ForEach([&](uint32_t, Machine& machine)
+    {
+        CLOVE_INT_EQ(10, machine.GetRegisterValue(0));
+    });
+}
\ No newline at end of file
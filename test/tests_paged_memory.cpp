@@ -0,0 +1,149 @@
+#include "paged_memory.h"
+
+#include <vector>
+
+#define CLOVE_SUITE_NAME PagedMemory
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+CLOVE_TEST(StartsZeroedWithoutPrivatePages)
+{
+    PagedMemory memory;
+    CLOVE_INT_EQ(0, memory.Read(0x0000));
+    CLOVE_INT_EQ(0, memory.Read(0xFFFF));
+    CLOVE_SIZET_EQ(0, memory.GetPrivatePageCount());
+}
+
+CLOVE_TEST(FirstWriteCopiesSharedPage)
+{
+    PagedMemory::Page shared;
+    for (size_t i = 0; i < shared.size(); ++i)
+        shared[i] = static_cast<uint8_t>(i);
+
+    PagedMemory memory;
+    memory.Share(3, shared.data());
+    CLOVE_INT_EQ(0x10, memory.Read(0x310));
+    CLOVE_SIZET_EQ(0, memory.GetPrivatePageCount());
+
+    memory.Write(0x310, 0xAA);
+    CLOVE_INT_EQ(0xAA, memory.Read(0x310));
+    CLOVE_INT_EQ(0x11, memory.Read(0x311));
+    CLOVE_INT_EQ(0x10, shared[0x10]);
+    CLOVE_SIZET_EQ(1, memory.GetPrivatePageCount());
+
+    memory.Write(0x3FF, 0xBB);
+    CLOVE_SIZET_EQ(1, memory.GetPrivatePageCount());
+}
+
+CLOVE_TEST(CopySpansPagesAndWraps)
+{
+    PagedMemory memory;
+    std::vector<uint8_t> data(0x300, 0x5A);
+    memory.Copy(0xFE80, data.data(), data.size());
+    CLOVE_INT_EQ(0x5A, memory.Read(0xFE80));
+    CLOVE_INT_EQ(0x5A, memory.Read(0xFFFF));
+    CLOVE_INT_EQ(0x5A, memory.Read(0x017F));
+    CLOVE_INT_EQ(0, memory.Read(0x0180));
+    CLOVE_SIZET_EQ(4, memory.GetPrivatePageCount());
+
+    memory.Clear();
+    CLOVE_INT_EQ(0, memory.Read(0xFE80));
+    CLOVE_SIZET_EQ(0, memory.GetPrivatePageCount());
+}
+
+CLOVE_TEST(CopiesShareWrittenPages)
+{
+    PagedMemory memory;
+    memory.Write(0x1234, 0x11);
+
+    PagedMemory copy(memory);
+    CLOVE_INT_EQ(0x11, copy.Read(0x1234));
+
+    copy.Write(0x1235, 0x22);
+    CLOVE_INT_EQ(0x22, copy.Read(0x1235));
+    CLOVE_INT_EQ(0, memory.Read(0x1235));
+
+    memory.Write(0x1234, 0x33);
+    CLOVE_INT_EQ(0x33, memory.Read(0x1234));
+    CLOVE_INT_EQ(0x11, copy.Read(0x1234));
+}
+
+CLOVE_TEST(ArenaPagesAreRecycled)
+{
+    alignas(64) static uint8_t blocks[PageArena::BlockSize * 2];
+    PageArena arena;
+    arena.Attach(blocks, sizeof(blocks));
+
+    {
+        PagedMemory memory;
+        memory.SetArena(&arena);
+        memory.Write(0x1234, 0x11);
+        memory.Write(0x2234, 0x22);
+        CLOVE_SIZET_EQ(2, arena.GetBlocksInUse());
+
+        // Out of blocks: the heap takes over
+        memory.Write(0x3234, 0x33);
+        CLOVE_SIZET_EQ(2, arena.GetBlocksInUse());
+        CLOVE_INT_EQ(0x33, memory.Read(0x3234));
+
+        // Assigning keeps the arena, a copy does not take it
+        PagedMemory other;
+        memory = other;
+        CLOVE_SIZET_EQ(0, arena.GetBlocksInUse());
+        memory.Write(0x1234, 0x44);
+        CLOVE_SIZET_EQ(1, arena.GetBlocksInUse());
+        PagedMemory copy(memory);
+        copy.Write(0x1234, 0x55);
+        CLOVE_SIZET_EQ(1, arena.GetBlocksInUse());
+        CLOVE_INT_EQ(0x44, memory.Read(0x1234));
+    }
+    CLOVE_SIZET_EQ(0, arena.GetBlocksInUse());
+}
+
+static size_t CommittedBytes = 0;
+static size_t CommitLimit = 0;
+
+static bool CountCommit(void* address, size_t size)
+{
+    (void)address;
+    if (CommittedBytes + size > CommitLimit)
+        return false;
+    CommittedBytes += size;
+    return true;
+}
+
+CLOVE_TEST(ArenaCommitsAsItGrows)
+{
+    const size_t size = PageArena::CommitChunkSize * 2;
+    std::vector<uint8_t> storage(size + 64);
+    void* blocks = storage.data() + (64 - reinterpret_cast<uintptr_t>(storage.data()) % 64) % 64;
+    CommittedBytes = 0;
+    CommitLimit = PageArena::CommitChunkSize;
+
+    PageArena arena;
+    arena.Attach(blocks, size, CountCommit);
+    CLOVE_SIZET_EQ(0, CommittedBytes);
+
+    {
+        PagedMemory memory;
+        memory.SetArena(&arena);
+        memory.Write(0x1234, 0x11);
+        CLOVE_SIZET_EQ(PageArena::CommitChunkSize, CommittedBytes);
+        CLOVE_SIZET_EQ(1, arena.GetBlocksInUse());
+    }
+
+    // Everything the first chunk holds, then a commit that fails: the heap
+    // takes over
+    const size_t per_chunk = PageArena::CommitChunkSize / PageArena::BlockSize;
+    std::vector<PagedMemory> memories(per_chunk / PagedMemory::PageCount + 2);
+    for (PagedMemory& memory : memories)
+    {
+        memory.SetArena(&arena);
+        for (size_t page = 0; page < PagedMemory::PageCount; ++page)
+            memory.Write(static_cast<uint16_t>(page * PagedMemory::PageSize), 0x22);
+    }
+    CLOVE_SIZET_EQ(PageArena::CommitChunkSize, CommittedBytes);
+    CLOVE_SIZET_EQ(per_chunk, arena.GetBlocksInUse());
+    CLOVE_INT_EQ(0x22, memories.back().Read(0));
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "png_writer.h"
+
+#include <cstring>
+#include <vector>
+
+#define CLOVE_SUITE_NAME PngWriter
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+CLOVE_TEST(Checksums)
+{
+    const char* digits = "123456789";
+    CLOVE_UINT_EQ(0xCBF43926u, PngWriter::Crc32(reinterpret_cast<const uint8_t*>(digits), strlen(digits)));
+    const char* word = "Wikipedia";
+    CLOVE_UINT_EQ(0x11E60398u, PngWriter::Adler32(reinterpret_cast<const uint8_t*>(word), strlen(word)));
+}
+
+CLOVE_TEST(EncodeHeader)
+{
+    std::vector<uint8_t> indices(64 * 32, 0);
+    std::vector<uint8_t> png;
+    PngWriter::Encode(64, 32, indices.data(), { { 0, 0, 0 }, { 255, 255, 255 } }, png);
+
+    const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    CLOVE_IS_TRUE(memcmp(png.data(), signature, 8) == 0);
+    CLOVE_IS_TRUE(memcmp(png.data() + 12, "IHDR", 4) == 0);
+    CLOVE_INT_EQ(64, png[19]);
+    CLOVE_INT_EQ(32, png[23]);
+    CLOVE_INT_EQ(3, png[25]);
+    CLOVE_IS_TRUE(memcmp(png.data() + png.size() - 8, "IEND", 4) == 0);
+}
+
+CLOVE_TEST(DeflateShrinksRuns)
+{
+    std::vector<uint8_t> data(256 * 128, 0);
+    for (size_t i = 0; i < data.size(); i += 97)
+        data[i] = 1;
+
+    std::vector<uint8_t> compressed;
+    PngWriter::Deflate(data.data(), data.size(), compressed);
+    CLOVE_IS_TRUE(compressed.size() < data.size() / 20);
+}
\ No newline at end of file
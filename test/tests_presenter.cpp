@@ -0,0 +1,100 @@
+#include "presenter.h"
+
+#define CLOVE_SUITE_NAME Presenter
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+struct PresenterTarget
+{
+    PresenterTarget()
+    {
+        Window = SDL_CreateWindow("Presenter", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, Display::LowResWidth, Display::LowResHeight, 0);
+        Renderer = SDL_CreateRenderer(Window, -1, 0);
+        Texture = SDL_CreateTexture(Renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, Display::LowResWidth, Display::LowResHeight);
+    }
+    ~PresenterTarget()
+    {
+        SDL_DestroyTexture(Texture);
+        SDL_DestroyRenderer(Renderer);
+        SDL_DestroyWindow(Window);
+    }
+
+    SDL_Window* Window = nullptr;
+    SDL_Renderer* Renderer = nullptr;
+    SDL_Texture* Texture = nullptr;
+};
+
+CLOVE_TEST(ExpandRowUsesPalette)
+{
+    Presenter presenter;
+    presenter.SetPalette({ 0x10, 0x20, 0x30, 0xFF }, { 0xA0, 0xB0, 0xC0, 0xFF });
+
+    Display display;
+    uint8_t sprite[] = { 0x80 };
+    display.DrawSprite(1, 0, sprite, 1);
+
+    uint32_t pixels[Display::LowResWidth];
+    presenter.ExpandRow(display.GetRow(0), 1, pixels);
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(pixels);
+    CLOVE_INT_EQ(0x10, bytes[0]);
+    CLOVE_INT_EQ(0x30, bytes[2]);
+    CLOVE_INT_EQ(0xA0, bytes[4]);
+    CLOVE_INT_EQ(0xC0, bytes[6]);
+    CLOVE_INT_EQ(0x20, bytes[9]);
+}
+
+CLOVE_TEST(PresentUploadsOnlyChangedRows)
+{
+    PresenterTarget target;
+    Presenter presenter;
+    presenter.Attach(target.Renderer, target.Texture);
+
+    Display display;
+    CLOVE_IS_TRUE(presenter.Present(display));
+    CLOVE_ULLONG_EQ(Display::LowResHeight, presenter.GetRowsUploaded());
+
+    CLOVE_IS_TRUE(presenter.Present(display));
+    CLOVE_ULLONG_EQ(Display::LowResHeight, presenter.GetRowsUploaded());
+
+    uint8_t sprite[] = { 0xFF, 0xFF, 0xFF };
+    display.DrawSprite(3, 10, sprite, 3);
+    CLOVE_IS_TRUE(presenter.Present(display));
+    CLOVE_ULLONG_EQ(Display::LowResHeight + 3, presenter.GetRowsUploaded());
+}
+
+CLOVE_TEST(SetPaletteForcesFullUpload)
+{
+    PresenterTarget target;
+    Presenter presenter;
+    presenter.Attach(target.Renderer, target.Texture);
+
+    Display display;
+    presenter.Present(display);
+    presenter.SetPalette({ 0x00, 0x00, 0x00, 0xFF }, { 0x00, 0xFF, 0x00, 0xFF });
+    presenter.Present(display);
+    CLOVE_ULLONG_EQ(2 * Display::LowResHeight, presenter.GetRowsUploaded());
+}
+
+
+CLOVE_TEST(ExpandPlanesUsesPalette)
+{
+    Presenter presenter;
+    presenter.SetColor(2, { 0x11, 0x22, 0x33, 0xFF });
+    presenter.SetColor(3, { 0x44, 0x55, 0x66, 0xFF });
+
+    Display display;
+    uint8_t sprite[] = { 0xC0, 0xA0 };
+    display.SelectPlanes(0x3);
+    display.DrawSprite(0, 0, sprite, 1);
+
+    uint32_t pixels[Display::LowResWidth];
+    presenter.ExpandPlanes(display, 0, pixels);
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(pixels);
+    CLOVE_INT_EQ(0x44, bytes[0]);
+    CLOVE_INT_EQ(0xFF, bytes[4]);
+    CLOVE_INT_EQ(0x11, bytes[8]);
+    CLOVE_INT_EQ(0x00, bytes[12]);
+}
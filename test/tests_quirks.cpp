@@ -0,0 +1,23 @@
+#include "quirks.h"
+
+#define CLOVE_SUITE_NAME Quirks
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+CLOVE_TEST(ProfileNamesRoundTrip)
+{
+    for (QuirkProfile profile : { QuirkProfile::Modern, QuirkProfile::CosmacVip, QuirkProfile::SuperChip, QuirkProfile::XoChip })
+    {
+        QuirkProfile parsed = QuirkProfile::Modern;
+        CLOVE_IS_TRUE(ParseQuirkProfile(GetQuirkProfileName(profile), parsed));
+        CLOVE_IS_TRUE(parsed == profile);
+    }
+}
+
+CLOVE_TEST(UnknownProfileIsRejected)
+{
+    QuirkProfile parsed = QuirkProfile::XoChip;
+    CLOVE_IS_FALSE(ParseQuirkProfile("chip48", parsed));
+    CLOVE_IS_TRUE(parsed == QuirkProfile::XoChip);
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "machine.h"
+#include "rom_database.h"
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#define CLOVE_SUITE_NAME RomDatabase
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+static std::filesystem::path DatabasePath(const char* name)
+{
+    return std::filesystem::temp_directory_path() / name;
+}
+
+CLOVE_TEST(HashIsFnv1a)
+{
+    const uint8_t a[] = { 'a' };
+    CLOVE_ULLONG_EQ(0xCBF29CE484222325ULL, HashRom(nullptr, 0));
+    CLOVE_ULLONG_EQ(0xAF63DC4C8601EC8CULL, HashRom(a, sizeof(a)));
+}
+
+CLOVE_TEST(MachineHashesLoadedRom)
+{
+    Machine machine;
+    uint16_t program[] = { 0x00E0, 0x1200 };
+    machine.LoadFromBuffer(program, 2);
+    CLOVE_ULLONG_EQ(HashRom(reinterpret_cast<const uint8_t*>(program), sizeof(program)), machine.GetRomHash());
+}
+
+CLOVE_TEST(FindsWrittenEntries)
+{
+    std::vector<RomDatabaseEntry> entries;
+    for (uint64_t i = 0; i < 100; ++i)
+    {
+        RomDatabaseEntry entry;
+        // Written out of order, the file must come back sorted
+        entry.Hash = (i * 0x9E3779B97F4A7C15ULL) | 1;
+        entry.InstructionsPerFrame = static_cast<uint16_t>(i + 1);
+        entry.Quirks = QuirkProfile::SuperChip;
+        entry.DisplayMode = RomDisplayMode::Scale2x;
+        entry.KeyLayout[0] = static_cast<uint8_t>(i & 0xF);
+        entries.push_back(entry);
+    }
+
+    std::filesystem::path path = DatabasePath("chipotto_roms.c8db");
+    CLOVE_IS_TRUE(RomDatabase::Write(path, entries));
+
+    RomDatabase database;
+    CLOVE_IS_TRUE(database.Open(path));
+    CLOVE_SIZET_EQ(entries.size(), database.GetCount());
+    for (const RomDatabaseEntry& expected : entries)
+    {
+        const RomDatabaseEntry* entry = database.Find(expected.Hash);
+        CLOVE_NOT_NULL(entry);
+        CLOVE_INT_EQ(expected.InstructionsPerFrame, entry->InstructionsPerFrame);
+        CLOVE_IS_TRUE(entry->Quirks == QuirkProfile::SuperChip);
+        CLOVE_IS_TRUE(entry->DisplayMode == RomDisplayMode::Scale2x);
+        CLOVE_INT_EQ(expected.KeyLayout[0], entry->KeyLayout[0]);
+    }
+    // Hashes are all odd
+    CLOVE_NULL(database.Find(2));
+
+    database.Close();
+    std::filesystem::remove(path);
+}
+
+CLOVE_TEST(RejectsForeignFiles)
+{
+    std::filesystem::path path = DatabasePath("chipotto_not_a_database.c8db");
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "definitely not a ROM database";
+    }
+
+    RomDatabase database;
+    CLOVE_IS_FALSE(database.Open(path));
+    CLOVE_IS_FALSE(database.IsOpen());
+    CLOVE_NULL(database.Find(0));
+    CLOVE_IS_FALSE(database.Open(DatabasePath("chipotto_missing.c8db")));
+
+    std::filesystem::remove(path);
+}
\ No newline at end of file
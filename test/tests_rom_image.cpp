@@ -0,0 +1,100 @@
+#include "machine.h"
+#include "rom_database.h"
+#include "rom_image.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#define CLOVE_SUITE_NAME RomImage
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+static std::filesystem::path RomPath(const char* name)
+{
+    return std::filesystem::temp_directory_path() / name;
+}
+
+CLOVE_TEST(MachinesShareOneImage)
+{
+    std::filesystem::path path = RomPath("chipotto_shared.ch8");
+    const uint8_t rom[] = { 0x60, 0x2A, 0x12, 0x02 };
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(rom), sizeof(rom));
+
+    std::shared_ptr<const RomImage> image = RomImage::Open(path);
+    CLOVE_NOT_NULL(image.get());
+    CLOVE_SIZET_EQ(sizeof(rom), image->GetSize());
+    CLOVE_ULLONG_EQ(HashRom(rom, sizeof(rom)), image->GetHash());
+
+    std::vector<std::unique_ptr<Machine>> machines;
+    for (int i = 0; i < 8; ++i)
+    {
+        machines.push_back(std::make_unique<Machine>());
+        CLOVE_IS_TRUE(machines.back()->LoadFromImage(image));
+        CLOVE_SIZET_EQ(0, machines.back()->GetMemory().GetPrivatePageCount());
+    }
+    for (auto& machine : machines)
+    {
+        machine->Step();
+        CLOVE_INT_EQ(0x2A, machine->GetRegisterValue(0));
+        CLOVE_ULLONG_EQ(image->GetHash(), machine->GetRomHash());
+    }
+
+    // The machines keep the file mapped until they go away
+    machines.clear();
+    image.reset();
+    std::filesystem::remove(path);
+}
+
+CLOVE_TEST(WritesStayPrivate)
+{
+    std::filesystem::path path = RomPath("chipotto_writer.ch8");
+    // LD I, 0x200; LD V0, 0x99; LD [I], V0
+    const uint8_t rom[] = { 0xA2, 0x00, 0x60, 0x99, 0xF0, 0x55 };
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(rom), sizeof(rom));
+
+    std::shared_ptr<const RomImage> image = RomImage::Open(path);
+    {
+        Machine writer;
+        Machine reader;
+        CLOVE_IS_TRUE(writer.LoadFromImage(image));
+        CLOVE_IS_TRUE(reader.LoadFromImage(image));
+        for (int i = 0; i < 3; ++i)
+            writer.Step();
+
+        CLOVE_INT_EQ(0x99, writer.GetMemoryLocValue(0x200));
+        CLOVE_INT_EQ(0xA2, reader.GetMemoryLocValue(0x200));
+        CLOVE_INT_EQ(0xA2, static_cast<int>(image->GetBytes()[0]));
+        CLOVE_SIZET_EQ(1, writer.GetMemory().GetPrivatePageCount());
+        CLOVE_SIZET_EQ(0, reader.GetMemory().GetPrivatePageCount());
+    }
+
+    image.reset();
+    std::filesystem::remove(path);
+}
+
+CLOVE_TEST(MissingFileHasNoImage)
+{
+    CLOVE_NULL(RomImage::Open(RomPath("chipotto_missing.ch8")).get());
+}
+
+CLOVE_TEST(EmptyFileLoadsEverywhere)
+{
+    std::filesystem::path path = RomPath("chipotto_empty.ch8");
+    std::ofstream(path, std::ios::binary).close();
+
+    Machine from_file;
+    CLOVE_IS_TRUE(from_file.LoadFromFile(path));
+    CLOVE_INT_EQ(0, from_file.GetMemoryLocValue(0x200));
+
+    std::shared_ptr<const RomImage> image = RomImage::Open(path);
+    CLOVE_NOT_NULL(image.get());
+    CLOVE_SIZET_EQ(0, image->GetSize());
+    Machine from_image;
+    CLOVE_IS_TRUE(from_image.LoadFromImage(image));
+    CLOVE_ULLONG_EQ(from_file.GetRomHash(), from_image.GetRomHash());
+
+    std::filesystem::remove(path);
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "session_scheduler.h"
+
+#define CLOVE_SUITE_NAME SessionScheduler
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+CLOVE_TEST(RunsEverySessionAFrameAtATime)
+{
+    SessionScheduler scheduler(4, 10, 3);
+    // ADD V0, 1; JP 0x200
+    uint16_t counter[] = { 0x0170, 0x0012 };
+    for (int i = 0; i < 1000; ++i)
+    {
+        SessionScheduler::SessionId id = scheduler.AddSession();
+        scheduler.GetMachine(id).LoadFromBuffer(counter, 2);
+    }
+
+    for (int frame = 0; frame < 3; ++frame)
+        scheduler.RunFrame();
+
+    for (SessionScheduler::SessionId id = 0; id < scheduler.GetSessionCount(); ++id)
+    {
+        CLOVE_INT_EQ(15, scheduler.GetMachine(id).GetRegisterValue(0));
+        CLOVE_IS_TRUE(scheduler.GetState(id) == SessionState::FrameDone);
+    }
+}
+
+CLOVE_TEST(KeyWaitParksUntilInput)
+{
+    SessionScheduler scheduler(2);
+    // LD V0, 30; LD DT, V0; LD V1, K; LD V2, DT; JP 0x208
+    uint16_t program[] = { 0x1e60, 0x15f0, 0x0af1, 0x07f2, 0x0812 };
+    SessionScheduler::SessionId id = scheduler.AddSession();
+    scheduler.GetMachine(id).LoadFromBuffer(program, 5);
+
+    for (int frame = 0; frame < 11; ++frame)
+        scheduler.RunFrame();
+    CLOVE_IS_TRUE(scheduler.GetState(id) == SessionState::Parked);
+    CLOVE_INT_EQ(0x204, scheduler.GetMachine(id).GetPC());
+
+    scheduler.SetKeys(id, 0x10);
+    scheduler.RunFrame();
+    CLOVE_INT_EQ(4, scheduler.GetMachine(id).GetRegisterValue(1));
+    // Parked in frame 1 and resumed in frame 12: the delay timer lost 11 ticks
+    CLOVE_INT_EQ(19, scheduler.GetMachine(id).GetRegisterValue(2));
+    CLOVE_IS_TRUE(scheduler.GetState(id) == SessionState::FrameDone);
+}
+
+CLOVE_TEST(BadOpcodeFinishesSession)
+{
+    SessionScheduler scheduler(1);
+    uint16_t program[] = { 0xffff };
+    SessionScheduler::SessionId id = scheduler.AddSession();
+    scheduler.GetMachine(id).LoadFromBuffer(program, 1);
+
+    scheduler.RunFrame();
+    CLOVE_IS_TRUE(scheduler.GetState(id) == SessionState::Finished);
+    scheduler.RunFrame();
+    CLOVE_IS_TRUE(scheduler.GetState(id) == SessionState::Finished);
+}
+
+CLOVE_TEST(BackgroundSessionsAreThrottledUnderLoad)
+{
+    SessionScheduler scheduler(2, 8, 4);
+    // Every frame overruns a 1 ns period, so the background budget halves each frame
+    scheduler.SetFramePeriod(std::chrono::nanoseconds(1));
+    uint16_t counter[] = { 0x0170, 0x0012 };
+    SessionScheduler::SessionId foreground = scheduler.AddSession();
+    SessionScheduler::SessionId background = scheduler.AddSession(SessionPriority::Background);
+    SessionScheduler::SessionId paused = scheduler.AddSession(SessionPriority::Paused);
+    for (SessionScheduler::SessionId id : { foreground, background, paused })
+        scheduler.GetMachine(id).LoadFromBuffer(counter, 2);
+
+    for (int frame = 0; frame < 6; ++frame)
+        scheduler.RunFrame();
+
+    // 8 + 4 + 2 + 1 instructions, then nothing; every other one is ADD
+    CLOVE_INT_EQ(24, scheduler.GetMachine(foreground).GetRegisterValue(0));
+    CLOVE_INT_EQ(8, scheduler.GetMachine(background).GetRegisterValue(0));
+    CLOVE_INT_EQ(0, scheduler.GetBackgroundBudget());
+    CLOVE_INT_EQ(0x200, scheduler.GetMachine(paused).GetPC());
+
+    CLOVE_ULLONG_EQ(6, scheduler.GetStats(foreground).Frames);
+    CLOVE_ULLONG_EQ(6, scheduler.GetStats(foreground).DeadlineMisses);
+    CLOVE_ULLONG_EQ(48, scheduler.GetStats(foreground).Instructions);
+    CLOVE_ULLONG_EQ(15, scheduler.GetStats(background).Instructions);
+    CLOVE_ULLONG_EQ(0, scheduler.GetStats(paused).Frames);
+    CLOVE_IS_TRUE(scheduler.GetCpuShare(paused) == 0.0);
+    CLOVE_IS_TRUE(scheduler.GetCpuShare(foreground) > 0.0);
+    CLOVE_IS_TRUE(scheduler.GetCpuShare(foreground) + scheduler.GetCpuShare(background) > 0.999);
+
+    scheduler.SetPriority(paused, SessionPriority::Foreground);
+    scheduler.RunFrame();
+    CLOVE_INT_EQ(4, scheduler.GetMachine(paused).GetRegisterValue(0));
+}
+
+CLOVE_TEST(AdmissionFollowsMeasuredCapacity)
+{
+    SessionScheduler scheduler(1, 100);
+    uint16_t counter[] = { 0x0170, 0x0012 };
+    SessionScheduler::SessionId id = scheduler.TryAddSession();
+    CLOVE_INT_NE(SessionScheduler::InvalidSession, id);
+    scheduler.GetMachine(id).LoadFromBuffer(counter, 2);
+    scheduler.RunFrame();
+
+    CLOVE_IS_TRUE(scheduler.CanAdmit(SessionPriority::Foreground));
+    scheduler.SetFramePeriod(std::chrono::nanoseconds(1));
+    CLOVE_INT_EQ(SessionScheduler::InvalidSession, scheduler.TryAddSession());
+    CLOVE_INT_NE(SessionScheduler::InvalidSession, scheduler.TryAddSession(SessionPriority::Background));
+    CLOVE_ULLONG_EQ(2, scheduler.GetSessionCount());
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "shared_framebuffer.h"
+
+#include <string>
+
+#define CLOVE_SUITE_NAME SharedFramebuffer
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+CLOVE_TEST(PublishedFrameIsReadable)
+{
+    SharedFramebuffer writer;
+    CLOVE_IS_TRUE(writer.Create("chipotto-test-publish"));
+
+    SharedFramebuffer reader;
+    CLOVE_IS_TRUE(reader.Open("chipotto-test-publish"));
+
+    Display display;
+    uint8_t sprite[] = { 0xAA };
+    display.DrawSprite(0, 7, sprite, 1);
+
+    SharedFrameState state;
+    state.FrameNumber = 42;
+    state.PC = 0x234;
+    state.Registers[3] = 0x99;
+    writer.Publish(display, state);
+
+    SharedFrameSnapshot snapshot;
+    CLOVE_IS_TRUE(reader.TryRead(snapshot));
+    CLOVE_ULLONG_EQ(42, snapshot.State.FrameNumber);
+    CLOVE_INT_EQ(0x234, snapshot.State.PC);
+    CLOVE_INT_EQ(0x99, snapshot.State.Registers[3]);
+    CLOVE_INT_EQ(Display::LowResWidth, snapshot.Width);
+    CLOVE_IS_TRUE(snapshot.Rows[7] == display.GetRow(7));
+}
+
+CLOVE_TEST(OpenMissingSegmentFails)
+{
+    SharedFramebuffer reader;
+    CLOVE_IS_FALSE(reader.Open("chipotto-test-missing"));
+    CLOVE_IS_FALSE(reader.IsOpen());
+}
+
+CLOVE_TEST(ReaderCannotPublish)
+{
+    SharedFramebuffer writer;
+    CLOVE_IS_TRUE(writer.Create("chipotto-test-readonly"));
+    SharedFramebuffer reader;
+    CLOVE_IS_TRUE(reader.Open("chipotto-test-readonly"));
+
+    Display display;
+    SharedFrameState state;
+    state.FrameNumber = 7;
+    reader.Publish(display, state);
+
+    SharedFrameSnapshot snapshot;
+    CLOVE_IS_TRUE(reader.TryRead(snapshot));
+    CLOVE_ULLONG_EQ(0, snapshot.State.FrameNumber);
+}
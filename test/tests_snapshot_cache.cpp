@@ -0,0 +1,138 @@
+#include "snapshot_cache.h"
+
+#include <filesystem>
+#include <fstream>
+
+#define CLOVE_SUITE_NAME SnapshotCache
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+// LD I, 0x300; LD V0, 42; LD [I], V0; ADD V1, 1; SE V1, 40; JP 0x206;
+// DRW V2, V2, 5; LD V3, K; JP 0x210
+static const uint8_t BootRom[] = { 0xA3, 0x00, 0x60, 0x2A, 0xF0, 0x55, 0x71, 0x01, 0x31, 0x28, 0x12, 0x06, 0xD2, 0x25, 0xF3, 0x0A, 0x12, 0x10 };
+
+static std::filesystem::path CachePath(const char* name)
+{
+    return std::filesystem::temp_directory_path() / name;
+}
+
+CLOVE_TEST(BootStopsAtFirstKeyWait)
+{
+    Machine machine;
+    machine.LoadFromSpan(std::as_bytes(std::span(BootRom)));
+    CLOVE_IS_TRUE(RunBoot(machine, 11, 600));
+    CLOVE_IS_TRUE(machine.IsWaitingForKey());
+    CLOVE_INT_EQ(0x20E, machine.GetPC());
+    CLOVE_INT_EQ(40, machine.GetRegisterValue(1));
+
+    Machine limited;
+    limited.LoadFromSpan(std::as_bytes(std::span(BootRom)));
+    CLOVE_IS_TRUE(RunBoot(limited, 11, 3));
+    CLOVE_IS_FALSE(limited.IsWaitingForKey());
+    CLOVE_IS_TRUE(limited.GetRegisterValue(1) < 40);
+}
+
+CLOVE_TEST(CacheRestoresBootState)
+{
+    std::filesystem::path path = CachePath("chipotto_test.c8ss");
+    std::filesystem::remove(path);
+
+    Machine booted;
+    booted.LoadFromSpan(std::as_bytes(std::span(BootRom)));
+    {
+        SnapshotCache cache;
+        CLOVE_IS_FALSE(cache.Open(path));
+        CLOVE_IS_TRUE(cache.Boot(booted, 11, 600));
+        CLOVE_SIZET_EQ(1, cache.GetCount());
+    }
+
+    {
+        SnapshotCache cache;
+        CLOVE_IS_TRUE(cache.Open(path));
+        SnapshotKey key;
+        key.RomHash = booted.GetRomHash();
+        key.InstructionsPerFrame = 11;
+        key.FrameLimit = 600;
+
+        Machine restored;
+        CLOVE_IS_TRUE(cache.Restore(key, restored));
+        CLOVE_INT_EQ(0x20E, restored.GetPC());
+        CLOVE_IS_TRUE(restored.IsWaitingForKey());
+        CLOVE_INT_EQ(40, restored.GetRegisterValue(1));
+        CLOVE_INT_EQ(42, restored.GetMemoryLocValue(0x300));
+        CLOVE_INT_EQ(0xA3, restored.GetMemoryLocValue(0x200));
+        CLOVE_ULLONG_EQ(booted.GetRomHash(), restored.GetRomHash());
+        CLOVE_IS_TRUE(restored.GetDisplay().SameImage(booted.GetDisplay()));
+
+        // Another profile or speed is a different boot
+        key.Quirks = QuirkProfile::CosmacVip;
+        CLOVE_NULL(cache.Find(key));
+        Machine vip;
+        vip.SetQuirks(QuirkProfile::CosmacVip);
+        vip.LoadFromSpan(std::as_bytes(std::span(BootRom)));
+        CLOVE_IS_TRUE(cache.Boot(vip, 11, 600));
+        CLOVE_SIZET_EQ(2, cache.GetCount());
+        CLOVE_NOT_NULL(cache.Find(key));
+        key.Quirks = QuirkProfile::Modern;
+        CLOVE_NOT_NULL(cache.Find(key));
+    }
+
+    std::filesystem::remove(path);
+}
+
+CLOVE_TEST(CorruptCacheIsRebuilt)
+{
+    std::filesystem::path path = CachePath("chipotto_corrupt.c8ss");
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << "not a snapshot cache";
+    }
+
+    {
+        SnapshotCache cache;
+        CLOVE_IS_FALSE(cache.Open(path));
+        Machine machine;
+        machine.LoadFromSpan(std::as_bytes(std::span(BootRom)));
+        CLOVE_IS_TRUE(cache.Boot(machine, 11, 600));
+        CLOVE_IS_TRUE(cache.IsOpen());
+        CLOVE_SIZET_EQ(1, cache.GetCount());
+    }
+
+    std::filesystem::remove(path);
+}
+
+CLOVE_TEST(CacheRejectsOtherStateLayout)
+{
+    std::filesystem::path path = CachePath("chipotto_layout.c8ss");
+    std::filesystem::remove(path);
+
+    Machine booted;
+    booted.LoadFromSpan(std::as_bytes(std::span(BootRom)));
+    {
+        SnapshotCache cache;
+        CLOVE_IS_TRUE(cache.Boot(booted, 11, 600));
+    }
+
+    // As if written by a build whose machine state is laid out differently
+    {
+        uint64_t layout = Machine::GetStateLayout() + 1;
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(16);
+        file.write(reinterpret_cast<const char*>(&layout), sizeof(layout));
+    }
+
+    SnapshotCache cache;
+    CLOVE_IS_FALSE(cache.Open(path));
+    CLOVE_SIZET_EQ(0, cache.GetCount());
+
+    // The stale file is replaced on the next boot
+    Machine machine;
+    machine.LoadFromSpan(std::as_bytes(std::span(BootRom)));
+    CLOVE_IS_TRUE(cache.Boot(machine, 11, 600));
+    CLOVE_INT_EQ(0x20E, machine.GetPC());
+    CLOVE_SIZET_EQ(1, cache.GetCount());
+    cache.Close();
+
+    std::filesystem::remove(path);
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "terminal_renderer.h"
+
+#include <string>
+
+#define CLOVE_SUITE_NAME TerminalRenderer
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+CLOVE_TEST(FirstRenderDrawsEveryCell)
+{
+    TerminalRenderer renderer(TerminalGlyphs::HalfBlock);
+    Display display;
+    std::string output;
+    renderer.Render(display, output);
+    CLOVE_ULLONG_EQ(renderer.GetColumns() * renderer.GetRows(), renderer.GetCellsWritten());
+    CLOVE_INT_EQ(64, renderer.GetColumns());
+    CLOVE_INT_EQ(16, renderer.GetRows());
+}
+
+CLOVE_TEST(UnchangedFrameWritesNothing)
+{
+    TerminalRenderer renderer(TerminalGlyphs::HalfBlock);
+    Display display;
+    std::string output;
+    renderer.Render(display, output);
+
+    output.clear();
+    renderer.Render(display, output);
+    CLOVE_IS_TRUE(output.empty());
+}
+
+CLOVE_TEST(OnlyChangedCellsAreWritten)
+{
+    TerminalRenderer renderer(TerminalGlyphs::HalfBlock);
+    Display display;
+    std::string output;
+    renderer.Render(display, output);
+    uint64_t written = renderer.GetCellsWritten();
+
+    uint8_t sprite[] = { 0x80, 0x80 };
+    display.DrawSprite(10, 3, sprite, 2);
+    output.clear();
+    renderer.Render(display, output);
+
+    // Rows 3 and 4 live in cells (10, 1) and (10, 2)
+    CLOVE_ULLONG_EQ(written + 2, renderer.GetCellsWritten());
+    CLOVE_IS_TRUE(output.find("\x1b[2;11H\xE2\x96\x84") != std::string::npos);
+    CLOVE_IS_TRUE(output.find("\x1b[3;11H\xE2\x96\x80") != std::string::npos);
+}
+
+CLOVE_TEST(BrailleEncodesDots)
+{
+    TerminalRenderer renderer(TerminalGlyphs::Braille);
+    CLOVE_INT_EQ(32, renderer.GetColumns());
+    CLOVE_INT_EQ(8, renderer.GetRows());
+
+    Display display;
+    std::string output;
+    renderer.Render(display, output);
+
+    // Dots 1 and 8: top-left and bottom-right of the first cell, U+2881
+    uint8_t top[] = { 0x80 };
+    uint8_t bottom[] = { 0x40 };
+    display.DrawSprite(0, 0, top, 1);
+    display.DrawSprite(0, 3, bottom, 1);
+    output.clear();
+    renderer.Render(display, output);
+    CLOVE_IS_TRUE(output.find("\x1b[1;1H\xE2\xA2\x81") != std::string::npos);
+}
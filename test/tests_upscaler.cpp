@@ -0,0 +1,82 @@
+#include "upscaler.h"
+
+#include <vector>
+
+#define CLOVE_SUITE_NAME Upscaler
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+static uint32_t PixelAt(const std::vector<uint32_t>& pixels, const Upscaler& upscaler, int x, int y)
+{
+    return pixels[y * upscaler.GetOutputWidth() + x];
+}
+
+CLOVE_TEST(NearestReplicatesPixels)
+{
+    Upscaler upscaler;
+    upscaler.Configure(3, UpscaleFilter::Nearest, nullptr);
+    upscaler.SetColors(0x0, 0x1);
+
+    Display display;
+    uint8_t sprite[] = { 0x80 };
+    display.DrawSprite(1, 1, sprite, 1);
+
+    std::vector<uint32_t> pixels(upscaler.GetOutputWidth() * upscaler.GetOutputHeight());
+    upscaler.Render(display, 0, Display::LowResHeight, reinterpret_cast<uint8_t*>(pixels.data()), upscaler.GetOutputWidth() * sizeof(uint32_t));
+
+    CLOVE_UINT_EQ(0x0, PixelAt(pixels, upscaler, 2, 2));
+    CLOVE_UINT_EQ(0x1, PixelAt(pixels, upscaler, 3, 3));
+    CLOVE_UINT_EQ(0x1, PixelAt(pixels, upscaler, 5, 5));
+    CLOVE_UINT_EQ(0x0, PixelAt(pixels, upscaler, 6, 5));
+    CLOVE_UINT_EQ(0x0, PixelAt(pixels, upscaler, 5, 6));
+}
+
+CLOVE_TEST(Scale2xSmoothsDiagonals)
+{
+    // A diagonal step: the Scale2x rule fills the inner corners
+    uint64_t source[2] = { 0x8000000000000000ull, 0x4000000000000000ull };
+    uint64_t destination[4 * 2] = {};
+    Upscaler::Scale2xRows(source, 1, 2, destination);
+
+    // Output pixel (2, 1): bottom-left sub-pixel of source (1, 0) joins the step
+    CLOVE_IS_TRUE((destination[2] >> 61) & 0x1);
+    // Output pixel (1, 2): top-right sub-pixel of source (0, 1) joins the step
+    CLOVE_IS_TRUE((destination[4] >> 62) & 0x1);
+    // Pixels away from the step stay clear
+    CLOVE_IS_FALSE((destination[0] >> 60) & 0x1);
+    CLOVE_IS_FALSE((destination[6] >> 63) & 0x1);
+}
+
+CLOVE_TEST(Scale2xKeepsSolidAreas)
+{
+    uint64_t source[2] = { ~0ull, ~0ull };
+    uint64_t destination[4 * 2] = {};
+    Upscaler::Scale2xRows(source, 1, 2, destination);
+    for (uint64_t word : destination)
+    {
+        CLOVE_ULLONG_EQ(~0ull, word);
+    }
+}
+
+CLOVE_TEST(ParallelRenderMatchesSerial)
+{
+    WorkerPool pool(4);
+    Upscaler serial;
+    Upscaler parallel;
+    serial.Configure(10, UpscaleFilter::Scale2x, nullptr);
+    parallel.Configure(10, UpscaleFilter::Scale2x, &pool);
+
+    Display display;
+    uint8_t sprite[] = { 0xF0, 0x90, 0x90, 0x90, 0xF0 };
+    display.DrawSprite(7, 3, sprite, 5);
+    display.DrawSprite(60, 28, sprite, 5);
+
+    size_t size = serial.GetOutputWidth() * serial.GetOutputHeight();
+    std::vector<uint32_t> expected(size);
+    std::vector<uint32_t> actual(size);
+    int pitch = serial.GetOutputWidth() * sizeof(uint32_t);
+    serial.Render(display, 0, Display::LowResHeight, reinterpret_cast<uint8_t*>(expected.data()), pitch);
+    parallel.Render(display, 0, Display::LowResHeight, reinterpret_cast<uint8_t*>(actual.data()), pitch);
+    CLOVE_IS_TRUE(expected == actual);
+}
@@ -0,0 +1,145 @@
+#include <bit>
+#include <filesystem>
+
+#include "vector_env.h"
+
+#define CLOVE_SUITE_NAME VectorEnv
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+CLOVE_TEST(StepReportsRewardsAndResetsFinishedEpisodes)
+{
+    VectorEnvConfig config;
+    config.InstructionsPerFrame = 3;
+    config.Rewards.push_back({ 0x300, 1, 0.5f });
+    config.DoneWhen.push_back({ 0x300, 12 });
+    WorkerPool workers(2);
+    VectorEnv env(8, config, &workers);
+    // LD I, 0x300; ADD V0, 1; LD [I], V0; JP 0x202: the score goes up once a frame
+    uint8_t rom[] = { 0xA3, 0x00, 0x70, 0x01, 0xF0, 0x55, 0x12, 0x02 };
+    CLOVE_IS_TRUE(env.Load(std::as_bytes(std::span(rom))));
+
+    std::vector<uint16_t> keys(8, 0x0020);
+    CLOVE_IS_FALSE(env.Step(std::span(keys).first(7)));
+    for (int step = 0; step < 2; ++step)
+    {
+        CLOVE_IS_TRUE(env.Step(keys));
+        for (size_t index = 0; index < env.GetCount(); ++index)
+        {
+            CLOVE_FLOAT_EQ(2.0f, env.GetRewards()[index]);
+            CLOVE_INT_EQ(0, env.GetDones()[index]);
+        }
+    }
+    CLOVE_INT_EQ(8, env.GetMachine(3).GetMemoryLocValue(0x300));
+    CLOVE_INT_EQ(0x0020, env.GetMachine(3).GetKeys());
+
+    // Reaching 12 ends the episode; the instance is back at the snapshot
+    CLOVE_IS_TRUE(env.Step(keys));
+    for (size_t index = 0; index < env.GetCount(); ++index)
+    {
+        CLOVE_FLOAT_EQ(2.0f, env.GetRewards()[index]);
+        CLOVE_INT_EQ(1, env.GetDones()[index]);
+        CLOVE_INT_EQ(0x200, env.GetMachine(index).GetPC());
+        CLOVE_INT_EQ(0, env.GetMachine(index).GetMemoryLocValue(0x300));
+    }
+    CLOVE_IS_TRUE(env.Step(keys));
+    CLOVE_FLOAT_EQ(2.0f, env.GetRewards()[0]);
+    CLOVE_INT_EQ(0, env.GetDones()[0]);
+}
+
+CLOVE_TEST(EpisodesEndOnStepLimitAndBadOpcode)
+{
+    VectorEnvConfig config;
+    config.FrameSkip = 1;
+    config.MaxEpisodeSteps = 3;
+    VectorEnv env(1, config);
+    // JP 0x200
+    uint8_t spin[] = { 0x12, 0x00 };
+    CLOVE_IS_TRUE(env.Load(std::as_bytes(std::span(spin))));
+
+    uint16_t keys[] = { 0 };
+    for (int step = 1; step <= 6; ++step)
+    {
+        env.Step(keys);
+        CLOVE_INT_EQ(step % 3 == 0 ? 1 : 0, env.GetDones()[0]);
+    }
+
+    uint8_t broken[] = { 0xFF, 0xFF };
+    CLOVE_IS_TRUE(env.Load(std::as_bytes(std::span(broken))));
+    env.Step(keys);
+    CLOVE_INT_EQ(1, env.GetDones()[0]);
+}
+
+CLOVE_TEST(ObservationIsMaxOfLastTwoFrames)
+{
+    VectorEnvConfig config;
+    config.InstructionsPerFrame = 2;
+    config.FrameSkip = 2;
+    VectorEnv env(1, config);
+    // DRW V0, V0, 5; JP 0x200: the "0" glyph blinks every frame
+    uint8_t rom[] = { 0xD0, 0x05, 0x12, 0x00 };
+    CLOVE_IS_TRUE(env.Load(std::as_bytes(std::span(rom))));
+
+    uint16_t keys[] = { 0 };
+    env.Step(keys);
+    CLOVE_IS_FALSE(env.GetMachine(0).GetDisplay().GetPixel(0, 0));
+    std::span<const uint8_t> observation = env.GetObservation(0);
+    CLOVE_SIZET_EQ(VectorEnv::ObservationSize, observation.size());
+    CLOVE_INT_EQ(0xF0, observation[0]);
+    CLOVE_INT_EQ(0x90, observation[8]);
+    CLOVE_INT_EQ(0xF0, observation[32]);
+    CLOVE_INT_EQ(0x00, observation[40]);
+}
+
+CLOVE_TEST(HighResolutionObservationIsDownscaled)
+{
+    Display display;
+    display.SetHighResolution(true);
+    uint8_t sprite[] = { 0xC0 };
+    display.DrawSprite(2, 3, sprite, 1);
+    display.DrawSprite(126, 63, sprite, 1);
+
+    uint8_t observation[VectorEnv::ObservationSize] = {};
+    VectorEnv::PackObservation(display, observation, false);
+    CLOVE_INT_EQ(0x40, observation[1 * 8]);
+    CLOVE_INT_EQ(0x01, observation[31 * 8 + 7]);
+    int lit = 0;
+    for (uint8_t byte : observation)
+        lit += std::popcount(byte);
+    CLOVE_INT_EQ(2, lit);
+}
+
+CLOVE_TEST(ResetsStartFromCachedBootState)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "chipotto_env.c8ss";
+    std::filesystem::remove(path);
+    // LD V0, 9; LD I, 0x300; LD [I], V0; LD V1, K; ADD V2, 1; JP 0x20A
+    uint8_t rom[] = { 0x60, 0x09, 0xA3, 0x00, 0xF0, 0x55, 0xF1, 0x0A, 0x72, 0x01, 0x12, 0x08 };
+    VectorEnvConfig config;
+    config.BootFrames = 600;
+    config.Rewards.push_back({ 0x300, 1, 1.0f });
+
+    {
+        SnapshotCache cache;
+        cache.Open(path);
+        for (int launch = 0; launch < 2; ++launch)
+        {
+            VectorEnv env(2, config);
+            env.SetSnapshotCache(&cache);
+            CLOVE_IS_TRUE(env.Load(std::as_bytes(std::span(rom))));
+            CLOVE_SIZET_EQ(1, cache.GetCount());
+            CLOVE_INT_EQ(0x206, env.GetSnapshot().GetPC());
+            CLOVE_IS_TRUE(env.GetSnapshot().IsWaitingForKey());
+
+            // The boot already wrote the score, so it is no reward
+            uint16_t keys[] = { 0x0008, 0x0000 };
+            env.Step(keys);
+            CLOVE_FLOAT_EQ(0.0f, env.GetRewards()[0]);
+            CLOVE_INT_EQ(3, env.GetMachine(0).GetRegisterValue(1));
+            CLOVE_IS_TRUE(env.GetMachine(1).IsWaitingForKey());
+        }
+    }
+
+    std::filesystem::remove(path);
+}
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "video_capture.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#define CLOVE_SUITE_NAME VideoCapture
+#include "clove-unit.h"
+
+using namespace chipotto;
+
+static std::filesystem::path CapturePath(const char* name)
+{
+    return std::filesystem::temp_directory_path() / name;
+}
+
+static std::vector<uint8_t> ReadAll(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static std::vector<uint8_t> DecodeLzw(const std::vector<uint8_t>& data, int min_code_size)
+{
+    const int clear_code = 1 << min_code_size;
+    const int end_code = clear_code + 1;
+    std::vector<std::vector<uint8_t>> table;
+    std::vector<uint8_t> output;
+    int code_size = min_code_size + 1;
+    size_t bit = 0;
+    int previous = -1;
+
+    auto reset = [&]()
+    {
+        table.clear();
+        for (int code = 0; code < clear_code + 2; ++code)
+            table.push_back({ static_cast<uint8_t>(code) });
+        code_size = min_code_size + 1;
+        previous = -1;
+    };
+    reset();
+
+    while (bit + code_size <= data.size() * 8)
+    {
+        int code = 0;
+        for (int i = 0; i < code_size; ++i, ++bit)
+            code |= ((data[bit / 8] >> (bit % 8)) & 1) << i;
+        if (code == clear_code)
+        {
+            reset();
+            continue;
+        }
+        if (code == end_code)
+            break;
+
+        std::vector<uint8_t> entry;
+        if (code < static_cast<int>(table.size()))
+            entry = table[code];
+        else
+        {
+            entry = table[previous];
+            entry.push_back(table[previous][0]);
+        }
+        output.insert(output.end(), entry.begin(), entry.end());
+        if (previous >= 0 && table.size() < 4096)
+        {
+            std::vector<uint8_t> added = table[previous];
+            added.push_back(entry[0]);
+            table.push_back(added);
+            if (table.size() == (1u << code_size) && code_size < 12)
+                code_size++;
+        }
+        previous = code;
+    }
+    return output;
+}
+
+CLOVE_TEST(LzwRoundTrip)
+{
+    std::vector<uint8_t> indices;
+    for (int i = 0; i < 20000; ++i)
+        indices.push_back(static_cast<uint8_t>((i * 7 / 3 + i / 64) & 0x1));
+
+    std::vector<uint8_t> compressed;
+    EncodeGifLzw(indices.data(), indices.size(), 2, compressed);
+    CLOVE_IS_TRUE(DecodeLzw(compressed, 2) == indices);
+}
+
+CLOVE_TEST(Y4MFrameCountIncludesDuplicates)
+{
+    std::filesystem::path path = CapturePath("chipotto_capture.y4m");
+    CaptureOptions options;
+    options.Format = CaptureFormat::Y4M;
+    options.Policy = CaptureQueuePolicy::Block;
+    options.Scale = 2;
+    {
+        VideoCapture capture;
+        CLOVE_IS_TRUE(capture.Open(path, options));
+        Display display;
+        uint8_t sprite[] = { 0xF0 };
+        capture.Submit(display);
+        capture.Submit(display);
+        display.DrawSprite(0, 0, sprite, 1);
+        capture.Submit(display);
+        capture.Submit(display);
+        capture.Submit(display);
+        capture.Close();
+        CLOVE_ULLONG_EQ(5, capture.GetFramesSubmitted());
+        CLOVE_ULLONG_EQ(3, capture.GetFramesDeduplicated());
+        CLOVE_ULLONG_EQ(0, capture.GetFramesDropped());
+    }
+
+    std::vector<uint8_t> data = ReadAll(path);
+    std::string header = "YUV4MPEG2 W128 H64 F60:1 Ip A1:1 C420jpeg\n";
+    const size_t frame_size = 6 + 128 * 64 + 2 * 64 * 32;
+    CLOVE_ULLONG_EQ(header.size() + 5 * frame_size, data.size());
+    CLOVE_IS_TRUE(std::string(data.begin(), data.begin() + header.size()) == header);
+
+    // First luma sample of the third frame is a lit pixel
+    size_t third = header.size() + 2 * frame_size + 6;
+    CLOVE_INT_EQ(0, data[header.size() + 6]);
+    CLOVE_INT_EQ(255, data[third]);
+    std::filesystem::remove(path);
+}
+
+CLOVE_TEST(GifStructure)
+{
+    std::filesystem::path path = CapturePath("chipotto_capture.gif");
+    CaptureOptions options;
+    options.Format = CaptureFormat::Gif;
+    options.Policy = CaptureQueuePolicy::Block;
+    options.Scale = 2;
+    {
+        VideoCapture capture;
+        CLOVE_IS_TRUE(capture.Open(path, options));
+        Display display;
+        uint8_t sprite[] = { 0xFF };
+        for (int frame = 0; frame < 6; ++frame)
+        {
+            if (frame % 3 == 0)
+                display.DrawSprite(frame, 10, sprite, 1);
+            capture.Submit(display);
+        }
+    }
+
+    std::vector<uint8_t> data = ReadAll(path);
+    CLOVE_IS_TRUE(data.size() > 13);
+    CLOVE_IS_TRUE(std::string(data.begin(), data.begin() + 6) == "GIF89a");
+    CLOVE_INT_EQ(128, data[6] | (data[7] << 8));
+    CLOVE_INT_EQ(64, data[8] | (data[9] << 8));
+    CLOVE_INT_EQ(0x3B, data.back());
+
+    // Two distinct frames, each held for three frames (5 centiseconds at 60 Hz)
+    int frames = 0;
+    int total_delay = 0;
+    for (size_t i = 0; i + 8 < data.size(); ++i)
+    {
+        if (data[i] == 0x21 && data[i + 1] == 0xF9 && data[i + 2] == 0x04)
+        {
+            frames++;
+            total_delay += data[i + 4] | (data[i + 5] << 8);
+        }
+    }
+    CLOVE_INT_EQ(2, frames);
+    CLOVE_INT_EQ(10, total_delay);
+    std::filesystem::remove(path);
+}
\ No newline at end of file
@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "machine.h"
+#include "png_writer.h"
+#include "rom_database.h"
+#include "worker_pool.h"
+
+namespace
+{
+	struct KeyPress
+	{
+		int Frame = 0;
+		uint8_t Key = 0;
+		int Duration = 6;
+	};
+
+	struct Options
+	{
+		std::filesystem::path OutputDirectory = "thumbnails";
+		int Frames = 600;
+		std::vector<int> CaptureFrames;
+		int InstructionsPerFrame = 11;
+		chipotto::QuirkProfile Quirks = chipotto::QuirkProfile::Modern;
+		std::filesystem::path DatabasePath;
+		std::vector<KeyPress> Presses;
+		int Scale = 4;
+		int SheetColumns = 8;
+		int SheetRows = 8;
+		int Threads = 0;
+		bool PinThreads = false;
+	};
+
+	struct RomResult
+	{
+		std::filesystem::path Path;
+		// Path relative to the input directory, without the extension and with
+		// separators turned into underscores
+		std::string Name;
+		std::vector<chipotto::Display> Captures;
+		bool Valid = false;
+	};
+
+	std::string MakeRomName(const std::filesystem::path& path, const std::filesystem::path& root)
+	{
+		std::filesystem::path relative = root.empty() ? path.filename() : path.lexically_relative(root);
+		relative.replace_extension();
+		std::string name = relative.generic_string();
+		std::replace(name.begin(), name.end(), '/', '_');
+		return name;
+	}
+
+	const int Gutter = 2;
+	const uint8_t GutterColor = chipotto::Display::MaxColors;
+
+	std::vector<chipotto::PngColor> MakePalette()
+	{
+		// The XO-CHIP colours, then the contact sheet gutter
+		std::vector<chipotto::PngColor> palette(chipotto::Display::DefaultPalette.begin(), chipotto::Display::DefaultPalette.end());
+		palette.push_back({ 0x40, 0x40, 0x40 });
+		return palette;
+	}
+
+	const std::vector<chipotto::PngColor> Palette = MakePalette();
+
+	void PrintUsage()
+	{
+		std::printf(
+			"usage: thumbnailer [options] <rom file or directory>...\n"
+			"  --out DIR          output directory (default: thumbnails)\n"
+			"  --frames N         emulated frames per ROM (default: 600)\n"
+			"  --capture A,B,...  frames to capture (default: the last one)\n"
+			"  --ipf N            instructions per frame (default: 11)\n"
+			"  --quirks NAME      modern, vip, schip or xochip (default: modern)\n"
+			"  --db FILE          ROM database; known ROMs take their quirks and speed from it\n"
+			"  --press F:K[:D]    hold hex key K from frame F for D frames (default 6), repeatable\n"
+			"  --scale N          low resolution pixel size, rounded up to even (default: 4)\n"
+			"  --sheet C:R        contact sheet columns and rows (default: 8:8)\n"
+			"  --threads N        worker threads (default: all cores)\n"
+			"  --pin              pin each worker thread to its own core\n");
+	}
+
+	uint16_t KeysAtFrame(const Options& options, int frame)
+	{
+		uint16_t keys = 0;
+		for (const KeyPress& press : options.Presses)
+		{
+			if (frame >= press.Frame && frame < press.Frame + press.Duration)
+				keys |= 1 << press.Key;
+		}
+		return keys;
+	}
+
+	void RunRom(const Options& options, const chipotto::RomDatabase& database, RomResult& result)
+	{
+		chipotto::Machine machine;
+		machine.SetQuirks(options.Quirks);
+		if (!machine.LoadFromFile(result.Path))
+			return;
+
+		int instructions_per_frame = options.InstructionsPerFrame;
+		if (const chipotto::RomDatabaseEntry* entry = database.Find(machine.GetRomHash()))
+		{
+			machine.SetQuirks(entry->Quirks);
+			if (entry->InstructionsPerFrame)
+				instructions_per_frame = entry->InstructionsPerFrame;
+		}
+
+		size_t next_capture = 0;
+		for (int frame = 0; frame < options.Frames && next_capture < options.CaptureFrames.size(); ++frame)
+		{
+			machine.SetKeys(KeysAtFrame(options, frame));
+			if (!machine.RunFrame(instructions_per_frame))
+				break;
+			while (next_capture < options.CaptureFrames.size() && options.CaptureFrames[next_capture] == frame)
+			{
+				result.Captures.push_back(machine.GetDisplay());
+				next_capture++;
+			}
+		}
+
+		// A ROM that stops early keeps its last screen for the remaining captures
+		while (result.Captures.size() < options.CaptureFrames.size())
+			result.Captures.push_back(machine.GetDisplay());
+		result.Valid = true;
+	}
+
+	bool WriteThumbnail(const std::filesystem::path& path, const chipotto::Display& display, int scale)
+	{
+		int width = chipotto::Display::LowResWidth * scale;
+		int height = chipotto::Display::LowResHeight * scale;
+		std::vector<uint8_t> pixels(static_cast<size_t>(width) * height);
+		display.Rasterize(pixels.data(), width, scale);
+		return chipotto::PngWriter::Write(path, width, height, pixels.data(), Palette);
+	}
+
+	bool WriteSheet(const std::filesystem::path& path, const std::vector<const chipotto::Display*>& frames, const Options& options)
+	{
+		int cell_width = chipotto::Display::LowResWidth * options.Scale;
+		int cell_height = chipotto::Display::LowResHeight * options.Scale;
+		int columns = std::min<int>(options.SheetColumns, static_cast<int>(frames.size()));
+		int rows = (static_cast<int>(frames.size()) + options.SheetColumns - 1) / options.SheetColumns;
+		int width = columns * (cell_width + Gutter) + Gutter;
+		int height = rows * (cell_height + Gutter) + Gutter;
+
+		std::vector<uint8_t> pixels(static_cast<size_t>(width) * height, GutterColor);
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			int x = Gutter + static_cast<int>(i % options.SheetColumns) * (cell_width + Gutter);
+			int y = Gutter + static_cast<int>(i / options.SheetColumns) * (cell_height + Gutter);
+			frames[i]->Rasterize(pixels.data() + static_cast<size_t>(y) * width + x, width, options.Scale);
+		}
+		return chipotto::PngWriter::Write(path, width, height, pixels.data(), Palette);
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options, std::vector<std::filesystem::path>& inputs)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string argument = argv[i];
+			bool has_value = i + 1 < argc;
+			if (argument == "--out" && has_value)
+				options.OutputDirectory = argv[++i];
+			else if (argument == "--frames" && has_value)
+				options.Frames = std::max(1, std::atoi(argv[++i]));
+			else if (argument == "--ipf" && has_value)
+				options.InstructionsPerFrame = std::max(1, std::atoi(argv[++i]));
+			else if (argument == "--quirks" && has_value)
+			{
+				if (!chipotto::ParseQuirkProfile(argv[++i], options.Quirks))
+					return false;
+			}
+			else if (argument == "--db" && has_value)
+				options.DatabasePath = argv[++i];
+			else if (argument == "--scale" && has_value)
+				options.Scale = (std::clamp(std::atoi(argv[++i]), 1, 16) + 1) & ~1;
+			else if (argument == "--threads" && has_value)
+				options.Threads = std::max(0, std::atoi(argv[++i]));
+			else if (argument == "--pin")
+				options.PinThreads = true;
+			else if (argument == "--capture" && has_value)
+			{
+				for (char* token = std::strtok(argv[++i], ","); token; token = std::strtok(nullptr, ","))
+					options.CaptureFrames.push_back(std::atoi(token));
+			}
+			else if (argument == "--press" && has_value)
+			{
+				KeyPress press;
+				int duration = press.Duration;
+				unsigned int key = 0;
+				if (std::sscanf(argv[++i], "%d:%x:%d", &press.Frame, &key, &duration) < 2)
+					return false;
+				press.Key = static_cast<uint8_t>(key & 0xF);
+				press.Duration = duration;
+				options.Presses.push_back(press);
+			}
+			else if (argument == "--sheet" && has_value)
+			{
+				if (std::sscanf(argv[++i], "%d:%d", &options.SheetColumns, &options.SheetRows) != 2 || options.SheetColumns < 1 || options.SheetRows < 1)
+					return false;
+			}
+			else if (argument.rfind("--", 0) == 0)
+				return false;
+			else
+				inputs.push_back(argument);
+		}
+
+		if (options.CaptureFrames.empty())
+			options.CaptureFrames.push_back(options.Frames - 1);
+		for (int& frame : options.CaptureFrames)
+			frame = std::clamp(frame, 0, options.Frames - 1);
+		std::sort(options.CaptureFrames.begin(), options.CaptureFrames.end());
+		return !inputs.empty();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	std::vector<std::filesystem::path> inputs;
+	if (!ParseOptions(argc, argv, options, inputs))
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	chipotto::RomDatabase database;
+	if (!options.DatabasePath.empty() && !database.Open(options.DatabasePath))
+	{
+		std::fprintf(stderr, "unable to open ROM database %s\n", options.DatabasePath.string().c_str());
+		return -1;
+	}
+
+	std::vector<RomResult> roms;
+	for (const std::filesystem::path& input : inputs)
+	{
+		std::error_code error;
+		if (std::filesystem::is_directory(input, error))
+		{
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(input, error))
+			{
+				if (entry.is_regular_file())
+					roms.push_back({ entry.path(), MakeRomName(entry.path(), input) });
+			}
+		}
+		else
+		{
+			roms.push_back({ input, MakeRomName(input, {}) });
+		}
+	}
+	std::sort(roms.begin(), roms.end(), [](const RomResult& a, const RomResult& b) { return a.Path < b.Path; });
+
+	// Names can still meet across inputs (roms/a_b.ch8 and roms/a/b.ch8): the
+	// later ones get a counter, so no two ROMs write the same file
+	std::unordered_set<std::string> names;
+	for (RomResult& rom : roms)
+	{
+		std::string name = rom.Name;
+		for (int suffix = 2; !names.insert(name).second; ++suffix)
+			name = rom.Name + "_" + std::to_string(suffix);
+		rom.Name = name;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(options.OutputDirectory, error);
+
+	// Every band pulls the next ROM from a shared counter, so one slow ROM does
+	// not leave the other workers idle.
+	chipotto::WorkerPool pool(options.Threads, options.PinThreads);
+	if (options.PinThreads)
+		pool.PinCallingThread();
+	std::atomic<size_t> next_rom = 0;
+	std::atomic<size_t> failed = 0;
+	pool.ParallelFor(pool.GetThreadCount(), [&](int, int)
+	{
+		for (size_t index = next_rom++; index < roms.size(); index = next_rom++)
+		{
+			RomResult& rom = roms[index];
+			RunRom(options, database, rom);
+			if (!rom.Valid)
+			{
+				failed++;
+				continue;
+			}
+			for (size_t capture = 0; capture < rom.Captures.size(); ++capture)
+			{
+				std::string name = rom.Name + "_" + std::to_string(options.CaptureFrames[capture]) + ".png";
+				if (!WriteThumbnail(options.OutputDirectory / name, rom.Captures[capture], options.Scale))
+					failed++;
+			}
+		}
+	});
+
+	// Contact sheets show the last capture of each ROM, in path order
+	std::vector<const chipotto::Display*> sheet_frames;
+	for (const RomResult& rom : roms)
+	{
+		if (rom.Valid)
+			sheet_frames.push_back(&rom.Captures.back());
+	}
+
+	size_t per_sheet = static_cast<size_t>(options.SheetColumns) * options.SheetRows;
+	int sheet_count = static_cast<int>((sheet_frames.size() + per_sheet - 1) / per_sheet);
+	pool.ParallelFor(sheet_count, [&](int begin, int end)
+	{
+		for (int sheet = begin; sheet < end; ++sheet)
+		{
+			auto first = sheet_frames.begin() + sheet * per_sheet;
+			auto last = sheet_frames.begin() + std::min(sheet_frames.size(), (sheet + 1) * per_sheet);
+			std::vector<const chipotto::Display*> frames(first, last);
+			char name[32];
+			std::snprintf(name, sizeof(name), "sheet_%03d.png", sheet);
+			if (!WriteSheet(options.OutputDirectory / name, frames, options))
+				failed++;
+		}
+	});
+
+	std::printf("%zu ROMs, %d contact sheets, %zu failures, %d threads\n", roms.size(), sheet_count, failed.load(), pool.GetThreadCount());
+	return failed == 0 ? 0 : 1;
+}
\ No newline at end of file